@@ -0,0 +1,550 @@
+//
+//  EffectBenchmark.cpp
+//  Performance benchmarks for MyEffect and the STK effects used alongside it
+//
+//  Times MyEffect::process() over the Voices menu, the Stereo toggle, block sizes from 16 to 4096
+//  and sample rates from 44.1 to 192 kHz, plus stk::Chorus, PitShift, FreeVerb, NRev and Echo.
+//  The "LFO/" cases time the chorus LFO on its own: the fixed-point MyOscillator shapes against
+//  the float-phase triangle oscillator MyEffect used before them ("LFO/float-phase").
+//  Each case runs for at least the minimum time and is reported as JSON (ns and cycles per sample),
+//  so results can be stored per commit and compared for regressions.
+//
+//  Build (from the MyEffect folder):
+//    g++ -std=c++14 -O2 -DNDEBUG -Iinclude bench/EffectBenchmark.cpp src/EffectPlugin.cpp include/include.cpp -o EffectBenchmark
+//
+//  Usage:
+//    EffectBenchmark [--benchmark_filter=<text>] [--benchmark_min_time=<seconds>] [--benchmark_out=<file.json>]
+//      --benchmark_filter    only run cases whose name contains <text> (e.g. "MyEffect/voices:4")
+//      --benchmark_min_time  minimum measured time per case (default 0.1 s)
+//      --benchmark_out       write the JSON to a file instead of stdout (progress goes to stderr)
+//
+//  The "/tail" cases feed a short noise burst and then silence, measuring only once the feedback
+//  paths have had 30 s to decay, where denormal numbers would appear without flushing; their
+//  ns/sample should match the cases with signal.
+//
+//  Built with -DAPDI_REALTIME_AUDIT, every block is processed under the real-time audit
+//  (apdi/RealtimeAudit.h) and each case reports the allocations, file opens and locks it made
+//  ("rt_violations"), instead of its timings being meaningful.
+//
+//  Cycles are read from the time-stamp counter on x86 (reference cycles, so they don't follow
+//  turbo / power-saving frequency changes); on other processors cycles_per_sample is null.
+//
+
+#include "apdi/Plugin.h"
+#include "../src/EffectPlugin.h"
+#include "stk/Chorus.h"
+#include "stk/PitShift.h"
+#include "stk/FreeVerb.h"
+#include "stk/NRev.h"
+#include "stk/JCRev.h"
+#include "stk/PRCRev.h"
+#include "stk/Echo.h"
+#include "stk/Noise.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" CREATE_FUNCTION createEffect(float sampleRate);
+
+// Time-stamp counter (0 where there isn't one)
+static unsigned long long readCycles()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static bool hasCycleCounter()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////
+// BENCHMARK CASES - each renders one block per call to run()
+////////////////////////////////////////////////////////////////////////////
+
+class BenchmarkCase
+{
+public:
+    BenchmarkCase(int blockSize) : blockSize(blockSize) { }
+    virtual ~BenchmarkCase() { }
+
+    virtual void run() = 0;
+    virtual void silence() = 0; // switch the input to silence
+
+    const int blockSize;
+};
+
+// MyEffect, created through the plugin entry point as a host would
+class EffectCase : public BenchmarkCase
+{
+public:
+    EffectCase(float sampleRate, int blockSize, int voices, bool stereo)
+    : BenchmarkCase(blockSize), in0(blockSize), in1(blockSize), out0(blockSize), out1(blockSize)
+    {
+        effect.reset((APDI::Effect*)createEffect(sampleRate));
+        effect->setSampleRate(sampleRate);
+
+        const std::vector<APDI::Parameter>& parameters = effect->parameters.get();
+        for(int p = 0; p < (int)parameters.size(); p++)
+            effect->setParameter(p, parameters[p].initial);
+        effect->setParameter(0, 0.5f);           // Rate
+        effect->setParameter(1, 0.5f);           // Intensity
+        effect->setParameter(2, stereo ? 0 : 1); // Stereo toggle (on = mono mix)
+        effect->setParameter(3, 0.8f);           // Dry/Wet
+        effect->setParameter(5, voices - 1);     // Voices menu
+
+        stk::Noise noise(1234);
+        for(int n = 0; n < blockSize; n++){
+            in0[n] = (float)noise.tick() * 0.5f;
+            in1[n] = (float)noise.tick() * 0.5f;
+        }
+    }
+
+    void run()
+    {
+        const float* inputs[2] = { in0.data(), in1.data() };
+        float* outputs[2] = { out0.data(), out1.data() };
+        effect->process(inputs, outputs, blockSize);
+    }
+
+    void silence()
+    {
+        std::fill(in0.begin(), in0.end(), 0.f);
+        std::fill(in1.begin(), in1.end(), 0.f);
+    }
+
+private:
+    std::unique_ptr<APDI::Effect> effect;
+    std::vector<float> in0, in1, out0, out1;
+};
+
+// An STK effect, processing a mono input block into a mono or stereo output block
+template<class EffectType>
+class StkCase : public BenchmarkCase
+{
+public:
+    StkCase(EffectType* effect, int blockSize, int outChannels)
+    : BenchmarkCase(blockSize), effect(effect), in(blockSize, 1), out(blockSize, outChannels)
+    {
+        stk::Noise noise(1234);
+        for(int n = 0; n < blockSize; n++)
+            in[n] = noise.tick() * 0.5;
+    }
+
+    void run() { effect->tick(in, out); }
+
+    void silence()
+    {
+        for(int n = 0; n < blockSize; n++)
+            in[n] = 0.0;
+    }
+
+private:
+    std::unique_ptr<EffectType> effect;
+    stk::StkFrames in, out;
+};
+
+// The triangle LFO MyEffect used before MyOscillator went fixed-point: a float phase in radians,
+// with the increment worked out from the sample rate on every sample. Kept as the LFO baseline.
+class FloatPhaseOscillator
+{
+public:
+    FloatPhaseOscillator() : fPhasePos(0) { }
+
+    float generate(float fRate, float fDepth)
+    {
+        float fMod = 0;
+        float fPhaseInc = (fTwoPI * fRate) / stk::Stk::sampleRate();
+
+        fPhasePos += fPhaseInc;
+        if(fPhasePos > fTwoPI)
+            fPhasePos -= fTwoPI;
+
+        if(fPhasePos < M_PI)
+            fMod = -1 + 2/M_PI * fPhasePos;
+        else
+            fMod = 3 - 2/M_PI * fPhasePos;
+
+        return fMod * fDepth + fDepth;
+    }
+
+private:
+    float fPhasePos;
+    const float fTwoPI = 2 * M_PI;
+};
+
+// One chorus LFO, rendering a block of modulation values (shape -1 is the float-phase baseline)
+template<int Shape>
+class LfoCase : public BenchmarkCase
+{
+public:
+    LfoCase(float sampleRate, int blockSize)
+    : BenchmarkCase(blockSize), out(blockSize), rate(0.5f), depth(0.01f),
+      phase(0), increment(MyOscillator::phaseIncrement(rate, sampleRate)),
+      seed(0x9E3779B9u), randomFrom(0), randomTo(0)
+    { }
+
+    void run()
+    {
+        if(Shape < 0){
+            for(int n = 0; n < blockSize; n++)
+                out[n] = baseline.generate(rate, depth);
+            return;
+        }
+
+        for(int n = 0; n < blockSize; n++){
+            float mod;
+            phase += increment;
+            if(Shape == MyOscillator::RANDOM){
+                if(phase < increment){ // wrapped
+                    seed = MyOscillator::nextRandom(seed);
+                    randomFrom = randomTo;
+                    randomTo = MyOscillator::randomValue(seed);
+                }
+                mod = MyOscillator::smoothRandom(randomFrom, randomTo, phase);
+            }
+            else if(Shape == MyOscillator::SINE)
+                mod = MyOscillator::sine(MyOscillator::triangle(phase));
+            else
+                mod = MyOscillator::triangle(phase);
+            out[n] = mod * depth + depth;
+        }
+    }
+
+    void silence() { } // no input
+
+private:
+    std::vector<float> out;
+    FloatPhaseOscillator baseline;
+    const float rate, depth;
+    unsigned int phase;
+    const unsigned int increment;
+    unsigned int seed;
+    float randomFrom, randomTo;
+};
+
+////////////////////////////////////////////////////////////////////////////
+// REGISTRY - names and factories for every case (created only when run)
+////////////////////////////////////////////////////////////////////////////
+
+struct Benchmark
+{
+    typedef BenchmarkCase* (*Factory)(float sampleRate, int blockSize, int voices, bool stereo);
+
+    std::string name;
+    Factory create;
+    float sampleRate;
+    int blockSize;
+    int voices;
+    bool stereo;
+    bool tail;    // measure the silent tail after a burst of input
+};
+
+static BenchmarkCase* createMyEffect(float sampleRate, int blockSize, int voices, bool stereo)
+{
+    return new EffectCase(sampleRate, blockSize, voices, stereo);
+}
+
+static BenchmarkCase* createChorus(float sampleRate, int blockSize, int, bool)
+{
+    stk::Chorus* chorus = new stk::Chorus(sampleRate * 0.01); // 10 ms base delay
+    chorus->setModDepth(0.2);
+    chorus->setModFrequency(0.5);
+    return new StkCase<stk::Chorus>(chorus, blockSize, 2);
+}
+
+static BenchmarkCase* createPitShift(float sampleRate, int blockSize, int, bool)
+{
+    stk::PitShift* pitShift = new stk::PitShift();
+    pitShift->setShift(1.5);
+    return new StkCase<stk::PitShift>(pitShift, blockSize, 1);
+}
+
+static BenchmarkCase* createFreeVerb(float sampleRate, int blockSize, int, bool)
+{
+    return new StkCase<stk::FreeVerb>(new stk::FreeVerb(), blockSize, 2);
+}
+
+static BenchmarkCase* createNRev(float sampleRate, int blockSize, int, bool)
+{
+    return new StkCase<stk::NRev>(new stk::NRev(1.5), blockSize, 2);
+}
+
+static BenchmarkCase* createEcho(float sampleRate, int blockSize, int, bool)
+{
+    stk::Echo* echo = new stk::Echo((unsigned long)sampleRate);
+    echo->setDelay((unsigned long)(sampleRate * 0.25));
+    return new StkCase<stk::Echo>(echo, blockSize, 1);
+}
+
+static BenchmarkCase* createJCRev(float sampleRate, int blockSize, int, bool)
+{
+    return new StkCase<stk::JCRev>(new stk::JCRev(1.5), blockSize, 2);
+}
+
+static BenchmarkCase* createPRCRev(float sampleRate, int blockSize, int, bool)
+{
+    return new StkCase<stk::PRCRev>(new stk::PRCRev(1.5), blockSize, 2);
+}
+
+template<int Shape>
+static BenchmarkCase* createLfo(float sampleRate, int blockSize, int, bool)
+{
+    return new LfoCase<Shape>(sampleRate, blockSize);
+}
+
+static std::vector<Benchmark> registerBenchmarks()
+{
+    static const float sampleRates[] = { 44100, 48000, 96000, 192000 };
+    static const int blockSizes[] = { 16, 64, 256, 1024, 4096 };
+
+    std::vector<Benchmark> benchmarks;
+    char name[128];
+
+    // MyEffect: every voice count and mix mode, across block sizes and sample rates
+    for(float sampleRate : sampleRates)
+        for(int blockSize : blockSizes)
+            for(int voices = 1; voices <= 4; voices++)
+                for(int stereo = 0; stereo < 2; stereo++){
+                    snprintf(name, sizeof(name), "MyEffect/voices:%d/%s/block:%d/rate:%d",
+                             voices, stereo ? "stereo" : "mono", blockSize, (int)sampleRate);
+                    benchmarks.push_back({ name, createMyEffect, sampleRate, blockSize, voices, stereo != 0, false });
+                }
+
+    // STK effects: across sample rates (they process sample by sample, so one block size is enough)
+    const struct { const char* name; Benchmark::Factory create; } stkEffects[] = {
+        { "Chorus", createChorus },
+        { "PitShift", createPitShift },
+        { "FreeVerb", createFreeVerb },
+        { "NRev", createNRev },
+        { "Echo", createEcho },
+    };
+    for(const auto& effect : stkEffects)
+        for(float sampleRate : sampleRates){
+            snprintf(name, sizeof(name), "stk::%s/block:256/rate:%d", effect.name, (int)sampleRate);
+            benchmarks.push_back({ name, effect.create, sampleRate, 256, 0, false, false });
+        }
+
+    // The chorus LFO on its own, per shape, against the float-phase oscillator it replaced
+    const struct { const char* name; Benchmark::Factory create; } lfos[] = {
+        { "float-phase/triangle", createLfo<-1> },
+        { "fixed-point/triangle", createLfo<MyOscillator::TRIANGLE> },
+        { "fixed-point/sine", createLfo<MyOscillator::SINE> },
+        { "fixed-point/random", createLfo<MyOscillator::RANDOM> },
+    };
+    for(const auto& lfo : lfos){
+        snprintf(name, sizeof(name), "LFO/%s/block:256/rate:44100", lfo.name);
+        benchmarks.push_back({ name, lfo.create, 44100, 256, 0, false, false });
+    }
+
+    // Silent tails of everything with a feedback path (denormal protection)
+    for(int stereo = 0; stereo < 2; stereo++){
+        snprintf(name, sizeof(name), "MyEffect/voices:4/%s/tail/block:256/rate:48000", stereo ? "stereo" : "mono");
+        benchmarks.push_back({ name, createMyEffect, 48000, 256, 4, stereo != 0, true });
+    }
+
+    const struct { const char* name; Benchmark::Factory create; } stkTails[] = {
+        { "Chorus", createChorus },
+        { "FreeVerb", createFreeVerb },
+        { "NRev", createNRev },
+        { "JCRev", createJCRev },
+        { "PRCRev", createPRCRev },
+    };
+    for(const auto& effect : stkTails){
+        snprintf(name, sizeof(name), "stk::%s/tail/block:256/rate:48000", effect.name);
+        benchmarks.push_back({ name, effect.create, 48000, 256, 0, false, true });
+    }
+
+    return benchmarks;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// RUNNER
+////////////////////////////////////////////////////////////////////////////
+
+#if defined(APDI_REALTIME_AUDIT)
+// Real-time violations during the current case: count, and the first few distinct operations
+static unsigned long caseViolations = 0;
+static const char* caseOperations[8];
+static int caseOperationCount = 0;
+
+static void recordViolation(const char* operation)
+{
+    caseViolations++;
+    for(int i = 0; i < caseOperationCount; i++)
+        if(!strcmp(caseOperations[i], operation))
+            return;
+    if(caseOperationCount < 8)
+        caseOperations[caseOperationCount++] = operation;
+}
+#endif
+
+// Processes one block, as the audio thread would
+static inline void runBlock(BenchmarkCase& test)
+{
+    APDI::ScopedRealtimeAudit realtimeAudit;
+    test.run();
+}
+
+struct Result
+{
+    long long iterations;  // blocks processed
+    double seconds;        // wall-clock time
+    double cpuSeconds;     // processor time
+    double cycles;         // time-stamp counter ticks
+};
+
+static Result measure(const Benchmark& benchmark, double minTime)
+{
+    stk::Stk::setSampleRate(benchmark.sampleRate); // STK objects size their delays from this
+    std::unique_ptr<BenchmarkCase> test(benchmark.create(benchmark.sampleRate, benchmark.blockSize, benchmark.voices, benchmark.stereo));
+
+#if defined(APDI_REALTIME_AUDIT)
+    caseViolations = 0;
+    caseOperationCount = 0;
+#endif
+
+    // Warm up (caches, parameter smoothing) for about 50 ms of audio
+    for(long long i = 0; i < (long long)(benchmark.sampleRate * 0.05) / benchmark.blockSize + 1; i++)
+        runBlock(*test);
+
+    // For tails, let the feedback paths decay in silence first
+    if(benchmark.tail){
+        test->silence();
+        for(long long i = 0; i < (long long)(benchmark.sampleRate * 30.0) / benchmark.blockSize; i++)
+            runBlock(*test);
+    }
+
+    // Run in growing batches until the batch takes at least minTime
+    Result result = { 0, 0.0, 0.0, 0.0 };
+    for(long long batch = 1; ; batch *= 2){
+        const std::clock_t cpuStart = std::clock();
+        const auto start = std::chrono::steady_clock::now();
+        const unsigned long long cycleStart = readCycles();
+
+        for(long long i = 0; i < batch; i++)
+            runBlock(*test);
+
+        const unsigned long long cycleEnd = readCycles();
+        const auto end = std::chrono::steady_clock::now();
+        const std::clock_t cpuEnd = std::clock();
+
+        result.iterations = batch;
+        result.seconds = std::chrono::duration<double>(end - start).count();
+        result.cpuSeconds = (double)(cpuEnd - cpuStart) / CLOCKS_PER_SEC;
+        result.cycles = (double)(cycleEnd - cycleStart);
+
+        if(result.seconds >= minTime || batch >= (1LL << 40))
+            return result;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+#if defined(APDI_REALTIME_AUDIT)
+    APDI::RealtimeAudit::setHandler(recordViolation);
+#endif
+
+    std::string filter;
+    double minTime = 0.1;
+    const char* outPath = nullptr;
+
+    for(int a = 1; a < argc; a++){
+        if(!strncmp(argv[a], "--benchmark_filter=", 19))
+            filter = argv[a] + 19;
+        else if(!strncmp(argv[a], "--benchmark_min_time=", 21))
+            minTime = atof(argv[a] + 21);
+        else if(!strncmp(argv[a], "--benchmark_out=", 16))
+            outPath = argv[a] + 16;
+        else{
+            fprintf(stderr, "usage: EffectBenchmark [--benchmark_filter=<text>] [--benchmark_min_time=<seconds>] [--benchmark_out=<file.json>]\n");
+            return 1;
+        }
+    }
+
+    FILE* out = outPath ? fopen(outPath, "w") : stdout;
+    if(!out){
+        fprintf(stderr, "EffectBenchmark: cannot write '%s'\n", outPath);
+        return 1;
+    }
+
+    char date[64];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    fprintf(out, "{\n  \"context\": {\n");
+    fprintf(out, "    \"date\": \"%s\",\n", date);
+    fprintf(out, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+    fprintf(out, "    \"cycle_counter\": \"%s\",\n", hasCycleCounter() ? "tsc" : "none");
+#if defined(APDI_REALTIME_AUDIT)
+    fprintf(out, "    \"realtime_audit\": true,\n");
+#endif
+#if defined(NDEBUG)
+    fprintf(out, "    \"library_build_type\": \"release\"\n");
+#else
+    fprintf(out, "    \"library_build_type\": \"debug\"\n");
+#endif
+    fprintf(out, "  },\n  \"benchmarks\": [");
+
+    bool first = true;
+    for(const Benchmark& benchmark : registerBenchmarks()){
+        if(!filter.empty() && benchmark.name.find(filter) == std::string::npos)
+            continue;
+
+        const Result result = measure(benchmark, minTime);
+        const double samples = (double)result.iterations * benchmark.blockSize;
+        const double nsPerSample = result.seconds * 1e9 / samples;
+
+        fprintf(out, "%s\n    {\n", first ? "" : ",");
+        fprintf(out, "      \"name\": \"%s\",\n", benchmark.name.c_str());
+        fprintf(out, "      \"iterations\": %lld,\n", result.iterations);
+        fprintf(out, "      \"block_size\": %d,\n", benchmark.blockSize);
+        fprintf(out, "      \"sample_rate\": %d,\n", (int)benchmark.sampleRate);
+        fprintf(out, "      \"real_time\": %.3f,\n", result.seconds * 1e9 / result.iterations);
+        fprintf(out, "      \"cpu_time\": %.3f,\n", result.cpuSeconds * 1e9 / result.iterations);
+        fprintf(out, "      \"time_unit\": \"ns\",\n");
+        fprintf(out, "      \"ns_per_sample\": %.4f,\n", nsPerSample);
+        if(hasCycleCounter())
+            fprintf(out, "      \"cycles_per_sample\": %.4f,\n", result.cycles / samples);
+        else
+            fprintf(out, "      \"cycles_per_sample\": null,\n");
+#if defined(APDI_REALTIME_AUDIT)
+        fprintf(out, "      \"rt_violations\": %lu,\n", caseViolations);
+#endif
+        fprintf(out, "      \"realtime_factor\": %.2f\n", 1e9 / (nsPerSample * benchmark.sampleRate));
+        fprintf(out, "    }");
+        fflush(out);
+        first = false;
+
+        fprintf(stderr, "%-48s %10.3f ns/sample\n", benchmark.name.c_str(), nsPerSample);
+#if defined(APDI_REALTIME_AUDIT)
+        for(int i = 0; i < caseOperationCount; i++)
+            fprintf(stderr, "    real-time violation: %s\n", caseOperations[i]);
+#endif
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    if(outPath)
+        fclose(out);
+    return 0;
+}
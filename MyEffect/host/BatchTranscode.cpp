@@ -0,0 +1,267 @@
+//
+//  BatchTranscode.cpp
+//  Parallel batch sound file converter, optionally through APDI effect plugins
+//
+//  Converts sound files, or every sound file in a folder, to another file type and sample format
+//  on all processor cores (see apdi/BatchTranscoder.h), optionally processing them through one or
+//  more plugins built as shared libraries (as for RenderHost). Intended for preparing sample
+//  libraries and for rendering a whole folder through an effect in one go.
+//
+//  Build (from the MyEffect folder, Linux / macOS):
+//    g++ -std=c++14 -O2 -Iinclude host/BatchTranscode.cpp include/apdi/BatchTranscoder.cpp include/include.cpp -ldl -lpthread -o BatchTranscode
+//
+//  Usage:
+//    BatchTranscode <input file or folder>... -o <output folder> [options]
+//      -t <type>     output file type: wav, aif, snd, mat or raw (default wav)
+//      -f <format>   output sample format: int8, int16, int24, int32, float32 or float64 (default int16)
+//      -j <threads>  worker threads (default one per processor core)
+//      -b <frames>   frames streamed at a time (default 4096)
+//      -e <plugin>   process through the plugin (at its initial parameter values); may be repeated
+//                    to chain plugins, in order. The output is then stereo.
+//      -T <seconds>  extra silence run through the plugins after each file, for effect tails (default 0)
+//
+//  Folders are not searched recursively. Each output file takes the input's name with the
+//  extension of the output type, so inputs that would share an output file (such as files of the
+//  same name in two folders) are an error, and nothing is converted.
+//
+
+#include "apdi/BatchTranscoder.h"
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+typedef void* (*CreateEffectFunction)(float sampleRate);
+
+static void usage()
+{
+    fprintf(stderr, "usage: BatchTranscode <input>... -o <output folder> [-t wav|aif|snd|mat|raw] [-f int8|int16|int24|int32|float32|float64] [-j threads] [-b frames] [-e plugin.so]... [-T seconds]\n");
+}
+
+static std::string lowercase(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), [](char c){ return (char)tolower((unsigned char)c); });
+    return text;
+}
+
+static std::string extensionOf(const std::string& path)
+{
+    const size_t dot = path.find_last_of('.');
+    const size_t slash = path.find_last_of('/');
+    if(dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return "";
+    return lowercase(path.substr(dot));
+}
+
+static bool isSoundFile(const std::string& path)
+{
+    const std::string extension = extensionOf(path);
+    return extension == ".wav" || extension == ".aif" || extension == ".aiff" || extension == ".snd"
+        || extension == ".au" || extension == ".mat" || extension == ".raw";
+}
+
+static bool isFolder(const std::string& path)
+{
+    struct stat filestat;
+    return stat(path.c_str(), &filestat) == 0 && S_ISDIR(filestat.st_mode);
+}
+
+// Adds the sound files in a folder (not its subfolders), in name order
+static bool addFolder(const std::string& folder, std::vector<std::string>& inputs)
+{
+    DIR* dir = opendir(folder.c_str());
+    if(!dir){
+        fprintf(stderr, "BatchTranscode: cannot open folder '%s'\n", folder.c_str());
+        return false;
+    }
+
+    std::vector<std::string> files;
+    while(dirent* entry = readdir(dir)){
+        const std::string path = folder + "/" + entry->d_name;
+        if(entry->d_name[0] != '.' && isSoundFile(path) && !isFolder(path))
+            files.push_back(path);
+    }
+    closedir(dir);
+
+    std::sort(files.begin(), files.end());
+    inputs.insert(inputs.end(), files.begin(), files.end());
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> inputs;
+    std::vector<const char*> pluginPaths;
+    std::string outputFolder;
+    std::string outputExtension = ".wav";
+    APDI::BatchTranscoder::Settings settings;
+
+    for(int a = 1; a < argc; a++){
+        std::string option = argv[a];
+        if(option.empty() || option[0] != '-'){
+            if(isFolder(option)){
+                if(!addFolder(option, inputs))
+                    return 1;
+            }else
+                inputs.push_back(option);
+            continue;
+        }
+
+        if(a + 1 >= argc){
+            usage();
+            return 1;
+        }
+        const std::string value = argv[++a];
+
+        if(option == "-o")
+            outputFolder = value;
+        else if(option == "-j")
+            settings.threads = (unsigned int)std::max(0, atoi(value.c_str()));
+        else if(option == "-b")
+            settings.blockFrames = (unsigned int)std::max(1, atoi(value.c_str()));
+        else if(option == "-e")
+            pluginPaths.push_back(argv[a]);
+        else if(option == "-T")
+            settings.tailTime = std::max(0.0, atof(value.c_str()));
+        else if(option == "-t"){
+            if(value == "wav")
+                settings.fileType = stk::FileWrite::FILE_WAV;
+            else if(value == "aif")
+                settings.fileType = stk::FileWrite::FILE_AIF;
+            else if(value == "snd")
+                settings.fileType = stk::FileWrite::FILE_SND;
+            else if(value == "mat")
+                settings.fileType = stk::FileWrite::FILE_MAT;
+            else if(value == "raw")
+                settings.fileType = stk::FileWrite::FILE_RAW;
+            else{
+                usage();
+                return 1;
+            }
+            outputExtension = "." + value;
+        }else if(option == "-f"){
+            if(value == "int8")
+                settings.format = stk::Stk::STK_SINT8;
+            else if(value == "int16")
+                settings.format = stk::Stk::STK_SINT16;
+            else if(value == "int24")
+                settings.format = stk::Stk::STK_SINT24;
+            else if(value == "int32")
+                settings.format = stk::Stk::STK_SINT32;
+            else if(value == "float32")
+                settings.format = stk::Stk::STK_FLOAT32;
+            else if(value == "float64")
+                settings.format = stk::Stk::STK_FLOAT64;
+            else{
+                usage();
+                return 1;
+            }
+        }else{
+            usage();
+            return 1;
+        }
+    }
+
+    if(inputs.empty() || outputFolder.empty()){
+        usage();
+        return 1;
+    }
+
+    if(settings.fileType == stk::FileWrite::FILE_RAW && settings.format != stk::Stk::STK_SINT16){
+        fprintf(stderr, "BatchTranscode: raw files are always int16\n");
+        return 1;
+    }
+
+    if(!isFolder(outputFolder) && mkdir(outputFolder.c_str(), 0777) != 0){
+        fprintf(stderr, "BatchTranscode: cannot create output folder '%s'\n", outputFolder.c_str());
+        return 1;
+    }
+
+    // Failures are reported per file below, rather than by STK as they happen
+    stk::Stk::showWarnings(false);
+    stk::Stk::printErrors(false);
+
+    APDI::BatchTranscoder transcoder(settings);
+
+    // Load the plugins and find their entry points
+    std::vector<void*> libraries;
+    int result = 0;
+    for(size_t p = 0; p < pluginPaths.size(); p++){
+        void* library = dlopen(pluginPaths[p], RTLD_NOW | RTLD_LOCAL);
+        CreateEffectFunction createEffect = library ? (CreateEffectFunction)dlsym(library, "createEffect") : nullptr;
+        if(!createEffect){
+            fprintf(stderr, "BatchTranscode: %s\n", dlerror());
+            if(library)
+                dlclose(library);
+            result = 1;
+            break;
+        }
+        libraries.push_back(library);
+
+        // Each file gets its own instances, with every control at its initial value
+        transcoder.addEffect([createEffect](float sampleRate){
+            APDI::Effect* effect = (APDI::Effect*)createEffect(sampleRate);
+            if(effect){
+                const std::vector<APDI::Parameter>& parameters = effect->parameters.get();
+                for(int i = 0; i < (int)parameters.size(); i++)
+                    effect->setParameter(i, parameters[i].initial);
+            }
+            return effect;
+        });
+    }
+
+    std::vector<APDI::BatchTranscoder::Job> jobs(inputs.size());
+    std::map<std::string, size_t> outputs; // each output file, and the job writing it
+    for(size_t j = 0; j < inputs.size(); j++){
+        const std::string& input = inputs[j];
+        const size_t slash = input.find_last_of('/');
+        std::string name = slash == std::string::npos ? input : input.substr(slash + 1);
+        name = name.substr(0, name.size() - extensionOf(name).size());
+
+        jobs[j].input = input;
+        jobs[j].output = outputFolder + "/" + name + outputExtension;
+
+        // Two jobs writing the same file at once would leave neither output intact
+        const auto inserted = outputs.insert(std::make_pair(jobs[j].output, j));
+        if(!inserted.second){
+            fprintf(stderr, "BatchTranscode: %s and %s would both be written to %s\n",
+                    jobs[inserted.first->second].input.c_str(), input.c_str(), jobs[j].output.c_str());
+            result = 1;
+        }
+    }
+
+    if(result == 0){
+        const auto start = std::chrono::steady_clock::now();
+        const std::vector<APDI::BatchTranscoder::Result> results = transcoder.run(jobs);
+        const double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        unsigned long long frames = 0;
+        int failures = 0;
+        for(size_t j = 0; j < results.size(); j++){
+            if(results[j].ok)
+                frames += results[j].frames;
+            else{
+                fprintf(stderr, "BatchTranscode: %s: %s\n", jobs[j].input.c_str(), results[j].error.c_str());
+                failures++;
+            }
+        }
+
+        printf("converted:  %d of %d files (%llu frames)\n", (int)jobs.size() - failures, (int)jobs.size(), frames);
+        printf("wall time:  %.3f s\n", wallTime);
+        if(wallTime > 0.0)
+            printf("throughput: %.1f files/s, %.0f frames/s\n", (jobs.size() - failures) / wallTime, frames / wallTime);
+        result = failures ? 1 : 0;
+    }
+
+    for(size_t l = 0; l < libraries.size(); l++)
+        dlclose(libraries[l]);
+    return result;
+}
@@ -0,0 +1,303 @@
+//
+//  RenderHost.cpp
+//  Offline (headless) render host for APDI effect plugins
+//
+//  Loads a plugin built as a shared library, streams a sound file through APDI::Effect::process()
+//  at a fixed block size and writes the result to a new file, reporting the real-time factor.
+//  Intended for batch rendering and regression testing on machines without the Plugin Host.
+//
+//  Build (from the MyEffect folder, Linux / macOS):
+//    g++ -std=c++14 -O2 -shared -fPIC -Iinclude src/EffectPlugin.cpp include/include.cpp -o MyEffect.so
+//    g++ -std=c++14 -O2 -Iinclude host/RenderHost.cpp include/include.cpp -ldl -o RenderHost
+//
+//  Add -DAPDI_REALTIME_AUDIT to the RenderHost build to abort on any allocation, file open or lock
+//  inside process() (see apdi/RealtimeAudit.h).
+//
+//  Usage:
+//    RenderHost <plugin.so> <input.wav> <output.wav> [options]
+//      -b <frames>   block size passed to process() (default 512)
+//      -p <index>    load preset [index] from the plugin's Presets before rendering
+//      -a <file>     parameter automation file (see below)
+//      -f <format>   output sample format: int16, int24 or float32 (default float32)
+//      -t <seconds>  extra silence rendered after the input, for effect tails (default 0)
+//
+//  Automation file: one event per line, "<time in seconds> <parameter> <value>", where <parameter>
+//  is either the parameter index or its name (e.g. "1.5 Output Gain 0.8"). Blank lines and lines
+//  starting with '#' are ignored. Events are applied (with setParameter) at the start of the first
+//  block at or after their time, as a host would between calls to process().
+//
+
+#include "apdi/Plugin.h"
+#include "stk/FileRead.h"
+#include "stk/FileWvIn.h"
+#include "stk/FileWvOut.h"
+
+#include <dlfcn.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+typedef void* (*CreateEffectFunction)(float sampleRate);
+
+struct AutomationEvent
+{
+    unsigned long frame;  // sample frame at which the value applies
+    int index;            // parameter index
+    float value;          // new parameter value
+};
+
+static void usage()
+{
+    fprintf(stderr, "usage: RenderHost <plugin.so> <input.wav> <output.wav> [-b frames] [-p preset] [-a automation] [-f int16|int24|float32] [-t seconds]\n");
+}
+
+// CPU time used by this thread, in seconds
+static double cpuTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Finds a parameter by index ("3") or by name ("Dry/Wet"), returning -1 if there is no match
+static int findParameter(const APDI::Effect& effect, const std::string& name)
+{
+    const std::vector<APDI::Parameter>& parameters = effect.parameters.get();
+
+    char* end;
+    long index = strtol(name.c_str(), &end, 10);
+    if(!name.empty() && *end == '\0')
+        return index >= 0 && index < (long)parameters.size() ? (int)index : -1;
+
+    for(int i = 0; i < (int)parameters.size(); i++)
+        if(parameters[i].name == name)
+            return i;
+    return -1;
+}
+
+// Reads an automation file into a list of events, sorted by time
+static bool loadAutomation(const char* path, const APDI::Effect& effect, float sampleRate, std::vector<AutomationEvent>& events)
+{
+    std::ifstream file(path);
+    if(!file){
+        fprintf(stderr, "RenderHost: cannot open automation file '%s'\n", path);
+        return false;
+    }
+
+    std::string line;
+    for(int lineNum = 1; std::getline(file, line); lineNum++){
+        std::istringstream tokens(line);
+        std::vector<std::string> words;
+        std::string word;
+        while(tokens >> word)
+            words.push_back(word);
+
+        if(words.empty() || words[0][0] == '#')
+            continue;
+
+        // time, then the parameter (whose name may contain spaces), then the value
+        std::string name;
+        for(size_t w = 1; w + 1 < words.size(); w++)
+            name += (w > 1 ? " " : "") + words[w];
+
+        int index = words.size() >= 3 ? findParameter(effect, name) : -1;
+        if(index < 0){
+            fprintf(stderr, "RenderHost: %s:%d: expected '<time> <parameter> <value>'\n", path, lineNum);
+            return false;
+        }
+
+        AutomationEvent event;
+        event.frame = (unsigned long)(std::max(0.0, atof(words[0].c_str())) * sampleRate + 0.5);
+        event.index = index;
+        event.value = (float)atof(words.back().c_str());
+        events.push_back(event);
+    }
+
+    std::stable_sort(events.begin(), events.end(),
+                     [](const AutomationEvent& a, const AutomationEvent& b){ return a.frame < b.frame; });
+    return true;
+}
+
+// Streams the input file through the effect into the output file, returning the exit status
+static int render(CreateEffectFunction createEffect, const char* inputPath, const char* outputPath, int blockSize,
+                  int preset, const char* automationPath, stk::Stk::StkFormat format, double tailTime)
+{
+    try {
+        // Run at the file's own rate, so the input is read without resampling
+        float sampleRate;
+        {
+            stk::FileRead probe(inputPath);
+            sampleRate = (float)probe.fileRate();
+        }
+        stk::Stk::setSampleRate(sampleRate);
+
+        stk::FileWvIn input(inputPath);
+        const unsigned int inputChannels = input.channelsOut();
+        const unsigned long inputFrames = input.getSize();
+        const unsigned long totalFrames = inputFrames + (unsigned long)(tailTime * sampleRate);
+
+        std::unique_ptr<APDI::Effect> effect((APDI::Effect*)createEffect(sampleRate));
+        effect->setSampleRate(sampleRate);
+
+        // Start every control at its initial value, then apply the preset (if any) on top
+        const std::vector<APDI::Parameter>& parameters = effect->parameters.get();
+        for(int p = 0; p < (int)parameters.size(); p++)
+            effect->setParameter(p, parameters[p].initial);
+
+        if(preset >= 0){
+            const std::vector<APDI::Preset>& presets = effect->presets.presets;
+            if(preset >= (int)presets.size()){
+                fprintf(stderr, "RenderHost: preset %d does not exist (plugin has %d)\n", preset, (int)presets.size());
+                return 1;
+            }
+
+            const std::vector<float>& values = presets[preset].values;
+            for(int p = 0; p < (int)values.size() && p < (int)parameters.size(); p++)
+                effect->setParameter(p, values[p]);
+            effect->presetLoaded(preset, presets[preset].name.c_str());
+        }
+
+        std::vector<AutomationEvent> events;
+        if(automationPath && !loadAutomation(automationPath, *effect, sampleRate, events))
+            return 1;
+
+        stk::FileWvOut output(outputPath, 2, stk::FileWrite::FILE_WAV, format);
+
+        // Plugins always process two channels (mono input is sent to both)
+        stk::StkFrames inFrames(blockSize, inputChannels), outFrames(blockSize, 2);
+        std::vector<float> inBuffer0(blockSize), inBuffer1(blockSize), outBuffer0(blockSize), outBuffer1(blockSize);
+        const float* inputBuffers[2] = { inBuffer0.data(), inBuffer1.data() };
+        float* outputBuffers[2] = { outBuffer0.data(), outBuffer1.data() };
+
+        size_t nextEvent = 0;
+        double processTime = 0.0;
+
+        for(unsigned long frame = 0; frame < totalFrames; frame += blockSize){
+            const int numSamples = (int)std::min<unsigned long>(blockSize, totalFrames - frame);
+
+            // Read the next block (FileWvIn returns silence once the file is finished)
+            input.tick(inFrames);
+            for(int n = 0; n < numSamples; n++){
+                inBuffer0[n] = (float)inFrames(n, 0);
+                inBuffer1[n] = (float)inFrames(n, inputChannels > 1 ? 1 : 0);
+            }
+
+            while(nextEvent < events.size() && events[nextEvent].frame <= frame){
+                effect->setParameter(events[nextEvent].index, events[nextEvent].value);
+                nextEvent++;
+            }
+
+            const double start = cpuTime();
+            {
+                APDI::ScopedRealtimeAudit realtimeAudit; // trap allocation / files / locks (APDI_REALTIME_AUDIT builds)
+                effect->process(inputBuffers, outputBuffers, numSamples);
+            }
+            processTime += cpuTime() - start;
+
+            if(numSamples < blockSize)
+                outFrames.resize(numSamples, 2);
+            for(int n = 0; n < numSamples; n++){
+                outFrames(n, 0) = outBuffer0[n];
+                outFrames(n, 1) = outBuffer1[n];
+            }
+            output.tick(outFrames);
+        }
+
+        output.closeFile();
+
+        const double audioTime = totalFrames / sampleRate;
+        printf("rendered:         %lu frames (%.3f s at %.0f Hz, block size %d)\n", totalFrames, audioTime, sampleRate, blockSize);
+        printf("process time:     %.6f s CPU\n", processTime);
+        if(processTime > 0.0){
+            printf("throughput:       %.0f samples per CPU second\n", totalFrames / processTime);
+            printf("real-time factor: %.2fx\n", audioTime / processTime);
+        }
+    }
+    catch(stk::StkError& error) {
+        fprintf(stderr, "RenderHost: %s\n", error.getMessage().c_str());
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 4){
+        usage();
+        return 1;
+    }
+
+    const char* pluginPath = argv[1];
+    const char* inputPath = argv[2];
+    const char* outputPath = argv[3];
+
+    int blockSize = 512;
+    int preset = -1;
+    const char* automationPath = nullptr;
+    stk::Stk::StkFormat format = stk::Stk::STK_FLOAT32;
+    double tailTime = 0.0;
+
+    for(int a = 4; a < argc; a++){
+        std::string option = argv[a];
+        if(a + 1 >= argc){
+            usage();
+            return 1;
+        }
+        const char* value = argv[++a];
+
+        if(option == "-b")
+            blockSize = atoi(value);
+        else if(option == "-p")
+            preset = atoi(value);
+        else if(option == "-a")
+            automationPath = value;
+        else if(option == "-t")
+            tailTime = atof(value);
+        else if(option == "-f"){
+            std::string name = value;
+            if(name == "int16")
+                format = stk::Stk::STK_SINT16;
+            else if(name == "int24")
+                format = stk::Stk::STK_SINT24;
+            else if(name == "float32")
+                format = stk::Stk::STK_FLOAT32;
+            else{
+                usage();
+                return 1;
+            }
+        }else{
+            usage();
+            return 1;
+        }
+    }
+
+    if(blockSize <= 0){
+        fprintf(stderr, "RenderHost: block size must be positive\n");
+        return 1;
+    }
+
+    // Load the plugin and find its entry point
+    void* library = dlopen(pluginPath, RTLD_NOW | RTLD_LOCAL);
+    if(!library){
+        fprintf(stderr, "RenderHost: %s\n", dlerror());
+        return 1;
+    }
+
+    CreateEffectFunction createEffect = (CreateEffectFunction)dlsym(library, "createEffect");
+    if(!createEffect){
+        fprintf(stderr, "RenderHost: %s\n", dlerror());
+        dlclose(library);
+        return 1;
+    }
+
+    const int result = render(createEffect, inputPath, outputPath, blockSize, preset, automationPath, format, tailTime);
+
+    dlclose(library);
+    return result;
+}
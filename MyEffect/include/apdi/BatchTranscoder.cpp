@@ -0,0 +1,251 @@
+//
+//  BatchTranscoder.cpp
+//  Effect & Synth Plugin Framework - Parallel Batch File Conversion (see BatchTranscoder.h)
+//
+
+#include "BatchTranscoder.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+    // One worker's share of the jobs: the owner takes from the front (the largest files), idle
+    // workers steal from the back (the smallest).
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<size_t> jobs;
+    };
+
+    bool takeJob(WorkQueue& queue, size_t& job, bool steal)
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(queue.jobs.empty())
+            return false;
+
+        if(steal){
+            job = queue.jobs.back();
+            queue.jobs.pop_back();
+        }else{
+            job = queue.jobs.front();
+            queue.jobs.pop_front();
+        }
+        return true;
+    }
+
+    // Held while opening and closing files, and while creating, setting up and destroying effects,
+    // which change STK's process-wide state (the sample rate and its list of objects to alert).
+    std::mutex& stkMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    unsigned long long fileBytes(const std::string& path)
+    {
+        struct stat filestat;
+        return stat(path.c_str(), &filestat) == 0 ? (unsigned long long)filestat.st_size : 0;
+    }
+
+    bool isRawFile(const std::string& path)
+    {
+        if(path.size() < 4)
+            return false;
+        std::string extension = path.substr(path.size() - 4);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](char c){ return (char)tolower((unsigned char)c); });
+        return extension == ".raw";
+    }
+
+    // Sample rate of a file from its header (0 if it can't be read; converting it reports why)
+    float fileRate(const std::string& path)
+    {
+        try {
+            std::lock_guard<std::mutex> lock(stkMutex());
+            stk::FileRead file(path, isRawFile(path));
+            return (float)file.fileRate();
+        }
+        catch(stk::StkError&) {
+            return 0.f;
+        }
+    }
+}
+
+namespace APDI
+{
+    std::vector<BatchTranscoder::Result> BatchTranscoder::run(const std::vector<Job>& jobs)
+    {
+        std::vector<Result> results(jobs.size());
+
+        // Without effects the sample rate doesn't matter, so every file is converted in one go
+        std::map<float, std::vector<size_t> > groups;
+        for(size_t j = 0; j < jobs.size(); j++)
+            groups[effects.empty() ? 0.f : fileRate(jobs[j].input)].push_back(j);
+
+        for(const auto& group : groups)
+            runJobs(jobs, group.second, results);
+
+        return results;
+    }
+
+    // Converts jobs[indices] on the pool of worker threads, returning when they are all done
+    void BatchTranscoder::runJobs(const std::vector<Job>& jobs, const std::vector<size_t>& indices, std::vector<Result>& results)
+    {
+        if(indices.empty())
+            return;
+
+        unsigned int threads = settings.threads ? settings.threads : std::thread::hardware_concurrency();
+        threads = std::max(1u, std::min<unsigned int>(threads, (unsigned int)indices.size()));
+
+        // Deal the jobs out largest first, so the long files start early and the short ones are
+        // left to even out the finishing times
+        std::vector<std::pair<unsigned long long, size_t> > order(indices.size());
+        for(size_t i = 0; i < indices.size(); i++)
+            order[i] = std::make_pair(fileBytes(jobs[indices[i]].input), indices[i]);
+        std::stable_sort(order.begin(), order.end(),
+                         [](const std::pair<unsigned long long, size_t>& a, const std::pair<unsigned long long, size_t>& b){ return a.first > b.first; });
+
+        std::unique_ptr<WorkQueue[]> queues(new WorkQueue[threads]);
+        for(size_t j = 0; j < order.size(); j++)
+            queues[j % threads].jobs.push_back(order[j].second);
+
+        // No jobs are added once started, so a worker is done when its own queue and all the
+        // others are empty
+        auto worker = [&](unsigned int w){
+            size_t job;
+            while(true){
+                bool found = takeJob(queues[w], job, false);
+                for(unsigned int v = 1; !found && v < threads; v++)
+                    found = takeJob(queues[(w + v) % threads], job, true);
+                if(!found)
+                    break;
+                results[job] = convert(jobs[job]);
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for(unsigned int w = 1; w < threads; w++)
+            pool.push_back(std::thread(worker, w));
+        worker(0);
+        for(size_t t = 0; t < pool.size(); t++)
+            pool[t].join();
+    }
+
+    BatchTranscoder::Result BatchTranscoder::convert(const Job& job)
+    {
+        Result result;
+        result.ok = false;
+        result.frames = 0;
+
+        std::unique_ptr<stk::FileRead> input;
+        std::unique_ptr<stk::FileWrite> output;
+        std::vector<std::unique_ptr<Effect> > chain;
+
+        try {
+            {
+                std::lock_guard<std::mutex> lock(stkMutex());
+                input.reset(new stk::FileRead(job.input, isRawFile(job.input)));
+            }
+
+            const unsigned int channels = input->channels();
+            const unsigned long inputFrames = input->fileSize();
+            const float sampleRate = (float)input->fileRate();
+
+            {
+                std::lock_guard<std::mutex> lock(stkMutex());
+                for(size_t e = 0; e < effects.size(); e++){
+                    Effect* effect = effects[e](sampleRate);
+                    if(!effect)
+                        throw std::runtime_error("effect could not be created");
+                    chain.push_back(std::unique_ptr<Effect>(effect));
+                    effect->setSampleRate(sampleRate); // only the first file of a group changes the rate
+                }
+            }
+
+            const unsigned int outputChannels = chain.empty() ? channels : 2;
+            const unsigned long totalFrames = inputFrames + (chain.empty() ? 0 : (unsigned long)(settings.tailTime * sampleRate));
+
+            {
+                std::lock_guard<std::mutex> lock(stkMutex());
+                output.reset(new stk::FileWrite(job.output, outputChannels, settings.fileType, settings.format, sampleRate));
+            }
+
+            // The only buffers: one block in, one block out and (with effects) two stereo float blocks
+            const unsigned int blockFrames = std::max(1u, settings.blockFrames);
+            stk::StkFrames inFrames(blockFrames, channels), outFrames;
+            std::vector<float> buffers;
+            if(!chain.empty()){
+                outFrames.resize(blockFrames, 2);
+                buffers.resize(4 * blockFrames);
+            }
+
+            for(unsigned long frame = 0; frame < totalFrames; frame += blockFrames){
+                const unsigned int numFrames = (unsigned int)std::min<unsigned long>(blockFrames, totalFrames - frame);
+                const unsigned int readFrames = frame < inputFrames ? (unsigned int)std::min<unsigned long>(numFrames, inputFrames - frame) : 0;
+
+                if(readFrames){
+                    if(inFrames.frames() != readFrames)
+                        inFrames.resize(readFrames, channels);
+                    input->read(inFrames, frame);
+                }
+
+                if(chain.empty()){
+                    output->write(inFrames);
+                }else{
+                    // Effects process two channels (mono input is sent to both), silence after the input
+                    float* source[2] = { &buffers[0], &buffers[blockFrames] };
+                    float* destination[2] = { &buffers[2 * blockFrames], &buffers[3 * blockFrames] };
+                    for(unsigned int n = 0; n < numFrames; n++){
+                        source[0][n] = n < readFrames ? (float)inFrames(n, 0) : 0.f;
+                        source[1][n] = n < readFrames ? (float)inFrames(n, channels > 1 ? 1 : 0) : 0.f;
+                    }
+
+                    for(size_t e = 0; e < chain.size(); e++){
+                        chain[e]->process((const float**)source, destination, (int)numFrames);
+                        std::swap(source[0], destination[0]);
+                        std::swap(source[1], destination[1]);
+                    }
+
+                    if(outFrames.frames() != numFrames)
+                        outFrames.resize(numFrames, 2);
+                    for(unsigned int n = 0; n < numFrames; n++){
+                        outFrames(n, 0) = source[0][n];
+                        outFrames(n, 1) = source[1][n];
+                    }
+                    output->write(outFrames);
+                }
+
+                result.frames += numFrames;
+            }
+
+            std::lock_guard<std::mutex> lock(stkMutex());
+            output->close();
+            result.ok = true;
+        }
+        catch(stk::StkError& error) {
+            result.error = error.getMessage();
+        }
+        catch(std::exception& error) {
+            result.error = error.what();
+        }
+
+        std::lock_guard<std::mutex> lock(stkMutex());
+        const bool created = output != nullptr;
+        output.reset();
+        input.reset();
+        chain.clear();
+        if(!result.ok && created)
+            remove(job.output.c_str()); // don't leave a truncated file behind
+        return result;
+    }
+
+} // namespace APDI
@@ -0,0 +1,86 @@
+//
+//  BatchTranscoder.h
+//  Effect & Synth Plugin Framework - Parallel Batch File Conversion
+//
+//  Converts many sound files between the formats stk::FileRead / stk::FileWrite support (WAV,
+//  AIFF, SND, MAT and RAW; 8 to 32-bit integer and 32 / 64-bit float samples), optionally through
+//  a chain of APDI::Effect objects, on a pool of worker threads.
+//
+//  Each file is streamed in blocks of blockFrames frames, so memory use is bounded by the number
+//  of threads and the block size (about threads x blockFrames x (2 x channels + 4) x 4 bytes),
+//  never by the file sizes. Files are dealt out largest first to per-thread work queues, and an
+//  idle thread steals the smallest remaining files from the others, so the load stays balanced
+//  on directories of thousands of files of very different lengths.
+//
+//  Effects run at STK's process-wide sample rate (stk::Stk::setSampleRate), so with effects the
+//  files are converted in groups of one sample rate, each group finishing before the next starts.
+//  Effects are created, set to the group's rate and destroyed one at a time, so that only the
+//  first effect of a group changes the rate, and no worker is processing while it does.
+//
+//  Not part of the plugin build: compile BatchTranscoder.cpp into the program using it (see
+//  host/BatchTranscode.cpp).
+//
+
+#pragma once
+
+#include "Plugin.h"
+#include "../stk/FileRead.h"
+#include "../stk/FileWrite.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace APDI
+{
+    class BatchTranscoder
+    {
+    public:
+        // Creates one effect of the chain for a file at the given sample rate (with its parameters
+        // set up). Called on the worker threads, once per file, but never by two at once.
+        typedef std::function<Effect*(float sampleRate)> EffectFactory;
+
+        struct Settings
+        {
+            stk::FileWrite::FILE_TYPE fileType;  // output file type (FileWrite::FILE_WAV, ...)
+            stk::Stk::StkFormat format;          // output sample format (Stk::STK_SINT16, ...)
+            unsigned int blockFrames;            // frames read, processed and written at a time
+            unsigned int threads;                // worker threads (0 = one per processor core)
+            double tailTime;                     // seconds of silence run through the effects after each file
+
+            Settings()
+            : fileType(stk::FileWrite::FILE_WAV), format(stk::Stk::STK_SINT16), blockFrames(4096), threads(0), tailTime(0.0) { }
+        };
+
+        struct Job
+        {
+            std::string input;    // files ending in .raw are read as STK raw files (mono, 16-bit, 22050 Hz)
+            std::string output;
+        };
+
+        struct Result
+        {
+            bool ok;
+            std::string error;    // why the file failed (if !ok)
+            unsigned long frames; // frames written
+        };
+
+        BatchTranscoder(const Settings& settings = Settings()) : settings(settings) { }
+
+        // Appends an effect to the chain. With effects, the output is always stereo (as plugins
+        // process two channels); without, it has the channels of the input.
+        void addEffect(EffectFactory factory) { effects.push_back(factory); }
+
+        // Converts all the jobs, returning when they are done, with one result per job (in order).
+        // Failed files don't stop the others.
+        std::vector<Result> run(const std::vector<Job>& jobs);
+
+    private:
+        void runJobs(const std::vector<Job>& jobs, const std::vector<size_t>& indices, std::vector<Result>& results);
+        Result convert(const Job& job);
+
+        Settings settings;
+        std::vector<EffectFactory> effects;
+    };
+
+} // namespace APDI
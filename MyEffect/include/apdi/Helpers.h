@@ -17,6 +17,12 @@
 #define M_PI 3.14159265358979323846f
 #endif
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#endif
+
 //==============================================================================
 // DSP OBJECTS - These STK objects have been adapted to support UWE development.
 // The original STK objects they are based on are identified by the stk:: label
@@ -52,7 +58,53 @@ namespace APDI {
     
     class Delay : public stk::DelayL {};
     
-    class Filter : public stk::BiQuad {};
+    // tan(x) for 0 <= x < pi/2, for recomputing filter coefficients cheaply (e.g. every sample, as a
+    // cutoff is modulated). Above pi/4 it uses tan(x) = 1 / tan(pi/2 - x), so that short Taylor
+    // series for sine and cosine (to x^9 and x^8) are enough. The relative error is below 3e-7 (a
+    // couple of float rounding steps, against 1e-7 for tanf) everywhere up to 0.4999 pi, so a
+    // cutoff frequency computed with it is off by less than 0.001 cents.
+    //
+    // fastTanFraction() gives the result as a fraction, so that the division can be combined with
+    // the one a coefficient formula needs anyway.
+    static inline void fastTanFraction(float x, float& numerator, float& denominator){
+        const bool reflect = x > 0.785398163f;
+        if(reflect)
+            x = (1.57079637f - x) - 4.37113883e-8f; // pi/2 - x, in two parts to keep the precision
+        const float x2 = x * x;
+        const float s = x * (1.f + x2 * (-1.f/6.f + x2 * (1.f/120.f + x2 * (-1.f/5040.f + x2 * (1.f/362880.f)))));
+        const float c = 1.f + x2 * (-1.f/2.f + x2 * (1.f/24.f + x2 * (-1.f/720.f + x2 * (1.f/40320.f))));
+        numerator = reflect ? c : s;
+        denominator = reflect ? s : c;
+    }
+    
+    static inline float fastTan(float x){
+        float numerator, denominator;
+        fastTanFraction(x, numerator, denominator);
+        return numerator / denominator;
+    }
+    
+    // Biquad coefficients, as used by stk::BiQuad: y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2]
+    struct BiQuadCoefficients
+    {
+        float b0, b1, b2, a1, a2;
+    };
+    
+    class Filter : public stk::BiQuad {
+    public:
+        Filter() : fast(false) {}
+        
+        void set(const BiQuadCoefficients& c){
+            setCoefficients(c.b0, c.b1, c.b2, c.a1, c.a2);
+        }
+        
+        // Computes coefficients with fastTan() rather than tan() and cos() - for cutoffs that are
+        // changed every sample or every few samples
+        void setFastCoefficients(bool fast){ this->fast = fast; }
+        
+    protected:
+        bool fast;
+    };
+    
     class LPF : public Filter {
     public:
         LPF() : Filter() {
@@ -60,19 +112,39 @@ namespace APDI {
         }
         
         void setCutoff(float frequency){
+            set(coefficients(frequency, fast));
+        }
+        
+        static BiQuadCoefficients coefficients(float frequency, bool fast = false){
             float fOmega = M_PI * (frequency/sampleRate());
+            float fRootTwo = sqrt(2.0f);
+            BiQuadCoefficients c;
+            
+            if(fast){
+                // With K = s / t, the formulas below multiplied through by t^2, for one division
+                float s, t;
+                fastTanFraction(fOmega, s, t);
+                const float ssq = s * s, tsq = t * t, st = fRootTwo * s * t;
+                const float scale = 1.0f / (tsq + st + ssq);
+                c.b0 = ssq * scale;
+                c.b1 = 2.0f * c.b0;
+                c.b2 = c.b0;
+                c.a1 = 2.0f * (ssq - tsq) * scale;
+                c.a2 = (tsq - st + ssq) * scale;
+                return c;
+            }
+            
             float fKval = tan(fOmega);
             float fKvalsq = fKval * fKval;
-            float fRootTwo = sqrt(2.0f);
             float ffrac = 1.0f / (1.0f + fRootTwo * fKval + fKvalsq);
             
-            setB0(fKvalsq * ffrac);
-            setB1(2.0f * fKvalsq * ffrac);
-            setB2(fKvalsq * ffrac);
+            c.b0 = fKvalsq * ffrac;
+            c.b1 = 2.0f * fKvalsq * ffrac;
+            c.b2 = fKvalsq * ffrac;
             
-            //      setA0(0.0);
-            setA1(2.0f * (fKvalsq - 1.0f) * ffrac);
-            setA2((1.0f - fRootTwo * fKval + fKvalsq) * ffrac);
+            c.a1 = 2.0f * (fKvalsq - 1.0f) * ffrac;
+            c.a2 = (1.0f - fRootTwo * fKval + fKvalsq) * ffrac;
+            return c;
         }
     };
     class HPF : public Filter {
@@ -82,19 +154,39 @@ namespace APDI {
         }
         
         void setCutoff(float frequency){
+            set(coefficients(frequency, fast));
+        }
+        
+        static BiQuadCoefficients coefficients(float frequency, bool fast = false){
             float fOmega = M_PI * (frequency/sampleRate());
+            float fRootTwo = sqrt(2.f);
+            BiQuadCoefficients c;
+            
+            if(fast){
+                // With K = s / t, the formulas below multiplied through by t^2, for one division
+                float s, t;
+                fastTanFraction(fOmega, s, t);
+                const float ssq = s * s, tsq = t * t, st = fRootTwo * s * t;
+                const float scale = 1.f / (tsq + st + ssq);
+                c.b0 = tsq * scale;
+                c.b1 = -2.f * c.b0;
+                c.b2 = c.b0;
+                c.a1 = 2.f * (ssq - tsq) * scale;
+                c.a2 = (tsq - st + ssq) * scale;
+                return c;
+            }
+            
             float fKval = tan(fOmega);
             float fKvalsq = fKval * fKval;
-            float fRootTwo = sqrt(2.f);
             float ffrac = 1.f / (1.f + fRootTwo * fKval + fKvalsq);
             
-            setB0(ffrac);
-            setB1(-2.f * ffrac);
-            setB2(ffrac);
+            c.b0 = ffrac;
+            c.b1 = -2.f * ffrac;
+            c.b2 = ffrac;
             
-            //      setA0(0.0);
-            setA1(2.f * (fKvalsq - 1.f) * ffrac);
-            setA2((1.f - fRootTwo * fKval + fKvalsq) * ffrac);
+            c.a1 = 2.f * (fKvalsq - 1.f) * ffrac;
+            c.a2 = (1.f - fRootTwo * fKval + fKvalsq) * ffrac;
+            return c;
         }
     };
     
@@ -109,6 +201,10 @@ namespace APDI {
         }
         
         void set(float centre, float bandwidth){
+            Filter::set(coefficients(centre, bandwidth, fast));
+        }
+        
+        static BiQuadCoefficients coefficients(float centre, float bandwidth, bool fast = false){
             const float fSampleRate = sampleRate();
             
             // if possible, better to fix out of range values than fail silently
@@ -130,34 +226,352 @@ namespace APDI {
             
             float fOmegaA = M_PI * (centre/fSampleRate);
             float fOmegaB = M_PI * (bandwidth/fSampleRate);
-            float fCval = (tan(fOmegaB) - 1.f) / (tan(2.0f * fOmegaB) + 1.f);
-            float fDval = -1.0f * cos(2.0f * fOmegaA);
+            float fCval, fDval;
+            if(fast){
+                // From tangents alone: tan(2b) = 2 tan(b) / (1 - tan(b)^2) (with tan(b) < 0.94, as
+                // the bandwidth is below 0.25 Fs) and cos(2a) = (1 - tan(a)^2) / (1 + tan(a)^2)
+                const float fTanB = fastTan(fOmegaB), fTanA = fastTan(fOmegaA);
+                const float fTanBsq = fTanB * fTanB, fTanAsq = fTanA * fTanA;
+                fCval = (fTanB - 1.f) / (2.f * fTanB / (1.f - fTanBsq) + 1.f);
+                fDval = (fTanAsq - 1.f) / (fTanAsq + 1.f);
+            }else{
+                fCval = (tan(fOmegaB) - 1.f) / (tan(2.0f * fOmegaB) + 1.f);
+                fDval = -1.0f * cos(2.0f * fOmegaA);
+            }
             
-            setB0(-1.0f * fCval);
-            setB1(fDval * (1.0f - fCval));
-            setB2(1.0f);
+            // Half the difference between the input and an allpass filter,
+            // A(z) = (-C + D(1-C) z^-1 + z^-2) / (1 + D(1-C) z^-1 - C z^-2),
+            // which is (1+C)/2 (1 - z^-2) over the same denominator. (Half the sum, a band-stop
+            // filter, would be (1-C)/2 (1 + 2D z^-1 + z^-2).)
+            BiQuadCoefficients c;
+            c.b0 = 0.5f * (1.0f + fCval);
+            c.b1 = 0.0f;
+            c.b2 = -0.5f * (1.0f + fCval);
+            
+            c.a1 = fDval * (1.0f - fCval);
+            c.a2 = -1.0f * fCval;
+            return c;
+        }
+    };
+    
+    // Topology-preserving (trapezoidal integration) state variable filter, after Zavalishin's "The
+    // Art of VA Filter Design": low-pass, high-pass, band-pass (unity gain at the centre) or notch
+    // outputs from the same pair of integrators. Setting the cutoff costs one fastTanFraction() and a
+    // division (and setting Q one more), and the integrator states stay valid as they change, so both can be modulated
+    // every sample (from an LFO or envelope) without the clicks or zipper noise of a biquad. With Q
+    // at 0.7071 the low-pass and high-pass responses are the same as LPF and HPF.
+    class SVF
+    {
+    public:
+        enum Mode
+        {
+            LOWPASS,
+            HIGHPASS,
+            BANDPASS,
+            NOTCH
+        };
+        
+        SVF(Mode mode = LOWPASS) : mode(mode), cutoff(1000.f), Q(0.70710678f), k(1.41421356f), rate(0.f), ic1(0.f), ic2(0.f), output(0.f) {
+            update();
+        }
+        
+        void setMode(Mode mode){ this->mode = mode; }
+        Mode getMode() const { return mode; }
+        
+        void set(float cutoff, float Q){
+            this->cutoff = cutoff;
+            this->Q = Q;
+            k = 1.f / (Q > 0.01f ? Q : 0.01f);
+            update();
+        }
+        void setCutoff(float cutoff){
+            this->cutoff = cutoff;
+            update();
+        }
+        void setQ(float Q){ set(cutoff, Q); }
+        
+        float getCutoff() const { return cutoff; }
+        float getQ() const { return Q; }
+        
+        void clear(){ ic1 = ic2 = output = 0.f; }
+        
+        float lastOut() const { return output; }
+        
+        float tick(float input){
+            const float v3 = input - ic2;
+            const float band = a1 * ic1 + a2 * v3;
+            const float low = ic2 + a2 * ic1 + a3 * v3;
+            ic1 = 2.f * band - ic1;
+            ic2 = 2.f * low - ic2;
             
-            //		setA0(0.0);
-            setA1(-1.0f * fDval * (1.0f - fCval));
-            setA2(fCval);
+            switch(mode){
+                case LOWPASS:  output = low; break;
+                case HIGHPASS: output = input - k * band - low; break;
+                case BANDPASS: output = k * band; break;
+                case NOTCH:    output = input - k * band; break;
+            }
+            return output;
         }
         
-        float tick(float sample){
-            inputs_[2] = inputs_[1];
-            inputs_[1] = inputs_[0];
-            outputs_[2] = outputs_[1];
-            outputs_[1] = outputs_[0];
-            inputs_[0] = sample;
+        stk::StkFrames& tick(stk::StkFrames& frames, unsigned int channel = 0){
+            float* samples = &frames[channel];
+            const unsigned int hop = frames.channels();
+            for(unsigned int n = 0; n < frames.frames(); n++, samples += hop)
+                *samples = tick(*samples);
+            return frames;
+        }
+        
+    private:
+        void update(){
+            const float fSampleRate = getSampleRate();
+            if(fSampleRate != rate){
+                rate = fSampleRate;
+                omegaScale = M_PI / rate;
+            }
+            
+            // Kept below Nyquist (where tan() is infinite), as for BPF
+            float frequency = cutoff;
+            if(frequency < 0.f) frequency = 0.f;
+            if(frequency > 0.49f * rate) frequency = 0.49f * rate;
+            
+            // g = s / t, and a1 = 1 / (1 + g (g + k)), a2 = g a1, a3 = g a2 multiplied through by t^2
+            float s, t;
+            fastTanFraction(frequency * omegaScale, s, t);
+            const float scale = 1.f / (t * t + s * (s + k * t));
+            a1 = t * t * scale;
+            a2 = s * t * scale;
+            a3 = s * s * scale;
+        }
+        
+        Mode mode;
+        float cutoff, Q;
+        float k, a1, a2, a3;    // damping (1/Q) and the coefficients of the integrator updates
+        float rate, omegaScale; // the sample rate the cutoff was last set at, and pi over it
+        float ic1, ic2;         // the integrators' states
+        float output;
+    };
+    
+    // A bank of biquad filters run side by side - one per channel, or a set of parallel bands on
+    // one signal. Their coefficients and states are stored as arrays (one element per filter), so
+    // each sample is computed for 8 filters at once with AVX (when compiled with AVX enabled) or
+    // 4 at once with SSE. Each filter gives the same output as an LPF, HPF, BPF or stk::BiQuad with
+    // the same coefficients.
+    //
+    // Coefficient changes can be smoothed: each filter's coefficients then move in a straight line
+    // to the new values over the smoothing time, rather than jumping, which avoids zipper noise when
+    // a cutoff is swept. (The stable region of a1 and a2 is convex, so every coefficient set on the
+    // way between two stable filters is stable too.)
+    //
+    // resize() allocates memory, so call it outside process(). Everything else is real-time safe.
+    class BiQuadBank
+    {
+    public:
+        BiQuadBank(int filters = 0) : filters(0), padded(0), smoothing(0), fast(false), ramping(false), rampCountdown(0), rampSteps(0) {
+            resize(filters);
+        }
+        
+        // Sets the number of filters, each passing its input straight through
+        void resize(int filters){
+            this->filters = filters;
+            padded = (filters + lanes - 1) / lanes * lanes;
+            for(int k = 0; k < COEFFICIENTS; k++){
+                coefficients[k].assign(padded, k == 0 ? 1.f : 0.f);
+                targets[k].assign(padded, k == 0 ? 1.f : 0.f);
+                increments[k].assign(padded, 0.f);
+            }
+            for(int k = 0; k < STATES; k++)
+                states[k].assign(padded, 0.f);
+            remaining.assign(padded, 0);
+            frame.assign(padded, 0.f);
+            ramping = false;
+            rampCountdown = rampSteps = 0;
+        }
+        
+        int size() const { return filters; }
+        
+        // Clears the filters' input and output history
+        void clear(){
+            for(int k = 0; k < STATES; k++)
+                std::fill(states[k].begin(), states[k].end(), 0.f);
+        }
+        
+        // Sets the number of samples over which coefficient changes are spread (0 for none)
+        void setSmoothing(int samples){
+            smoothing = samples > 0 ? samples : 0;
+        }
+        
+        void setCoefficients(int filter, const BiQuadCoefficients& c){
+            const float values[COEFFICIENTS] = { c.b0, c.b1, c.b2, c.a1, c.a2 };
+            if(smoothing == 0){
+                for(int k = 0; k < COEFFICIENTS; k++){
+                    coefficients[k][filter] = targets[k][filter] = values[k];
+                    increments[k][filter] = 0.f;
+                }
+                remaining[filter] = 0;
+                return;
+            }
             
-            outputs_[0] = inputs_[0] * b_[0]
-            + inputs_[1] * b_[1]
-            + inputs_[2] * b_[2]
-            + outputs_[1] * a_[1]
-            + outputs_[2] * a_[2];
+            // Take account of the steps other filters' ramps have made since the countdown began
+            if(ramping)
+                updateRamps();
             
-            return 0.5f * (inputs_[0] - outputs_[0]); // BPF
-            //      return 0.5 * (fFiltvalx[0] + fFiltvaly[0]); // BSF
+            for(int k = 0; k < COEFFICIENTS; k++){
+                targets[k][filter] = values[k];
+                increments[k][filter] = (values[k] - coefficients[k][filter]) / smoothing;
+            }
+            remaining[filter] = smoothing;
+            if(!ramping || smoothing < rampCountdown)
+                rampCountdown = smoothing;
+            ramping = true;
+        }
+        
+        // As for Filter - computes the coefficients below with fastTan()
+        void setFastCoefficients(bool fast){ this->fast = fast; }
+        
+        // The same settings as LPF, HPF and BPF, for one of the filters
+        void setLowPass(int filter, float cutoff){ setCoefficients(filter, LPF::coefficients(cutoff, fast)); }
+        void setHighPass(int filter, float cutoff){ setCoefficients(filter, HPF::coefficients(cutoff, fast)); }
+        void setBandPass(int filter, float centre, float bandwidth){ setCoefficients(filter, BPF::coefficients(centre, bandwidth, fast)); }
+        void setBandPassQ(int filter, float centre, float Q){ setBandPass(filter, centre, centre / Q); }
+        
+        // Filters one sample for each filter (samples[0] through the first, and so on), in place
+        void tick(float* samples){
+            std::copy(samples, samples + filters, frame.begin());
+            step();
+            std::copy(frame.begin(), frame.begin() + filters, samples);
         }
+        
+        // Filters the same sample through every filter, writing one output for each
+        void tick(float input, float* outputs){
+            std::fill(frame.begin(), frame.begin() + filters, input);
+            step();
+            std::copy(frame.begin(), frame.begin() + filters, outputs);
+        }
+        
+        // Filters a block, with each channel through the filter of the same number (as in process())
+        void process(const float** inputs, float** outputs, int frames){
+            for(int n = 0; n < frames; n++){
+                for(int f = 0; f < filters; f++)
+                    frame[f] = inputs[f][n];
+                step();
+                for(int f = 0; f < filters; f++)
+                    outputs[f][n] = frame[f];
+            }
+        }
+        
+        // Filters interleaved frames in place, with each channel through the filter of the same number.
+        // Channels beyond the number of filters pass through unchanged, and filters beyond the number
+        // of channels are fed silence.
+        void tick(stk::StkFrames& frames){
+            if(frames.frames() == 0)
+                return;
+
+            float* samples = &frames[0];
+            const int channels = (int)frames.channels(), used = std::min(channels, filters);
+            for(unsigned int n = 0; n < frames.frames(); n++, samples += channels){
+                std::copy(samples, samples + used, frame.begin());
+                std::fill(frame.begin() + used, frame.begin() + filters, 0.f);
+                step();
+                std::copy(frame.begin(), frame.begin() + used, samples);
+            }
+        }
+        
+    private:
+        enum { B0, B1, B2, A1, A2, COEFFICIENTS };
+        enum { X1, X2, Y1, Y2, STATES };
+        
+#if defined(__AVX__)
+        static const int lanes = 8;
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+        static const int lanes = 4;
+#else
+        static const int lanes = 1;
+#endif
+        
+        // Computes the next output of every filter, from the inputs in frame
+        void step(){
+            float *b0 = &coefficients[B0][0], *b1 = &coefficients[B1][0], *b2 = &coefficients[B2][0];
+            float *a1 = &coefficients[A1][0], *a2 = &coefficients[A2][0];
+            float *x1 = &states[X1][0], *x2 = &states[X2][0], *y1 = &states[Y1][0], *y2 = &states[Y2][0];
+            float* x = &frame[0];
+            
+            // The operations (and their order) of stk::BiQuad::tick()
+            for(int f = 0; f < padded; f += lanes){
+#if defined(__AVX__)
+                const __m256 in = _mm256_loadu_ps(x + f), in1 = _mm256_loadu_ps(x1 + f), out1 = _mm256_loadu_ps(y1 + f);
+                __m256 out = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(b0 + f), in), _mm256_mul_ps(_mm256_loadu_ps(b1 + f), in1)),
+                                           _mm256_mul_ps(_mm256_loadu_ps(b2 + f), _mm256_loadu_ps(x2 + f)));
+                out = _mm256_sub_ps(out, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(a2 + f), _mm256_loadu_ps(y2 + f)), _mm256_mul_ps(_mm256_loadu_ps(a1 + f), out1)));
+                _mm256_storeu_ps(x2 + f, in1);
+                _mm256_storeu_ps(x1 + f, in);
+                _mm256_storeu_ps(y2 + f, out1);
+                _mm256_storeu_ps(y1 + f, out);
+                _mm256_storeu_ps(x + f, out);
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+                const __m128 in = _mm_loadu_ps(x + f), in1 = _mm_loadu_ps(x1 + f), out1 = _mm_loadu_ps(y1 + f);
+                __m128 out = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(b0 + f), in), _mm_mul_ps(_mm_loadu_ps(b1 + f), in1)),
+                                        _mm_mul_ps(_mm_loadu_ps(b2 + f), _mm_loadu_ps(x2 + f)));
+                out = _mm_sub_ps(out, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a2 + f), _mm_loadu_ps(y2 + f)), _mm_mul_ps(_mm_loadu_ps(a1 + f), out1)));
+                _mm_storeu_ps(x2 + f, in1);
+                _mm_storeu_ps(x1 + f, in);
+                _mm_storeu_ps(y2 + f, out1);
+                _mm_storeu_ps(y1 + f, out);
+                _mm_storeu_ps(x + f, out);
+#else
+                const float out = b0[f] * x[f] + b1[f] * x1[f] + b2[f] * x2[f] - (a2[f] * y2[f] + a1[f] * y1[f]);
+                x2[f] = x1[f];
+                x1[f] = x[f];
+                y2[f] = y1[f];
+                y1[f] = out;
+                x[f] = out;
+#endif
+            }
+            
+            if(ramping){
+                for(int k = 0; k < COEFFICIENTS; k++){
+                    float* c = &coefficients[k][0];
+                    const float* increment = &increments[k][0];
+                    for(int f = 0; f < padded; f++)
+                        c[f] += increment[f];
+                }
+                rampSteps++;
+                if(--rampCountdown == 0)
+                    updateRamps();
+            }
+        }
+        
+        // Takes the steps since the last update off every ramp, finishing those that are done, and sets
+        // the countdown to the next one due to finish
+        void updateRamps(){
+            int next = 0;
+            for(int f = 0; f < filters; f++){
+                if(remaining[f] == 0)
+                    continue;
+                remaining[f] -= rampSteps;
+                if(remaining[f] <= 0){
+                    remaining[f] = 0;
+                    for(int k = 0; k < COEFFICIENTS; k++){
+                        coefficients[k][f] = targets[k][f]; // exactly, without the rounding of the steps
+                        increments[k][f] = 0.f;
+                    }
+                }else if(next == 0 || remaining[f] < next)
+                    next = remaining[f];
+            }
+            rampSteps = 0;
+            rampCountdown = next;
+            ramping = next > 0;
+        }
+        
+        int filters, padded, smoothing;
+        bool fast;
+        std::vector<float> coefficients[COEFFICIENTS];   // current values, per filter
+        std::vector<float> targets[COEFFICIENTS];        // where the ramps end
+        std::vector<float> increments[COEFFICIENTS];     // per sample, while ramping
+        std::vector<float> states[STATES];               // inputs and outputs one and two samples ago
+        std::vector<int> remaining;                      // steps left of each filter's ramp (as of the last update)
+        std::vector<float> frame;                        // the samples being filtered (padded)
+        bool ramping;
+        int rampCountdown, rampSteps;                    // steps until a ramp is due to finish, and since the last update
     };
     
     
@@ -20,6 +20,16 @@
 
 #include <vector>
 #include <string>
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+#include <cassert>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#endif
+
+#include "RealtimeAudit.h"
 
 namespace APDI
 {    
@@ -32,7 +42,7 @@ namespace APDI
             TOGGLE, // on/off switch (toggle)
             SLIDER, // linear slider (fader)
             MENU,   // drop-down list (menu)
-            METER,  // level meter (read-only: use setParameter() to set value)
+            METER,  // level meter (read-only for the host: use setParameter() to set value)
         };
     
         struct Bounds
@@ -82,6 +92,223 @@ namespace APDI
         std::vector<Parameter> parameters;
     };
 
+    // Lock-free exchange of parameter values between the host / UI thread and the audio thread.
+    // Writers call set() from any thread (wait-free: one atomic store and one atomic OR); the audio
+    // thread calls update() once per block to collect a snapshot of every value, together with a
+    // bitmask of the parameters that changed since the previous block (one 64-bit word per 64
+    // parameters, so any number of parameters is tracked).
+    //
+    // Parameter::value belongs to the host: the prebuilt host writes it directly from its UI thread
+    // (through Parameters::operator[]), so update() never writes it and only reads it with a relaxed
+    // atomic load. A parameter takes whichever source changed last: a new Parameter::value from the
+    // host, or a value from set(). The audio thread should read the snapshot (or SmoothedParameters),
+    // never Parameter::value, which does not reflect values passed to set(). The one exception is
+    // METER parameters, which the host only reads: Effect::setParameter() writes those through to
+    // Parameter::value (see storeHostValue()) so the host can display them.
+    struct ParameterStore
+    {
+        typedef unsigned long long ChangeMask; // bit (index % 64) of word (index / 64) is set when parameter [index] changed
+        
+        ParameterStore(int count = 0) : pending(count), snapshot(count, 0.f), hostValues(count, 0.f), published(words(count)), changes(words(count), 0), initialised(false) {
+            for(std::atomic<float>& value : pending)
+                value.store(0.f, std::memory_order_relaxed);
+            for(std::atomic<ChangeMask>& word : published)
+                word.store(0, std::memory_order_relaxed);
+        }
+        
+        // any thread: publish a new value for parameter [index] (0 <= index < size())
+        void set(int index, float value) {
+            assert(index >= 0 && index < size());
+            pending[index].store(value, std::memory_order_relaxed);
+            published[index >> 6].fetch_or(bit(index), std::memory_order_release);
+        }
+        
+        // audio thread: take the snapshot for the next block (parameters is only read, see above)
+        void update(const Parameters& parameters) {
+            const std::vector<Parameter>& hostParameters = parameters.get();
+            
+            for(int word = 0; word < (int)changes.size(); word++){
+                const ChangeMask updates = published[word].exchange(0, std::memory_order_acquire);
+                ChangeMask changed = initialised ? 0 : ~(ChangeMask)0;
+                const int end = std::min(size(), (word + 1) * 64);
+                for(int index = word * 64; index < end; index++){
+                    float value = snapshot[index];
+                    
+                    const float hostValue = loadHostValue(hostParameters[index].value);
+                    if(!initialised || hostValue != hostValues[index]){
+                        hostValues[index] = hostValue;
+                        value = hostValue;
+                    }
+                    if(updates & bit(index))
+                        value = pending[index].load(std::memory_order_relaxed);
+                    
+                    if(value != snapshot[index]){
+                        snapshot[index] = value;
+                        changed |= bit(index);
+                    }
+                }
+                changes[word] = changed;
+            }
+            initialised = true;
+        }
+        
+        float operator[](int index) const { return snapshot[index]; }                          // snapshot value (audio thread)
+        bool hasChanged(int index) const { return (changes[index >> 6] & bit(index)) != 0; }    // changed this block? (audio thread)
+        int size() const { return (int)snapshot.size(); }
+        
+        static ChangeMask bit(int index) { return (ChangeMask)1 << (index & 63); }             // within word (index / 64)
+        
+        // write a value to Parameter::value for the host to read (METER parameters, see above)
+        static void storeHostValue(float& target, float value) {
+#if defined(__GNUC__) || defined(__clang__)
+            __atomic_store(&target, &value, __ATOMIC_RELAXED);
+#else
+            *(volatile float*)&target = value; // aligned 32-bit writes are atomic on MSVC targets
+#endif
+        }
+        
+    private:
+        static int words(int count) { return (count + 63) / 64; }
+        
+        // read a float the host may be writing concurrently, without tearing or caching the read
+        static float loadHostValue(const float& value) {
+#if defined(__GNUC__) || defined(__clang__)
+            float result;
+            __atomic_load(&value, &result, __ATOMIC_RELAXED);
+            return result;
+#else
+            return *(const volatile float*)&value; // aligned 32-bit reads are atomic on MSVC targets
+#endif
+        }
+        
+        std::vector<std::atomic<float>> pending; // latest values from set()
+        std::vector<float> snapshot;             // values for the current block
+        std::vector<float> hostValues;           // Parameter::value as last read from the host
+        std::vector<std::atomic<ChangeMask>> published; // parameters set() since the last update()
+        std::vector<ChangeMask> changes;                // parameters that changed at the last update()
+        bool initialised;
+    };
+
+    // Per-block snapshot of the parameter values for the audio thread, with optional smoothing.
+    // update() takes the values from a ParameterStore at the start of a block; the DSP then uses the
+    // snapshot (operator[]) or the smoothed value, which glides from the previous snapshot
+    // (next() per sample, render() for a whole block, advance() for control-rate updates).
+    struct SmoothedParameters
+    {
+        enum Smoothing
+        {
+            NONE,        // jump to the new value at the start of the block
+            LINEAR,      // constant-rate ramp, reaching the new value after the smoothing time
+            EXPONENTIAL, // one-pole glide, with the smoothing time as its time constant
+        };
+        
+        SmoothedParameters(int count = 0) : states(count), sampleRate(0.f), initialised(false) { }
+        
+        // set how parameter [index] moves to new values (time in seconds)
+        void setSmoothing(int index, Smoothing type, float time) {
+            states[index].type = type;
+            states[index].time = time;
+            sampleRate = 0.f; // recalculate ramp lengths on the next update()
+        }
+        
+        // audio thread: take the snapshot for the next block (after store.update())
+        void update(const ParameterStore& store, float sampleRate) {
+            if(sampleRate != this->sampleRate){
+                this->sampleRate = sampleRate;
+                for(State& state : states){
+                    state.rampSamples = (int)(state.time * sampleRate);
+                    state.coefficient = state.rampSamples > 0 ? 1.f - expf(-1.f / (state.time * sampleRate)) : 1.f;
+                }
+            }
+            
+            for(int index = 0; index < (int)states.size(); index++){
+                if(initialised && !store.hasChanged(index))
+                    continue;
+                
+                State& state = states[index];
+                const float value = store[index];
+                
+                if(!initialised){
+                    state.current = state.target = value;
+                    state.remaining = 0;
+                }else if(value != state.target){
+                    state.target = value;
+                    if(state.type == NONE || state.rampSamples <= 0){
+                        state.current = value;
+                        state.remaining = 0;
+                    }else if(state.type == LINEAR){
+                        state.remaining = state.rampSamples;
+                        state.step = (state.target - state.current) / state.remaining;
+                    }else{
+                        state.remaining = 1; // glide until close enough to snap to the target
+                    }
+                }
+            }
+            initialised = true;
+        }
+        
+        float operator[](int index) const { return states[index].target; } // snapshot value
+        float get(int index) const { return states[index].current; }       // current smoothed value
+        bool isSmoothing(int index) const { return states[index].remaining > 0; }
+        
+        // move parameter [index] on by one sample and return its smoothed value
+        float next(int index) {
+            State& state = states[index];
+            if(state.remaining > 0){
+                if(state.type == LINEAR){
+                    state.current += state.step;
+                    if(--state.remaining == 0)
+                        state.current = state.target;
+                }else{
+                    // snap once within a tolerance relative to the target, or once the step is too
+                    // small to move the value at all (float spacing grows with the magnitude)
+                    const float previous = state.current;
+                    state.current += (state.target - state.current) * state.coefficient;
+                    if(state.current == previous || fabsf(state.target - state.current) <= 1e-6f * fmaxf(fabsf(state.target), 1.f)){
+                        state.current = state.target;
+                        state.remaining = 0;
+                    }
+                }
+            }
+            return state.current;
+        }
+        
+        // fill buffer with the next numSamples smoothed values of parameter [index]
+        void render(int index, float* buffer, int numSamples) {
+            for(int n = 0; n < numSamples; n++)
+                buffer[n] = next(index);
+        }
+        
+        // for control-rate use: return the current smoothed value and move on by numSamples
+        float advance(int index, int numSamples) {
+            const float value = states[index].current;
+            while(numSamples-- && states[index].remaining > 0)
+                next(index);
+            return value;
+        }
+        
+    private:
+        struct State
+        {
+            State() : type(NONE), time(0.f), rampSamples(0), coefficient(1.f),
+                      target(0.f), current(0.f), step(0.f), remaining(0) { }
+            
+            Smoothing type;
+            float time;
+            int rampSamples;
+            float coefficient;
+            
+            float target;
+            float current;
+            float step;
+            int remaining;
+        };
+        
+        std::vector<State> states;
+        float sampleRate;
+        bool initialised;
+    };
+
     struct Preset
     {
         Preset(const char* name, std::initializer_list<float> values) : name(name), values(values) { }
@@ -96,10 +323,47 @@ namespace APDI
         const std::vector<Preset> presets;
     };
     
+    // Switches the processor to flush denormal numbers to zero (FTZ and DAZ on x86, FZ on ARM) for
+    // as long as it is in scope, restoring the previous mode afterwards. Create one at the start of
+    // process(), so decaying feedback and reverb tails don't fall into slow denormal arithmetic.
+    class ScopedNoDenormals
+    {
+    public:
+        ScopedNoDenormals() : previous(getMode()) { setMode(previous | flushMask); }
+        ~ScopedNoDenormals() { setMode(previous); }
+
+    private:
+        ScopedNoDenormals(const ScopedNoDenormals&) = delete;
+        ScopedNoDenormals& operator=(const ScopedNoDenormals&) = delete;
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+        static const unsigned int flushMask = 0x8040; // MXCSR flush-to-zero (bit 15) and denormals-are-zero (bit 6)
+        static unsigned int getMode() { return _mm_getcsr(); }
+        static void setMode(unsigned int mode) { _mm_setcsr(mode); }
+        unsigned int previous;
+#elif defined(__aarch64__)
+        static const unsigned long long flushMask = 1ULL << 24; // FPCR flush-to-zero
+        static unsigned long long getMode() { unsigned long long mode; __asm__ __volatile__("mrs %0, fpcr" : "=r"(mode)); return mode; }
+        static void setMode(unsigned long long mode) { __asm__ __volatile__("msr fpcr, %0" : : "r"(mode)); }
+        unsigned long long previous;
+#elif defined(__arm__) && defined(__ARM_FP)
+        static const unsigned int flushMask = 1U << 24; // FPSCR flush-to-zero
+        static unsigned int getMode() { unsigned int mode; __asm__ __volatile__("vmrs %0, fpscr" : "=r"(mode)); return mode; }
+        static void setMode(unsigned int mode) { __asm__ __volatile__("vmsr fpscr, %0" : : "r"(mode)); }
+        unsigned int previous;
+#else
+        static const unsigned int flushMask = 0; // no control over denormals on this processor
+        static unsigned int getMode() { return 0; }
+        static void setMode(unsigned int) { }
+        unsigned int previous;
+#endif
+    };
+
     class Effect
     {
     public:
-        Effect(const Parameters& parameters, const Presets& presets) : parameters(parameters), presets(presets) { }
+        Effect(const Parameters& parameters, const Presets& presets)
+        : parameters(parameters), presets(presets), store((int)parameters.get().size()), smoothed((int)parameters.get().size()) { }
         virtual ~Effect() { }
         
         virtual void process(const float** inputBuffers, float** outputBuffers, int numSamples) = 0;
@@ -113,6 +377,26 @@ namespace APDI
         
         Parameters parameters;
         const Presets presets;
+        
+        // set a parameter from any thread without locking (picked up by the next updateParameters);
+        // a METER's value is also written straight to Parameter::value, for the host to display
+        void setParameter(int index, float value) {
+            store.set(index, value);
+            if(parameters.get()[index].type == Parameter::METER)
+                ParameterStore::storeHostValue(parameters[index], value);
+        }
+        
+        // call at the start of process() to take this block's snapshot of the parameters
+        void updateParameters() {
+            store.update(parameters);
+            smoothed.update(store, getSampleRate());
+        }
+        
+        // did parameter [index] change at the last updateParameters()? (skip recalculating if not)
+        bool parameterChanged(int index) const { return store.hasChanged(index); }
+        
+        ParameterStore store;        // lock-free parameter exchange (see setParameter)
+        SmoothedParameters smoothed; // per-block parameter snapshot / smoothing (see updateParameters)
     };
     
 } // namespace APDI
@@ -0,0 +1,226 @@
+//
+//  RealtimeAudit.cpp
+//  Effect & Synth Plugin Framework - Real-time Safety Audit
+//
+//  Hooks for the real-time audit (see RealtimeAudit.h), compiled only when APDI_REALTIME_AUDIT
+//  is defined. Trapped operations:
+//    - operator new / delete (all platforms)
+//    - malloc, calloc, realloc and free (glibc, through its __libc_ allocator entry points)
+//    - fopen, open, openat and pthread_mutex_lock (Linux / macOS, forwarded with dlsym(RTLD_NEXT)),
+//      and the large-file fopen64, open64 and openat64 (glibc, which std::ifstream and friends call)
+//
+
+#if defined(APDI_REALTIME_AUDIT)
+
+#include "RealtimeAudit.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if !defined(_WIN32)
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#endif
+
+namespace
+{
+    thread_local int auditDepth = 0;        // nesting of ScopedRealtimeAudit on this thread
+    thread_local bool reporting = false;    // inside the handler (don't trap what it does)
+
+    std::atomic<unsigned long> violations(0);
+    std::atomic<APDI::RealtimeAudit::Handler> handler(nullptr);
+
+    void defaultHandler(const char* operation)
+    {
+        fprintf(stderr, "APDI real-time audit: %s called inside process()\n", operation);
+        abort();
+    }
+}
+
+namespace APDI
+{
+    namespace RealtimeAudit
+    {
+        void setHandler(Handler newHandler) { handler.store(newHandler); }
+        unsigned long getViolations() { return violations.load(); }
+
+        void enter() { auditDepth++; }
+        void leave() { auditDepth--; }
+        bool isActive() { return auditDepth > 0 && !reporting; }
+
+        void check(const char* operation)
+        {
+            if(!isActive())
+                return;
+
+            reporting = true;
+            violations++;
+            Handler current = handler.load();
+            (current ? current : defaultHandler)(operation);
+            reporting = false;
+        }
+    }
+}
+
+using APDI::RealtimeAudit::check;
+
+//==============================================================================
+// HEAP ALLOCATION
+//==============================================================================
+
+#if defined(__GLIBC__)
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+    void __libc_free(void* pointer);
+
+    void* malloc(size_t size) { check("malloc"); return __libc_malloc(size); }
+    void* calloc(size_t count, size_t size) { check("calloc"); return __libc_calloc(count, size); }
+    void* realloc(void* pointer, size_t size) { check("realloc"); return __libc_realloc(pointer, size); }
+    void free(void* pointer) { if(pointer) check("free"); __libc_free(pointer); }
+}
+
+static void* allocate(size_t size) { return __libc_malloc(size ? size : 1); }
+static void release(void* pointer) { __libc_free(pointer); }
+#else
+static void* allocate(size_t size) { return std::malloc(size ? size : 1); }
+static void release(void* pointer) { std::free(pointer); }
+#endif
+
+void* operator new(std::size_t size)
+{
+    check("operator new");
+    if(void* pointer = allocate(size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    check("operator new[]");
+    if(void* pointer = allocate(size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { check("operator new"); return allocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { check("operator new[]"); return allocate(size); }
+
+void operator delete(void* pointer) noexcept { if(pointer) check("operator delete"); release(pointer); }
+void operator delete[](void* pointer) noexcept { if(pointer) check("operator delete[]"); release(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { if(pointer) check("operator delete"); release(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { if(pointer) check("operator delete[]"); release(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { if(pointer) check("operator delete"); release(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { if(pointer) check("operator delete[]"); release(pointer); }
+
+//==============================================================================
+// FILES AND LOCKS
+//==============================================================================
+
+#if !defined(_WIN32)
+
+// Finds the next definition of a hooked function (the C library's), once
+template<typename Function>
+static Function next(std::atomic<void*>& cache, const char* name)
+{
+    void* function = cache.load(std::memory_order_relaxed);
+    if(!function){
+        function = dlsym(RTLD_NEXT, name);
+        cache.store(function, std::memory_order_relaxed);
+    }
+    return (Function)function;
+}
+
+// Does an open() with these flags take a mode argument?
+static bool needsMode(int flags)
+{
+#if defined(O_TMPFILE)
+    if((flags & O_TMPFILE) == O_TMPFILE)
+        return true;
+#endif
+    return (flags & O_CREAT) != 0;
+}
+
+// Reads the optional mode argument of an open() call into mode, if its flags need one
+#define READ_MODE(flags, mode)                  \
+    if(needsMode(flags)){                       \
+        va_list args;                           \
+        va_start(args, flags);                  \
+        mode = va_arg(args, int);               \
+        va_end(args);                           \
+    }
+
+extern "C" {
+    FILE* fopen(const char* path, const char* mode)
+    {
+        static std::atomic<void*> real(nullptr);
+        check("fopen");
+        return next<FILE* (*)(const char*, const char*)>(real, "fopen")(path, mode);
+    }
+
+    int open(const char* path, int flags, ...)
+    {
+        static std::atomic<void*> real(nullptr);
+        check("open");
+
+        int mode = 0;
+        READ_MODE(flags, mode);
+        return next<int (*)(const char*, int, ...)>(real, "open")(path, flags, mode);
+    }
+
+    int openat(int directory, const char* path, int flags, ...)
+    {
+        static std::atomic<void*> real(nullptr);
+        check("openat");
+
+        int mode = 0;
+        READ_MODE(flags, mode);
+        return next<int (*)(int, const char*, int, ...)>(real, "openat")(directory, path, flags, mode);
+    }
+
+    // With _FILE_OFFSET_BITS=64 the functions above are already compiled as these
+#if defined(__GLIBC__) && !(defined(_FILE_OFFSET_BITS) && _FILE_OFFSET_BITS == 64)
+    FILE* fopen64(const char* path, const char* mode)
+    {
+        static std::atomic<void*> real(nullptr);
+        check("fopen64");
+        return next<FILE* (*)(const char*, const char*)>(real, "fopen64")(path, mode);
+    }
+
+    int open64(const char* path, int flags, ...)
+    {
+        static std::atomic<void*> real(nullptr);
+        check("open64");
+
+        int mode = 0;
+        READ_MODE(flags, mode);
+        return next<int (*)(const char*, int, ...)>(real, "open64")(path, flags, mode);
+    }
+
+    int openat64(int directory, const char* path, int flags, ...)
+    {
+        static std::atomic<void*> real(nullptr);
+        check("openat64");
+
+        int mode = 0;
+        READ_MODE(flags, mode);
+        return next<int (*)(int, const char*, int, ...)>(real, "openat64")(directory, path, flags, mode);
+    }
+#endif
+
+    int pthread_mutex_lock(pthread_mutex_t* mutex)
+    {
+        static std::atomic<void*> real(nullptr);
+        check("pthread_mutex_lock");
+        return next<int (*)(pthread_mutex_t*)>(real, "pthread_mutex_lock")(mutex);
+    }
+}
+
+#endif // !defined(_WIN32)
+
+#endif // defined(APDI_REALTIME_AUDIT)
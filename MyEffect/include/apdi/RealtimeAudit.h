@@ -0,0 +1,55 @@
+//
+//  RealtimeAudit.h
+//  Effect & Synth Plugin Framework - Real-time Safety Audit
+//
+//  In builds with APDI_REALTIME_AUDIT defined, heap allocation (operator new / delete, malloc),
+//  opening files and locking mutexes are trapped while the calling thread is inside process()
+//  (or any other code wrapped in a ScopedRealtimeAudit). Each of these can block the audio thread
+//  for an unbounded time and cause dropouts, so it should never happen while processing.
+//
+//  The hooks replace the C / C++ library functions of the program they are linked into
+//  (RealtimeAudit.cpp, compiled through include.cpp), so the audit has to be built into the
+//  executable running the effect - e.g. EffectBenchmark - not into a plugin loaded by a host.
+//  Without APDI_REALTIME_AUDIT, ScopedRealtimeAudit does nothing and nothing is hooked.
+//
+
+#pragma once
+
+namespace APDI
+{
+#if defined(APDI_REALTIME_AUDIT)
+    namespace RealtimeAudit
+    {
+        // Called for each violation (with the audit suspended, so it is free to allocate or print).
+        // The default handler prints the operation and aborts.
+        typedef void (*Handler)(const char* operation);
+
+        void setHandler(Handler handler);   // nullptr restores the default handler
+        unsigned long getViolations();      // violations so far (all threads)
+
+        void enter();                       // start / stop trapping on the calling thread
+        void leave();
+        bool isActive();                    // is the calling thread being audited?
+
+        void check(const char* operation);  // report a violation if the calling thread is being audited
+    }
+#endif
+
+    // Traps real-time violations on this thread for as long as it is in scope (audit builds only).
+    // Create one at the start of process(); they can be nested.
+    class ScopedRealtimeAudit
+    {
+    public:
+#if defined(APDI_REALTIME_AUDIT)
+        ScopedRealtimeAudit() { RealtimeAudit::enter(); }
+        ~ScopedRealtimeAudit() { RealtimeAudit::leave(); }
+#else
+        ScopedRealtimeAudit() { }
+#endif
+
+    private:
+        ScopedRealtimeAudit(const ScopedRealtimeAudit&) = delete;
+        ScopedRealtimeAudit& operator=(const ScopedRealtimeAudit&) = delete;
+    };
+
+} // namespace APDI
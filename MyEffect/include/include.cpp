@@ -70,18 +70,23 @@
 #include "stk/Brass.cpp"
 #include "stk/Chorus.cpp"
 #include "stk/Clarinet.cpp"
+#include "stk/ConvRev.cpp"
 #include "stk/Delay.cpp"
 #include "stk/DelayA.cpp"
 #include "stk/DelayL.cpp"
 #include "stk/Drummer.cpp"
 #include "stk/Echo.cpp"
 #include "stk/Envelope.cpp"
+#include "stk/FFT.cpp"
 #include "stk/FileLoop.cpp"
 #include "stk/FileRead.cpp"
+#include "stk/FileStream.cpp"
 #include "stk/FileWrite.cpp"
+#include "stk/FileWriteQueue.cpp"
 #include "stk/FileWvIn.cpp"
 #include "stk/FileWvOut.cpp"
 #include "stk/Fir.cpp"
+#include "stk/FreeVerb.cpp"
 #include "stk/Flute.cpp"
 #include "stk/FM.cpp"
 #include "stk/FMVoices.cpp"
@@ -93,6 +98,7 @@
 #include "stk/LentPitShift.cpp"
 #include "stk/Mandolin.cpp"
 #include "stk/Mesh2D.cpp"
+#include "stk/MessageQueue.cpp"
 #include "stk/MidiFileIn.cpp"
 #include "stk/Modal.cpp"
 #include "stk/ModalBar.cpp"
@@ -110,8 +116,11 @@
 #include "stk/PRCRev.cpp"
 #include "stk/Resonate.cpp"
 #include "stk/Rhodey.cpp"
+#include "stk/SampleCache.cpp"
+#include "stk/SampleConvert.cpp"
 #include "stk/Sampler.cpp"
 #include "stk/Saxofony.cpp"
+#include "stk/Semaphore.cpp"
 #include "stk/Shakers.cpp"
 #include "stk/Simple.cpp"
 #include "stk/SineWave.cpp"
@@ -139,3 +148,6 @@
 #ifdef __clang__
  #pragma pop // -Wtautological-compare
 #endif
+
+// APDI framework sources (empty unless enabled, see RealtimeAudit.h)
+#include "apdi/RealtimeAudit.cpp"
@@ -73,6 +73,7 @@
 #include "stk/Brass.h"
 #include "stk/Chorus.h"
 #include "stk/Clarinet.h"
+#include "stk/ConvRev.h"
 #include "stk/Cubic.h"
 #include "stk/Delay.h"
 #include "stk/DelayA.h"
@@ -81,13 +82,17 @@
 #include "stk/Echo.h"
 #include "stk/Effect.h"
 #include "stk/Envelope.h"
+#include "stk/FFT.h"
 #include "stk/FileLoop.h"
 #include "stk/FileRead.h"
+#include "stk/FileStream.h"
 #include "stk/FileWrite.h"
+#include "stk/FileWriteQueue.h"
 #include "stk/FileWvIn.h"
 #include "stk/FileWvOut.h"
 #include "stk/Filter.h"
 #include "stk/Fir.h"
+#include "stk/FreeVerb.h"
 #include "stk/Flute.h"
 #include "stk/FM.h"
 #include "stk/FMVoices.h"
@@ -103,6 +108,7 @@
 #include "stk/LentPitShift.h"
 #include "stk/Mandolin.h"
 #include "stk/Mesh2D.h"
+#include "stk/MessageQueue.h"
 #include "stk/MidiFileIn.h"
 #include "stk/Modal.h"
 #include "stk/ModalBar.h"
@@ -121,8 +127,11 @@
 #include "stk/ReedTable.h"
 #include "stk/Resonate.h"
 #include "stk/Rhodey.h"
+#include "stk/SampleCache.h"
+#include "stk/SampleConvert.h"
 #include "stk/Sampler.h"
 #include "stk/Saxofony.h"
+#include "stk/Semaphore.h"
 #include "stk/Shakers.h"
 #include "stk/Simple.h"
 #include "stk/SineWave.h"
@@ -0,0 +1,298 @@
+/***************************************************/
+/*! \class ConvRev
+    \brief STK convolution reverberator class.
+
+    This class takes a monophonic input signal and produces a stereo
+    output signal by convolving it with an impulse response, using a
+    zero-latency partitioned convolution: a directly computed head,
+    block-sized FFT partitions and longer late FFT partitions, which
+    may be computed on a worker thread.
+*/
+/***************************************************/
+
+#include "ConvRev.h"
+#include "FileRead.h"
+#include <algorithm>
+#include <cstring>
+
+namespace stk {
+
+ConvRev :: ConvRev( std::string fileName, unsigned int blockSize )
+  : channels_(1), impulseLength_(0), position_(0), hasHead_(false), nEarly_(0), earlyIndex_(0),
+    nLate_(0), lateIndex_(0), lateSize_(0), lateFill_(0), lateBusy_(false), quitWorker_(false)
+{
+  blockSize_ = 16;
+  while ( blockSize_ < blockSize ) blockSize_ <<= 1;
+
+  lastFrame_.resize( 1, 2, 0.0 ); // resize lastFrame_ for stereo output
+  effectMix_ = 0.3;
+  useWorker_ = std::thread::hardware_concurrency() > 1;
+
+  if ( !fileName.empty() ) this->loadImpulse( fileName );
+}
+
+ConvRev :: ~ConvRev( void )
+{
+  this->stopWorker();
+}
+
+void ConvRev :: loadImpulse( std::string fileName, bool raw )
+{
+  // Attempt to open the file ... an error might be thrown here.
+  FileRead file( fileName, raw );
+  StkFrames data( file.fileSize(), file.channels() );
+  file.read( data );
+  StkFloat rate = file.fileRate() / Stk::sampleRate();
+  file.close();
+
+  unsigned int i, nChannels = ( data.channels() > 1 ) ? 2 : 1;
+  unsigned long j, length = data.frames();
+  if ( rate != 1.0 && length > 0 ) length = (unsigned long) ( ( length - 1 ) / rate ) + 1;
+
+  // Keep the first two channels, resampled (by linear interpolation) to the current sample rate.
+  StkFrames impulse( length, nChannels );
+  for ( j=0; j<length; j++ ) {
+    for ( i=0; i<nChannels; i++ )
+      impulse( j, i ) = ( rate == 1.0 ) ? data( j, i ) : data.interpolate( j * rate, i );
+  }
+
+  this->setImpulse( impulse );
+}
+
+void ConvRev :: setImpulse( const StkFrames& impulse )
+{
+  this->stopWorker();
+
+  channels_ = ( impulse.channels() > 1 ) ? 2 : 1;
+  impulseLength_ = impulse.frames();
+  lateSize_ = blockSize_ * LATE_RATIO;
+
+  // The response is split into the head [0, B), the early partitions [B, 2L) and the late
+  // partitions [2L, end), where B is the block size and L the late block size.
+  unsigned long i, k, c, headLength = ( impulseLength_ < blockSize_ ) ? impulseLength_ : blockSize_;
+  unsigned long earlyEnd = ( impulseLength_ < 2 * lateSize_ ) ? impulseLength_ : 2 * lateSize_;
+  hasHead_ = headLength > 0;
+  nEarly_ = ( earlyEnd > blockSize_ ) ? ( earlyEnd - blockSize_ + blockSize_ - 1 ) / blockSize_ : 0;
+  nLate_ = ( impulseLength_ > 2 * lateSize_ ) ? ( impulseLength_ - 2 * lateSize_ + lateSize_ - 1 ) / lateSize_ : 0;
+
+  for ( c=0; c<channels_; c++ ) {
+    std::vector<StkFloat> coefficients( hasHead_ ? headLength : 1, 0.0 );
+    for ( i=0; i<headLength; i++ ) coefficients[i] = impulse( i, c );
+    head_[c].setCoefficients( coefficients, true );
+  }
+
+  // The spectra of the partitions, each zero-padded to twice its length.
+  unsigned int size = 2 * blockSize_;
+  earlyFilters_.assign( channels_ * nEarly_ * size, 0.0 );
+  if ( nEarly_ ) earlyFft_.setSize( size );
+  for ( c=0; c<channels_; c++ ) {
+    for ( k=0; k<nEarly_; k++ ) {
+      StkFloat *filter = &earlyFilters_[( c * nEarly_ + k ) * size];
+      unsigned long start = blockSize_ + k * blockSize_;
+      for ( i=0; i<blockSize_ && start+i<earlyEnd; i++ ) filter[i] = impulse( start + i, c );
+      earlyFft_.forward( filter, filter );
+    }
+  }
+
+  earlyWindow_.resize( size );
+  earlySpectra_.resize( nEarly_ * size );
+  earlySum_.resize( size );
+  earlyOutput_.resize( 2 * blockSize_ );
+
+  size = 2 * lateSize_;
+  lateFilters_.assign( channels_ * nLate_ * size, 0.0 );
+  if ( nLate_ ) lateFft_.setSize( size );
+  for ( c=0; c<channels_; c++ ) {
+    for ( k=0; k<nLate_; k++ ) {
+      StkFloat *filter = &lateFilters_[( c * nLate_ + k ) * size];
+      unsigned long start = 2 * lateSize_ + k * lateSize_;
+      for ( i=0; i<lateSize_ && start+i<impulseLength_; i++ ) filter[i] = impulse( start + i, c );
+      lateFft_.forward( filter, filter );
+    }
+  }
+
+  lateWindow_.resize( nLate_ ? size : 0 );
+  lateInput_.resize( nLate_ ? size : 0 );
+  lateSpectra_.resize( nLate_ * size );
+  lateSum_.resize( nLate_ ? size : 0 );
+  lateOutput_.resize( nLate_ ? 2 * lateSize_ : 0 );
+  lateResult_.resize( nLate_ ? 2 * lateSize_ : 0 );
+
+  this->clear();
+  if ( useWorker_ ) this->startWorker();
+}
+
+void ConvRev :: clear( void )
+{
+  this->waitForLate();
+
+  for ( unsigned int i=0; i<2; i++ ) head_[i].clear();
+  std::fill( earlyWindow_.begin(), earlyWindow_.end(), 0.0 );
+  std::fill( earlySpectra_.begin(), earlySpectra_.end(), 0.0 );
+  std::fill( earlyOutput_.begin(), earlyOutput_.end(), 0.0 );
+  std::fill( lateWindow_.begin(), lateWindow_.end(), 0.0 );
+  std::fill( lateSpectra_.begin(), lateSpectra_.end(), 0.0 );
+  std::fill( lateOutput_.begin(), lateOutput_.end(), 0.0 );
+  std::fill( lateResult_.begin(), lateResult_.end(), 0.0 );
+
+  position_ = 0;
+  earlyIndex_ = 0;
+  lateIndex_ = 0;
+  lateFill_ = 0;
+  lastFrame_[0] = 0.0;
+  lastFrame_[1] = 0.0;
+}
+
+void ConvRev :: setWorkerThread( bool enable )
+{
+  useWorker_ = enable;
+  if ( useWorker_ ) this->startWorker();
+  else this->stopWorker();
+}
+
+void ConvRev :: endBlock( void )
+{
+  // Uniformly partitioned overlap-save: the spectrum of the last two blocks of input joins the
+  // spectra of the previous blocks, each multiplied by the partition as far into the response.
+  // The second half of the result is the early partitions' output for the next block.
+  unsigned int i, k, size = 2 * blockSize_;
+  earlyIndex_ = ( earlyIndex_ + 1 ) % nEarly_;
+  earlyFft_.forward( &earlyWindow_[0], &earlySpectra_[earlyIndex_ * size] );
+
+  StkFloat *sum = &earlySum_[0];
+  for ( i=0; i<channels_; i++ ) {
+    memset( sum, 0, size * sizeof( StkFloat ) );
+    for ( k=0; k<nEarly_; k++ ) {
+      unsigned int index = ( earlyIndex_ + nEarly_ - k ) % nEarly_;
+      FFT::multiplyAccumulate( sum, &earlySpectra_[index * size], &earlyFilters_[( i * nEarly_ + k ) * size], size );
+    }
+    earlyFft_.inverse( sum, sum );
+    memcpy( &earlyOutput_[i * blockSize_], sum + blockSize_, blockSize_ * sizeof( StkFloat ) );
+  }
+
+  if ( nLate_ ) {
+    memcpy( &lateWindow_[lateSize_ + lateFill_], &earlyWindow_[blockSize_], blockSize_ * sizeof( StkFloat ) );
+    lateFill_ += blockSize_;
+    if ( lateFill_ == lateSize_ ) {
+      this->startLate();
+      lateFill_ = 0;
+    }
+  }
+
+  memcpy( &earlyWindow_[0], &earlyWindow_[blockSize_], blockSize_ * sizeof( StkFloat ) );
+  position_ = 0;
+}
+
+void ConvRev :: startLate( void )
+{
+  // The result of the job started a late block ago is due now.  The new job's result is not
+  // needed until the next late block, as the late partitions start two late blocks in.
+  this->waitForLate();
+  lateOutput_.swap( lateResult_ );
+
+  memcpy( &lateInput_[0], &lateWindow_[0], 2 * lateSize_ * sizeof( StkFloat ) );
+  memcpy( &lateWindow_[0], &lateWindow_[lateSize_], lateSize_ * sizeof( StkFloat ) );
+
+  if ( worker_.joinable() ) {
+    lateBusy_.store( true, std::memory_order_release );
+    workerWake_.post(); // never locks
+  }
+  else this->computeLate();
+}
+
+void ConvRev :: computeLate( void )
+{
+  unsigned int i, k, size = 2 * lateSize_;
+  lateIndex_ = ( lateIndex_ + 1 ) % nLate_;
+  lateFft_.forward( &lateInput_[0], &lateSpectra_[lateIndex_ * size] );
+
+  StkFloat *sum = &lateSum_[0];
+  for ( i=0; i<channels_; i++ ) {
+    memset( sum, 0, size * sizeof( StkFloat ) );
+    for ( k=0; k<nLate_; k++ ) {
+      unsigned int index = ( lateIndex_ + nLate_ - k ) % nLate_;
+      FFT::multiplyAccumulate( sum, &lateSpectra_[index * size], &lateFilters_[( i * nLate_ + k ) * size], size );
+    }
+    lateFft_.inverse( sum, sum );
+    memcpy( &lateResult_[i * lateSize_], sum + lateSize_, lateSize_ * sizeof( StkFloat ) );
+  }
+}
+
+void ConvRev :: waitForLate( void )
+{
+  while ( lateBusy_.load( std::memory_order_acquire ) )
+    std::this_thread::yield();
+}
+
+void ConvRev :: startWorker( void )
+{
+  if ( worker_.joinable() || nLate_ == 0 ) return;
+
+  quitWorker_.store( false );
+  worker_ = std::thread( &ConvRev::runWorker, this );
+}
+
+void ConvRev :: stopWorker( void )
+{
+  if ( !worker_.joinable() ) return;
+
+  this->waitForLate();
+  quitWorker_.store( true );
+  workerWake_.post();
+  worker_.join();
+}
+
+void ConvRev :: runWorker( void )
+{
+  while ( true ) {
+    // Sleep until a job is started or the worker is stopped (each posts once, so no timeout).
+    workerWake_.wait();
+    if ( quitWorker_.load() ) break;
+
+    if ( lateBusy_.load( std::memory_order_acquire ) ) {
+      this->computeLate();
+      lateBusy_.store( false, std::memory_order_release );
+    }
+  }
+}
+
+StkFrames& ConvRev :: tick( StkFrames& frames, unsigned int channel )
+{
+#if defined(_STK_DEBUG_)
+  if ( channel >= frames.channels() - 1 ) {
+    oStream_ << "ConvRev::tick(): channel and StkFrames arguments are incompatible!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  StkFloat *samples = &frames[channel];
+  unsigned int hop = frames.channels();
+  for ( unsigned int i=0; i<frames.frames(); i++, samples += hop ) {
+    *samples = tick( *samples );
+    *(samples+1) = lastFrame_[1];
+  }
+
+  return frames;
+}
+
+StkFrames& ConvRev :: tick( StkFrames& iFrames, StkFrames& oFrames, unsigned int iChannel, unsigned int oChannel )
+{
+#if defined(_STK_DEBUG_)
+  if ( iChannel >= iFrames.channels() || oChannel >= oFrames.channels() - 1 ) {
+    oStream_ << "ConvRev::tick(): channel and StkFrames arguments are incompatible!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  StkFloat *iSamples = &iFrames[iChannel];
+  StkFloat *oSamples = &oFrames[oChannel];
+  unsigned int iHop = iFrames.channels(), oHop = oFrames.channels();
+  for ( unsigned int i=0; i<iFrames.frames(); i++, iSamples += iHop, oSamples += oHop ) {
+    *oSamples = tick( *iSamples );
+    *(oSamples+1) = lastFrame_[1];
+  }
+
+  return iFrames;
+}
+
+} // stk namespace
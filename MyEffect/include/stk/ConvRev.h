@@ -0,0 +1,219 @@
+#ifndef STK_CONVREV_H
+#define STK_CONVREV_H
+
+#include "Effect.h"
+#include "FFT.h"
+#include "Fir.h"
+#include "Semaphore.h"
+#include <atomic>
+#include <thread>
+
+namespace stk {
+
+/***************************************************/
+/*! \class ConvRev
+    \brief STK convolution reverberator class.
+
+    This class takes a monophonic input signal and produces a stereo
+    output signal by convolving it with a measured (or designed)
+    impulse response, mono or stereo, loaded from an audio file with
+    FileRead.
+
+    The convolution is partitioned so that impulse responses of
+    several seconds run in real time without adding latency.  The
+    first block of the response (64 samples by default) is computed
+    directly, sample by sample.  The rest of the response, up to 32
+    blocks in, is split into block-sized partitions computed by FFT
+    once per block.  The remainder is split into partitions 16 times
+    as long, computed by FFT once per 16 blocks, from inputs that are
+    a whole late block old by the time their outputs are due.  That
+    work can therefore be done on a worker thread (the default on
+    processors with more than one core), which keeps the load on the
+    audio thread small and even.  The audio thread only waits for the
+    worker if it has fallen a whole late block behind.  Without the
+    worker thread, the late partitions are computed on the audio
+    thread every 16 blocks.  Either way the output is the same.
+
+    Setting the impulse response allocates memory (and may start the
+    worker thread), so it should not be done on the audio thread.
+*/
+/***************************************************/
+
+class ConvRev : public Effect
+{
+ public:
+  //! Class constructor, taking the name of an impulse response file (or none) and the direct block size.
+  /*!
+    The block size is rounded up to a power of two of at least 16.
+    An StkError is thrown if the file cannot be opened or read.
+  */
+  ConvRev( std::string fileName = "", unsigned int blockSize = 64 );
+
+  //! Class destructor.
+  ~ConvRev( void );
+
+  //! Reset and clear all internal state.
+  void clear( void );
+
+  //! Load an impulse response from an audio file (its first two channels), resampled to the current sample rate if needed.
+  /*!
+    If \e raw is true, the file is read as an STK raw file.  An
+    StkError is thrown if the file cannot be opened or read.
+  */
+  void loadImpulse( std::string fileName, bool raw = false );
+
+  //! Set the impulse response (one or two channels of the StkFrames argument, at the current sample rate).
+  /*!
+    The internal state is cleared.
+  */
+  void setImpulse( const StkFrames& impulse );
+
+  //! Return the length of the impulse response in sample frames.
+  unsigned long getImpulseLength( void ) const { return impulseLength_; };
+
+  //! Compute the late partitions on a worker thread (true) or on the audio thread (false).
+  void setWorkerThread( bool enable );
+
+  //! Return the specified channel value of the last computed stereo frame.
+  /*!
+    Use the lastFrame() function to get both values of the last
+    computed stereo frame.  The \c channel argument must be 0 or 1
+    (the first channel is specified by 0).  However, range checking is
+    only performed if _STK_DEBUG_ is defined during compilation, in
+    which case an out-of-range value will trigger an StkError
+    exception.
+  */
+  StkFloat lastOut( unsigned int channel = 0 );
+
+  //! Input one sample to the effect and return the specified \c channel value of the computed stereo frame.
+  /*!
+    Use the lastFrame() function to get both values of the computed
+    stereo output frame. The \c channel argument must be 0 or 1 (the
+    first channel is specified by 0).  However, range checking is only
+    performed if _STK_DEBUG_ is defined during compilation, in which
+    case an out-of-range value will trigger an StkError exception.
+  */
+  StkFloat tick( StkFloat input, unsigned int channel = 0 );
+
+  //! Take a channel of the StkFrames object as inputs to the effect and replace with stereo outputs.
+  /*!
+    The StkFrames argument reference is returned.  The stereo
+    outputs are written to the StkFrames argument starting at the
+    specified \c channel.  Therefore, the \c channel argument must be
+    less than ( channels() - 1 ) of the StkFrames argument (the first
+    channel is specified by 0).  However, range checking is only
+    performed if _STK_DEBUG_ is defined during compilation, in which
+    case an out-of-range value will trigger an StkError exception.
+  */
+  StkFrames& tick( StkFrames& frames, unsigned int channel = 0 );
+
+  //! Take a channel of the \c iFrames object as inputs to the effect and write stereo outputs to the \c oFrames object.
+  /*!
+    The \c iFrames object reference is returned.  The \c iChannel
+    argument must be less than the number of channels in the \c
+    iFrames argument (the first channel is specified by 0).  The \c
+    oChannel argument must be less than ( channels() - 1 ) of the \c
+    oFrames argument.  However, range checking is only performed if
+    _STK_DEBUG_ is defined during compilation, in which case an
+    out-of-range value will trigger an StkError exception.
+  */
+  StkFrames& tick( StkFrames& iFrames, StkFrames &oFrames, unsigned int iChannel = 0, unsigned int oChannel = 0 );
+
+ protected:
+
+  // Late partitions are this many times as long as the early ones.
+  static const unsigned int LATE_RATIO = 16;
+
+  // Compute the outputs of the early partitions for the next block (and start the late ones).
+  void endBlock( void );
+  void startLate( void );
+  void computeLate( void );
+  void waitForLate( void );
+  void startWorker( void );
+  void stopWorker( void );
+  void runWorker( void );
+
+  unsigned int blockSize_;
+  unsigned int channels_;               // impulse response channels (1 or 2)
+  unsigned long impulseLength_;
+  unsigned int position_;               // position in the current block
+
+  // The head of the response, computed directly.
+  Fir head_[2];
+  bool hasHead_;
+
+  // Early partitions: block-sized, one FFT of two blocks of input per block.
+  unsigned int nEarly_;
+  unsigned int earlyIndex_;             // newest spectrum in earlySpectra_
+  FFT earlyFft_;
+  std::vector<StkFloat> earlyWindow_;   // the last two blocks of input
+  std::vector<StkFloat> earlySpectra_;  // their spectra, for the last nEarly_ blocks
+  std::vector<StkFloat> earlyFilters_;  // the partitions' spectra (for each channel)
+  std::vector<StkFloat> earlySum_;
+  std::vector<StkFloat> earlyOutput_;   // the outputs for the current block (for each channel)
+
+  // Late partitions: LATE_RATIO blocks long, computed a late block ahead (perhaps by the worker thread).
+  unsigned int nLate_;
+  unsigned int lateIndex_;
+  unsigned int lateSize_;               // blockSize_ * LATE_RATIO
+  unsigned int lateFill_;               // inputs of the current late block so far
+  FFT lateFft_;
+  std::vector<StkFloat> lateWindow_;    // the last two late blocks of input
+  std::vector<StkFloat> lateInput_;     // the window being computed
+  std::vector<StkFloat> lateSpectra_;
+  std::vector<StkFloat> lateFilters_;
+  std::vector<StkFloat> lateSum_;
+  std::vector<StkFloat> lateOutput_;    // the outputs for the current late block
+  std::vector<StkFloat> lateResult_;    // the outputs for the next one, being computed
+
+  bool useWorker_;
+  std::thread worker_;
+  Semaphore workerWake_;                // posted once per job (and to stop the worker)
+  std::atomic<bool> lateBusy_;          // set by the audio thread, cleared when the job is done
+  std::atomic<bool> quitWorker_;
+};
+
+inline StkFloat ConvRev :: lastOut( unsigned int channel )
+{
+#if defined(_STK_DEBUG_)
+  if ( channel > 1 ) {
+    oStream_ << "ConvRev::lastOut(): channel argument must be less than 2!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  return lastFrame_[channel];
+}
+
+inline StkFloat ConvRev :: tick( StkFloat input, unsigned int channel )
+{
+#if defined(_STK_DEBUG_)
+  if ( channel > 1 ) {
+    oStream_ << "ConvRev::tick(): channel argument must be less than 2!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  StkFloat wet[2] = { 0.0, 0.0 };
+  for ( unsigned int i=0; i<channels_; i++ ) {
+    if ( hasHead_ ) wet[i] = head_[i].tick( input );
+    if ( nEarly_ ) wet[i] += earlyOutput_[i * blockSize_ + position_];
+    if ( nLate_ ) wet[i] += lateOutput_[i * lateSize_ + lateFill_ + position_];
+  }
+  if ( channels_ == 1 ) wet[1] = wet[0];
+
+  if ( nEarly_ ) {
+    earlyWindow_[blockSize_ + position_] = input;
+    if ( ++position_ == blockSize_ ) this->endBlock();
+  }
+
+  StkFloat dry = ( 1.0 - effectMix_ ) * input;
+  lastFrame_[0] = effectMix_ * wet[0] + dry;
+  lastFrame_[1] = effectMix_ * wet[1] + dry;
+
+  return lastFrame_[channel];
+}
+
+} // stk namespace
+
+#endif
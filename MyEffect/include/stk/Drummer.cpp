@@ -11,11 +11,17 @@
     of simultaneous voices) via a #define in the
     Drummer.h.
 
+    The whole kit is loaded into memory when the
+    instrument is created, so noteOn() does no file
+    access.  Other kits can be loaded in the
+    background with loadKit().
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
 
 #include "Drummer.h"
+#include "SampleCache.h"
 #include <cmath>
 
 namespace stk {
@@ -55,16 +61,108 @@ char waveNames[DRUM_NUMWAVES][16] =
     "tambourn.raw"
   };
 
-Drummer :: Drummer( void ) : Instrmnt()
+Drummer :: Drummer( void )
+  : Instrmnt(), kitState_(KIT_NONE), loading_(false), kitFailed_(false)
 {
   // This counts the number of sounding voices.
   nSounding_ = 0;
   soundOrder_ = std::vector<int> (DRUM_POLYPHONY, -1);
   soundNumber_ = std::vector<int> (DRUM_POLYPHONY, -1);
+
+  // Load the default kit ... an error might be thrown here.
+  kit_ = readKit( Stk::rawwavePath() );
+
+  // Give each voice some data, so that noteOn() never allocates.
+  for ( int i=0; i<DRUM_POLYPHONY; i++ )
+    waves_[i].openData( kit_->waves[0] );
 }
 
 Drummer :: ~Drummer( void )
 {
+  if ( loader_.joinable() ) loader_.join();
+}
+
+std::shared_ptr<Drummer::DrumKit> Drummer :: readKit( std::string directory )
+{
+  std::shared_ptr<DrumKit> kit( new DrumKit );
+  for ( int i=0; i<DRUM_NUMWAVES; i++ )
+    kit->waves[i] = SampleCache::load( directory + waveNames[i], true );
+  return kit;
+}
+
+void Drummer :: loadKit( std::string directory )
+{
+  if ( loader_.joinable() ) loader_.join();
+  reclaimKits();
+
+  if ( !directory.empty() && directory[directory.size()-1] != '/' && directory[directory.size()-1] != '\\' )
+    directory += '/';
+
+  kitFailed_.store( false );
+  loading_.store( true );
+  loader_ = std::thread( &Drummer::runLoader, this, directory );
+}
+
+bool Drummer :: isLoadingKit( void ) const
+{
+  return loading_.load() || kitState_.load() != KIT_NONE;
+}
+
+void Drummer :: runLoader( std::string directory )
+{
+  std::shared_ptr<DrumKit> kit;
+  try {
+    kit = readKit( directory );
+  }
+  catch ( StkError & ) {
+    kitFailed_.store( true );
+    loading_.store( false );
+    return;
+  }
+
+  // The state is KIT_NONE here, so noteOn() does not touch nextKit_.
+  nextKit_ = kit;
+  kitState_.store( KIT_READY, std::memory_order_release );
+  loading_.store( false );
+}
+
+// Called with no loader running.  Withdraws a kit not yet put in use
+// and releases the replaced kits that no voice can still be playing.
+// A wave held only by the kit being released and by voices is kept,
+// so that the voices never free it on the audio thread.
+void Drummer :: reclaimKits( void )
+{
+  int state = KIT_READY;
+  while ( !kitState_.compare_exchange_weak( state, KIT_NONE ) ) {
+    if ( state == KIT_NONE ) break;
+    state = KIT_READY; // noteOn() is swapping the kit in
+    std::this_thread::yield();
+  }
+
+  // From here on noteOn() does not touch kit_ or nextKit_.
+  if ( nextKit_ ) {
+    oldKits_.push_back( nextKit_ );
+    nextKit_.reset();
+  }
+
+  size_t k = 0;
+  while ( k < oldKits_.size() ) {
+    bool inUse = false;
+    for ( int i=0; i<DRUM_NUMWAVES && !inUse; i++ ) {
+      const StkFrames *wave = oldKits_[k]->waves[i].get();
+      long owners = 0;
+      bool current = false;
+      for ( int j=0; j<DRUM_NUMWAVES; j++ )
+        if ( kit_->waves[j].get() == wave ) current = true;
+      for ( size_t m=0; m<oldKits_.size(); m++ )
+        for ( int j=0; j<DRUM_NUMWAVES; j++ )
+          if ( oldKits_[m]->waves[j].get() == wave ) owners++;
+      if ( !current && oldKits_[k]->waves[i].use_count() > owners ) inUse = true;
+    }
+
+    if ( inUse ) k++;
+    else oldKits_.erase( oldKits_.begin() + k );
+  }
 }
 
 void Drummer :: noteOn( StkFloat instrument, StkFloat amplitude )
@@ -74,6 +172,15 @@ void Drummer :: noteOn( StkFloat instrument, StkFloat amplitude )
     handleError( StkError::WARNING ); return;
   }
 
+  // Put a kit loaded in the background in use.  The replaced kit is
+  // left in nextKit_, to be released off the audio thread by loadKit().
+  int state = KIT_READY;
+  if ( kitState_.compare_exchange_strong( state, KIT_TAKING, std::memory_order_acquire ) ) {
+    kit_.swap( nextKit_ );
+    kitState_.store( KIT_NONE, std::memory_order_release );
+    for ( int i=0; i<DRUM_POLYPHONY; i++ ) soundNumber_[i] = -1;
+  }
+
   // Yes, this is tres kludgey.
   int noteNumber = (int) ( ( 12 * log( instrument / 220.0 ) / log( 2.0 ) ) + 57.01 );
 
@@ -113,10 +220,8 @@ void Drummer :: noteOn( StkFloat instrument, StkFloat amplitude )
     soundNumber_[iWave] = noteNumber;
     //std::cout << "iWave = " << iWave << ", nSounding = " << nSounding_ << ", soundOrder[] = " << soundOrder_[iWave] << std::endl;
 
-    // Concatenate the STK rawwave path to the rawwave file
-    waves_[iWave].openFile( (Stk::rawwavePath() + waveNames[ genMIDIMap[ noteNumber ] ]).c_str(), true );
-    if ( Stk::sampleRate() != 22050.0 )
-      waves_[iWave].setRate( 22050.0 / Stk::sampleRate() );
+    // Play the preloaded wave (its rate is set for the current sample rate).
+    waves_[iWave].openData( kit_->waves[ genMIDIMap[ noteNumber ] ] );
     filters_[iWave].setPole( 0.999 - (amplitude * 0.6) );
     filters_[iWave].setGain( amplitude );
   }
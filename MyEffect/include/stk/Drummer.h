@@ -4,6 +4,9 @@
 #include "Instrmnt.h"
 #include "FileWvIn.h"
 #include "OnePole.h"
+#include <atomic>
+#include <memory>
+#include <thread>
 
 namespace stk {
 
@@ -23,6 +26,12 @@ const int DRUM_POLYPHONY = 4;
     of simultaneous voices) via a #define in the
     Drummer.h.
 
+    The whole kit is loaded into memory (and shared through the
+    SampleCache) when the instrument is created, so noteOn() does no
+    file access or memory allocation and can be called from an audio
+    thread.  Another kit, with the same file names, can be loaded
+    from a directory in the background with loadKit().
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -39,12 +48,28 @@ class Drummer : public Instrmnt
   //! Class destructor.
   ~Drummer( void );
 
+  //! Start loading the kit in \e directory on a background thread.
+  /*!
+    The directory must hold the same raw files as the STK rawwave
+    directory.  The kit is put in use at the first noteOn() after
+    it has been loaded; voices already sounding finish with the old
+    kit.  If a file cannot be read, the current kit is kept and
+    kitLoadFailed() returns true.  A load still in progress is
+    completed first.
+  */
+  void loadKit( std::string directory );
+
+  //! Returns true while a kit is being loaded, or is loaded but not yet in use.
+  bool isLoadingKit( void ) const;
+
+  //! Returns true if the last loadKit() failed.
+  bool kitLoadFailed( void ) const { return kitFailed_.load(); };
+
   //! Start a note with the given drum type and amplitude.
   /*!
     Use general MIDI drum instrument numbers, converted to
     frequency values as if MIDI note numbers, to select a particular
-    instrument.  An StkError will be thrown if the rawwave path is
-    incorrectly set.
+    instrument.
   */
   void noteOn( StkFloat instrument, StkFloat amplitude );
 
@@ -66,6 +91,29 @@ class Drummer : public Instrmnt
 
  protected:
 
+  struct DrumKit {
+    std::shared_ptr<const StkFrames> waves[DRUM_NUMWAVES];
+  };
+
+  // States of a kit loaded in the background.
+  enum KitState {
+    KIT_NONE,     // nothing pending
+    KIT_READY,    // nextKit_ holds a kit for noteOn() to put in use
+    KIT_TAKING    // noteOn() is swapping nextKit_ in
+  };
+
+  static std::shared_ptr<DrumKit> readKit( std::string directory );
+  void runLoader( std::string directory );
+  void reclaimKits( void );
+
+  std::shared_ptr<DrumKit> kit_;      // the kit in use (audio thread)
+  std::shared_ptr<DrumKit> nextKit_;  // loaded kit waiting, or the replaced kit after a swap
+  std::vector< std::shared_ptr<DrumKit> > oldKits_; // replaced kits still heard by a voice
+  std::atomic<int> kitState_;
+  std::atomic<bool> loading_;
+  std::atomic<bool> kitFailed_;
+  std::thread loader_;
+
   FileWvIn waves_[DRUM_POLYPHONY];
   OnePole  filters_[DRUM_POLYPHONY];
   std::vector<int> soundOrder_;
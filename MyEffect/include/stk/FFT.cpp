@@ -0,0 +1,164 @@
+/***************************************************/
+/*! \class FFT
+    \brief STK real-input fast Fourier transform class.
+
+    This class computes the discrete Fourier transform of a block of
+    real samples whose size is a power of two, and its inverse, as a
+    radix-2 complex transform of half the size.
+*/
+/***************************************************/
+
+#include "FFT.h"
+#include <cmath>
+
+namespace stk {
+
+FFT :: FFT( unsigned int size )
+  : size_(0)
+{
+  if ( size > 0 ) this->setSize( size );
+}
+
+void FFT :: setSize( unsigned int size )
+{
+  if ( size < 2 || ( size & ( size - 1 ) ) != 0 ) {
+    oStream_ << "FFT::setSize: size (" << size << ") must be a power of two greater than 1!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  if ( size == size_ ) return;
+  size_ = size;
+
+  unsigned int i, half = size / 2, bits = 0;
+  while ( ( 1u << bits ) < half ) bits++;
+
+  reversed_.resize( half );
+  for ( i=0; i<half; i++ ) {
+    unsigned int r = 0;
+    for ( unsigned int b=0; b<bits; b++ )
+      if ( i & ( 1u << b ) ) r |= 1u << ( bits - 1 - b );
+    reversed_[i] = r;
+  }
+
+  // The factors of each stage of the complex transform, stored consecutively (half - 1 in all).
+  twiddles_.clear();
+  for ( unsigned int length=2; length<=half; length <<= 1 ) {
+    for ( i=0; i<length/2; i++ ) {
+      double phase = -TWO_PI * i / length;
+      twiddles_.push_back( (StkFloat) cos( phase ) );
+      twiddles_.push_back( (StkFloat) sin( phase ) );
+    }
+  }
+
+  splitFactors_.resize( size );
+  for ( i=0; i<half; i++ ) {
+    double phase = -TWO_PI * i / size;
+    splitFactors_[2*i] = (StkFloat) cos( phase );
+    splitFactors_[2*i+1] = (StkFloat) sin( phase );
+  }
+
+  work_.resize( size );
+}
+
+void FFT :: transform( StkFloat *data )
+{
+  // Decimation in time, on data already in bit-reversed order.
+  unsigned int half = size_ / 2;
+  const StkFloat *twiddles = &twiddles_[0];
+  for ( unsigned int length=2; length<=half; length <<= 1 ) {
+    unsigned int stride = length / 2;
+    for ( unsigned int i=0; i<half; i+=length ) {
+      StkFloat *a = &data[2*i], *b = &data[2*(i+stride)];
+      for ( unsigned int j=0; j<stride; j++ ) {
+        StkFloat wr = twiddles[2*j], wi = twiddles[2*j+1];
+        StkFloat vr = b[2*j] * wr - b[2*j+1] * wi;
+        StkFloat vi = b[2*j] * wi + b[2*j+1] * wr;
+        b[2*j] = a[2*j] - vr;
+        b[2*j+1] = a[2*j+1] - vi;
+        a[2*j] += vr;
+        a[2*j+1] += vi;
+      }
+    }
+    twiddles += length;
+  }
+}
+
+void FFT :: forward( const StkFloat *input, StkFloat *spectrum )
+{
+  // Transform the even and odd samples together, as the real and imaginary parts of a complex signal.
+  unsigned int k, half = size_ / 2;
+  StkFloat *z = &work_[0];
+  for ( k=0; k<half; k++ ) {
+    z[2*reversed_[k]] = input[2*k];
+    z[2*reversed_[k]+1] = input[2*k+1];
+  }
+
+  this->transform( z );
+
+  // Then separate their spectra (E and O) and combine them: X[k] = E[k] + exp(-2 pi i k / size) O[k].
+  spectrum[0] = z[0] + z[1];
+  spectrum[1] = z[0] - z[1];
+  for ( k=1; k<half; k++ ) {
+    StkFloat zr = z[2*k], zi = z[2*k+1];
+    StkFloat cr = z[2*(half-k)], ci = -z[2*(half-k)+1];
+    StkFloat er = 0.5 * ( zr + cr ), ei = 0.5 * ( zi + ci );
+    StkFloat or_ = 0.5 * ( zi - ci ), oi = -0.5 * ( zr - cr );
+    StkFloat wr = splitFactors_[2*k], wi = splitFactors_[2*k+1];
+    spectrum[2*k] = er + wr * or_ - wi * oi;
+    spectrum[2*k+1] = ei + wr * oi + wi * or_;
+  }
+}
+
+void FFT :: inverse( const StkFloat *spectrum, StkFloat *output )
+{
+  // Rebuild the spectra of the even and odd samples, and transform them (conjugated) together.
+  unsigned int k, half = size_ / 2;
+  StkFloat *z = &work_[0];
+  StkFloat er = 0.5 * ( spectrum[0] + spectrum[1] );
+  StkFloat or_ = 0.5 * ( spectrum[0] - spectrum[1] );
+  z[0] = er;
+  z[1] = -or_;
+  for ( k=1; k<half; k++ ) {
+    StkFloat xr = spectrum[2*k], xi = spectrum[2*k+1];
+    StkFloat cr = spectrum[2*(half-k)], ci = -spectrum[2*(half-k)+1];
+    StkFloat ei = 0.5 * ( xi + ci );
+    StkFloat dr = 0.5 * ( xr - cr ), di = 0.5 * ( xi - ci );
+    StkFloat wr = splitFactors_[2*k], wi = -splitFactors_[2*k+1];
+    StkFloat oi = dr * wi + di * wr;
+    er = 0.5 * ( xr + cr );
+    or_ = dr * wr - di * wi;
+    z[2*reversed_[k]] = er - oi;
+    z[2*reversed_[k]+1] = -( ei + or_ );
+  }
+
+  this->transform( z );
+
+  StkFloat scale = 1.0 / half;
+  for ( k=0; k<half; k++ ) {
+    output[2*k] = z[2*k] * scale;
+    output[2*k+1] = -z[2*k+1] * scale;
+  }
+}
+
+void FFT :: multiply( StkFloat *result, const StkFloat *a, const StkFloat *b, unsigned int size )
+{
+  result[0] = a[0] * b[0];
+  result[1] = a[1] * b[1];
+  for ( unsigned int i=2; i<size; i+=2 ) {
+    StkFloat real = a[i] * b[i] - a[i+1] * b[i+1];
+    result[i+1] = a[i] * b[i+1] + a[i+1] * b[i];
+    result[i] = real;
+  }
+}
+
+void FFT :: multiplyAccumulate( StkFloat *result, const StkFloat *a, const StkFloat *b, unsigned int size )
+{
+  result[0] += a[0] * b[0];
+  result[1] += a[1] * b[1];
+  for ( unsigned int i=2; i<size; i+=2 ) {
+    result[i] += a[i] * b[i] - a[i+1] * b[i+1];
+    result[i+1] += a[i] * b[i+1] + a[i+1] * b[i];
+  }
+}
+
+} // stk namespace
@@ -0,0 +1,77 @@
+#ifndef STK_FFT_H
+#define STK_FFT_H
+
+#include "Stk.h"
+#include <vector>
+
+namespace stk {
+
+/***************************************************/
+/*! \class FFT
+    \brief STK real-input fast Fourier transform class.
+
+    This class computes the discrete Fourier transform of a block of
+    real samples whose size is a power of two, and its inverse, for
+    fast (block) convolution.  The real transform is computed as a
+    complex transform of half the size, with tables of twiddle factors
+    and bit-reversed indices set up when the size is set, so that
+    transforms allocate no memory.
+
+    A spectrum of \e size real samples is stored in \e size values:
+    the (real) DC and Nyquist bins in the first two, followed by the
+    real and imaginary parts of bins 1 to size/2 - 1.  The forward
+    transform is unscaled and the inverse is scaled by 1/size, so that
+    inverse( forward( x ) ) returns x.
+*/
+/***************************************************/
+
+class FFT : public Stk
+{
+ public:
+  //! Default constructor, for transforms of \e size samples (a power of two, or zero to set later).
+  /*!
+    An StkError is thrown if \e size is not a power of two.
+  */
+  FFT( unsigned int size = 0 );
+
+  //! Set the transform size (a power of two of at least 2) and compute the tables.
+  /*!
+    An StkError is thrown if \e size is not a power of two.
+  */
+  void setSize( unsigned int size );
+
+  //! Return the transform size.
+  unsigned int getSize( void ) const { return size_; };
+
+  //! Compute the spectrum of \e size real samples.
+  /*!
+    The input and output may be the same array.
+  */
+  void forward( const StkFloat *input, StkFloat *spectrum );
+
+  //! Compute the \e size real samples of a spectrum.
+  /*!
+    The input and output may be the same array.
+  */
+  void inverse( const StkFloat *spectrum, StkFloat *output );
+
+  //! Multiply two spectra of \e size values bin by bin (\e result may be either of them).
+  static void multiply( StkFloat *result, const StkFloat *a, const StkFloat *b, unsigned int size );
+
+  //! Multiply two spectra of \e size values bin by bin, adding the products to \e result.
+  static void multiplyAccumulate( StkFloat *result, const StkFloat *a, const StkFloat *b, unsigned int size );
+
+ protected:
+
+  void transform( StkFloat *data );
+
+  unsigned int size_;
+  std::vector<StkFloat> work_;         // the complex data (size_/2 interleaved values)
+  std::vector<StkFloat> twiddles_;     // complex transform twiddle factors, stage by stage
+  std::vector<StkFloat> splitFactors_; // exp(-2 pi i k / size) for separating the real spectrum
+  std::vector<unsigned int> reversed_; // bit-reversed indices
+};
+
+} // stk namespace
+
+#endif
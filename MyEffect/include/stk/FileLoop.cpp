@@ -24,6 +24,7 @@ namespace stk {
 FileLoop :: FileLoop( unsigned long chunkThreshold, unsigned long chunkSize )
   : FileWvIn( chunkThreshold, chunkSize ), phaseOffset_(0.0)
 {
+  looping_ = true;
   Stk::addSampleRateAlert( this );
 }
 
@@ -31,6 +32,7 @@ FileLoop :: FileLoop( std::string fileName, bool raw, bool doNormalize,
                       unsigned long chunkThreshold, unsigned long chunkSize )
   : FileWvIn( chunkThreshold, chunkSize ), phaseOffset_(0.0)
 {
+  looping_ = true;
   this->openFile( fileName, raw, doNormalize );
   Stk::addSampleRateAlert( this );
 }
@@ -42,51 +44,62 @@ FileLoop :: ~FileLoop( void )
 
 void FileLoop :: openFile( std::string fileName, bool raw, bool doNormalize )
 {
+  // Hold on to the current data while loading, in case the same file is reopened.
+  std::shared_ptr<const StkFrames> previous = shared_;
+
   // Call close() in case another file is already open.
   this->closeFile();
 
-  // Attempt to open the file ... an error might be thrown here.
-  file_.open( fileName, raw );
+  fileName_ = fileName;
+  raw_ = raw;
+
+  // Load the whole file (or share it, if already loaded) unless it is large
+  // enough for chunking ... an error might be thrown here.  The first sample
+  // frame is copied to the end of the data.
+  shared_ = SampleCache::load( fileName, raw, doNormalize, true, chunkThreshold_ );
+
+  if ( shared_ ) {
+    chunking_ = false;
+    samples_ = shared_.get();
+    fileSize_ = shared_->frames() - 1;
+    data_.resize( 0, shared_->channels() ); // keeps the channel count and rate
+    data_.setDataRate( shared_->dataRate() );
+  }
+  else {
+    // Attempt to open the file ... an error might be thrown here.
+    file_.open( fileName, raw );
+    fileSize_ = file_.fileSize();
 
-  // Determine whether chunking or not.
-  if ( file_.fileSize() > chunkThreshold_ ) {
     chunking_ = true;
     chunkPointer_ = 0;
     data_.resize( chunkSize_ + 1, file_.channels() );
     if ( doNormalize ) normalizing_ = true;
     else normalizing_ = false;
-  }
-  else {
-    chunking_ = false;
-    data_.resize( file_.fileSize() + 1, file_.channels() );
-  }
-
-  // Load all or part of the data.
-  file_.read( data_, 0, doNormalize );
 
-  if ( chunking_ ) { // If chunking, save the first sample frame for later.
+    // Load the first chunk of data and save the first sample frame for later.
+    file_.read( data_, 0, doNormalize );
     firstFrame_.resize( 1, data_.channels() );
     for ( unsigned int i=0; i<data_.channels(); i++ )
       firstFrame_[i] = data_[i];
   }
-  else {  // If not chunking, copy the first sample frame to the last.
-    for ( unsigned int i=0; i<data_.channels(); i++ )
-      data_( data_.frames() - 1, i ) = data_[i];
-  }
 
   // Resize our lastOutputs container.
-  lastFrame_.resize( 1, file_.channels() );
+  lastFrame_.resize( 1, data_.channels() );
 
   // Set default rate based on file sampling rate.
   this->setRate( data_.dataRate() / Stk::sampleRate() );
 
-  if ( doNormalize & !chunking_ ) this->normalize();
+  if ( streaming_ ) this->startStreaming();
 
   this->reset();
 }
 
 void FileLoop :: setRate( StkFloat rate )
 {
+  // When streaming and turning around, have the I/O thread read ahead the other way.
+  if ( chunking_ && streaming_ && ( rate < 0.0 ) != ( rate_ < 0.0 ) )
+    stream_.prefetch( stream_.chunkAt( time_ ), rate < 0.0 ? -1 : 1 );
+
   rate_ = rate;
 
   if ( fmod( rate_, 1.0 ) != 0.0 ) interpolate_ = true;
@@ -98,7 +111,7 @@ void FileLoop :: addTime( StkFloat time )
   // Add an absolute time in samples.
   time_ += time;
 
-  StkFloat fileSize = file_.fileSize();
+  StkFloat fileSize = fileSize_;
   while ( time_ < 0.0 )
     time_ += fileSize;
   while ( time_ >= fileSize )
@@ -108,7 +121,7 @@ void FileLoop :: addTime( StkFloat time )
 void FileLoop :: addPhase( StkFloat angle )
 {
   // Add a time in cycles (one cycle = fileSize).
-  StkFloat fileSize = file_.fileSize();
+  StkFloat fileSize = fileSize_;
   time_ += fileSize * angle;
 
   while ( time_ < 0.0 )
@@ -120,7 +133,7 @@ void FileLoop :: addPhase( StkFloat angle )
 void FileLoop :: addPhaseOffset( StkFloat angle )
 {
   // Add a phase offset in cycles, where 1.0 = fileSize.
-  phaseOffset_ = file_.fileSize() * angle;
+  phaseOffset_ = fileSize_ * angle;
 }
 
 StkFloat FileLoop :: tick( unsigned int channel )
@@ -134,7 +147,7 @@ StkFloat FileLoop :: tick( unsigned int channel )
 
   // Check limits of time address ... if necessary, recalculate modulo
   // fileSize.
-  StkFloat fileSize = file_.fileSize();
+  StkFloat fileSize = fileSize_;
 
   while ( time_ < 0.0 )
     time_ += fileSize;
@@ -150,7 +163,18 @@ StkFloat FileLoop :: tick( unsigned int channel )
       tyme -= fileSize;
   }
 
-  if ( chunking_ ) {
+  const StkFrames *frames = samples_;
+  if ( chunking_ && streaming_ ) {
+
+    // Take the chunk from the I/O thread (output silence if it isn't ready).
+    frames = streamChunk( tyme );
+    if ( !frames ) {
+      for ( unsigned int i=0; i<lastFrame_.size(); i++ ) lastFrame_[i] = 0.0;
+      time_ += rate_;
+      return lastFrame_[channel];
+    }
+  }
+  else if ( chunking_ ) {
 
     // Check the time address vs. our current buffer limits.
     if ( ( time_ < (StkFloat) chunkPointer_ ) ||
@@ -182,11 +206,11 @@ StkFloat FileLoop :: tick( unsigned int channel )
 
   if ( interpolate_ ) {
     for ( unsigned int i=0; i<lastFrame_.size(); i++ )
-      lastFrame_[i] = data_.interpolate( tyme, i );
+      lastFrame_[i] = frames->interpolate( tyme, i );
   }
   else {
     for ( unsigned int i=0; i<lastFrame_.size(); i++ )
-      lastFrame_[i] = data_( (size_t) tyme, i );
+      lastFrame_[i] = (*frames)( (size_t) tyme, i );
   }
 
   // Increment time, which can be negative.
@@ -197,7 +221,7 @@ StkFloat FileLoop :: tick( unsigned int channel )
 
 StkFrames& FileLoop :: tick( StkFrames& frames )
 {
-  if ( !file_.isOpen() ) {
+  if ( !this->isOpen() ) {
 #if defined(_STK_DEBUG_)
     oStream_ << "FileLoop::tick(): no file data is loaded!";
     handleError( StkError::WARNING );
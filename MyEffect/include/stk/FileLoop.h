@@ -72,7 +72,7 @@ class FileLoop : protected FileWvIn
   void normalize( StkFloat peak ) { FileWvIn::normalize( peak ); };
 
   //! Return the file size in sample frames.
-  unsigned long getSize( void ) const { return data_.frames(); };
+  unsigned long getSize( void ) const { return samples_->frames(); };
 
   //! Return the input file sample rate in Hz (not the data read rate).
   /*!
@@ -95,7 +95,13 @@ class FileLoop : protected FileWvIn
     corresponds to file cycles per second.  The frequency can be
     negative, in which case the loop is read in reverse order.
   */
-  void setFrequency( StkFloat frequency ) { this->setRate( file_.fileSize() * frequency / Stk::sampleRate() ); };
+  void setFrequency( StkFloat frequency ) { this->setRate( fileSize_ * frequency / Stk::sampleRate() ); };
+
+  //! Turn background streaming of incrementally loaded files on/off (see FileWvIn::setStreaming()).
+  void setStreaming( bool streaming, unsigned int nChunks = 4 ) { FileWvIn::setStreaming( streaming, nChunks ); };
+
+  //! Return the number of streaming underruns since the file was opened.
+  unsigned long getUnderruns( void ) const { return FileWvIn::getUnderruns(); };
 
   //! Increment the read pointer by \e time samples, modulo file size.
   void addTime( StkFloat time );
@@ -32,34 +32,52 @@
 /***************************************************/
 
 #include "FileRead.h"
+#include "SampleConvert.h"
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <cstring>
 #include <cmath>
 #include <cstdio>
 
+#if defined(_WIN32)
+  #include <windows.h>
+  #include <io.h>
+#else
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
 namespace stk {
 
 FileRead :: FileRead()
-  : fd_(0), fileSize_(0), channels_(0), dataType_(0), fileRate_(0.0)
+  : fd_(0), fileSize_(0), channels_(0), dataType_(0), fileRate_(0.0),
+    memoryMapped_(false), mapping_(0), mapSize_(0)
 {
+#if defined(_WIN32)
+  mapHandle_ = 0;
+#endif
 }
 
 FileRead :: FileRead( std::string fileName, bool typeRaw, unsigned int nChannels,
                       StkFormat format, StkFloat rate )
-  : fd_(0)
+  : fd_(0), memoryMapped_(false), mapping_(0), mapSize_(0)
 {
+#if defined(_WIN32)
+  mapHandle_ = 0;
+#endif
   open( fileName, typeRaw, nChannels, format, rate );
 }
 
 FileRead :: ~FileRead()
 {
+  unmapData();
   if ( fd_ )
     fclose( fd_ );
 }
 
 void FileRead :: close( void )
 {
+  unmapData();
   if ( fd_ ) fclose( fd_ );
   fd_ = 0;
   wavFile_ = false;
@@ -75,6 +93,75 @@ bool FileRead :: isOpen( void )
   else return false;
 }
 
+void FileRead :: setMemoryMapped( bool mapped )
+{
+  memoryMapped_ = mapped;
+  if ( fd_ == 0 ) return;
+
+  if ( mapped && mapping_ == 0 ) mapData();
+  else if ( !mapped ) unmapData();
+}
+
+const FLOAT32 *FileRead :: floatData( void ) const
+{
+  if ( mapping_ == 0 || dataType_ != STK_FLOAT32 || byteswap_ ) return 0;
+
+  // The data chunk must also be suitably aligned for float access.
+  if ( dataOffset_ % sizeof(FLOAT32) ) return 0;
+
+  return (const FLOAT32 *) ( mapping_ + dataOffset_ );
+}
+
+bool FileRead :: mapData( void )
+{
+  unmapData();
+
+  unsigned long bytes = SampleConvert::sampleBytes( dataType_ );
+
+  // Map from the start of the file (mapping offsets must be page aligned) to the end of the data,
+  // or to the end of the file if the header claims more data than there is.
+  struct stat filestat;
+  if ( fstat( fileno( fd_ ), &filestat ) == -1 ) return false;
+  size_t size = (size_t) dataOffset_ + (size_t) fileSize_ * channels_ * bytes;
+  if ( size > (size_t) filestat.st_size ) size = (size_t) filestat.st_size;
+  if ( size <= dataOffset_ ) return false;
+
+#if defined(_WIN32)
+  HANDLE file = (HANDLE) _get_osfhandle( _fileno( fd_ ) );
+  HANDLE handle = CreateFileMapping( file, NULL, PAGE_READONLY, 0, 0, NULL );
+  if ( handle == NULL ) return false;
+  void *data = MapViewOfFile( handle, FILE_MAP_READ, 0, 0, size );
+  if ( data == NULL ) {
+    CloseHandle( handle );
+    return false;
+  }
+  mapHandle_ = handle;
+#else
+  void *data = mmap( 0, size, PROT_READ, MAP_SHARED, fileno( fd_ ), 0 );
+  if ( data == MAP_FAILED ) return false;
+#endif
+
+  mapping_ = (unsigned char *) data;
+  mapSize_ = size;
+  return true;
+}
+
+void FileRead :: unmapData( void )
+{
+  if ( mapping_ == 0 ) return;
+
+#if defined(_WIN32)
+  UnmapViewOfFile( mapping_ );
+  CloseHandle( (HANDLE) mapHandle_ );
+  mapHandle_ = 0;
+#else
+  munmap( mapping_, mapSize_ );
+#endif
+
+  mapping_ = 0;
+  mapSize_ = 0;
+}
+
 void FileRead :: open( std::string fileName, bool typeRaw, unsigned int nChannels,
                        StkFormat format, StkFloat rate )
 {
@@ -126,6 +213,8 @@ void FileRead :: open( std::string fileName, bool typeRaw, unsigned int nChannel
     handleError( StkError::FILE_ERROR );
   }
 
+  if ( memoryMapped_ ) mapData();
+
   return;
 
  error:
@@ -744,134 +833,21 @@ void FileRead :: read( StkFrames& buffer, unsigned long startFrame, bool doNorma
   long i, nSamples = (long) ( nFrames * channels_ );
   unsigned long offset = startFrame * channels_;
 
-  // Read samples into StkFrames data buffer.
-  if ( dataType_ == STK_SINT16 ) {
-    SINT16 *buf = (SINT16 *) &buffer[0];
-    if ( fseek( fd_, dataOffset_+(offset*2), SEEK_SET ) == -1 ) goto error;
-    if ( fread( buf, nSamples * 2, 1, fd_ ) != 1 ) goto error;
-    if ( byteswap_ ) {
-      SINT16 *ptr = buf;
-      for ( i=nSamples-1; i>=0; i-- )
-        swap16( (unsigned char *) ptr++ );
-    }
-    if ( doNormalize ) {
-      StkFloat gain = 1.0 / 32768.0;
-      for ( i=nSamples-1; i>=0; i-- )
-        buffer[i] = buf[i] * gain;
-    }
-    else {
-      for ( i=nSamples-1; i>=0; i-- )
-        buffer[i] = buf[i];
-    }
+  if ( mapping_ ) {
+    readMapped( buffer, offset, nSamples, doNormalize );
+    return;
   }
-  else if ( dataType_ == STK_SINT32 ) {
-    SINT32 *buf = (SINT32 *) &buffer[0];
-    if ( fseek( fd_, dataOffset_+(offset*4 ), SEEK_SET ) == -1 ) goto error;
-    if ( fread( buf, nSamples * 4, 1, fd_ ) != 1 ) goto error;
-    if ( byteswap_ ) {
-      SINT32 *ptr = buf;
-      for ( i=nSamples-1; i>=0; i-- )
-        swap32( (unsigned char *) ptr++ );
-    }
-    if ( doNormalize ) {
-      StkFloat gain = 1.0 / 2147483648.0;
-      for ( i=nSamples-1; i>=0; i-- )
-        buffer[i] = buf[i] * gain;
-    }
-    else {
-      for ( i=nSamples-1; i>=0; i-- )
-        buffer[i] = buf[i];
-    }
-  }
-  else if ( dataType_ == STK_FLOAT32 ) {
-    FLOAT32 *buf = (FLOAT32 *) &buffer[0];
-    if ( fseek( fd_, dataOffset_+(offset*4), SEEK_SET ) == -1 ) goto error;
-    if ( fread( buf, nSamples * 4, 1, fd_ ) != 1 ) goto error;
-    if ( byteswap_ ) {
-      FLOAT32 *ptr = buf;
-      for ( i=nSamples-1; i>=0; i-- )
-        swap32( (unsigned char *) ptr++ );
-    }
-    for ( i=nSamples-1; i>=0; i-- )
-      buffer[i] = buf[i];
-  }
-  else if ( dataType_ == STK_FLOAT64 ) {
-    FLOAT64 *buf = (FLOAT64 *) &buffer[0];
-    if ( fseek( fd_, dataOffset_+(offset*8), SEEK_SET ) == -1 ) goto error;
-    if ( fread( buf, nSamples * 8, 1, fd_ ) != 1 ) goto error;
-    if ( byteswap_ ) {
-      FLOAT64 *ptr = buf;
-      for ( i=nSamples-1; i>=0; i-- )
-        swap64( (unsigned char *) ptr++ );
-    }
-    for ( i=nSamples-1; i>=0; i-- )
-      buffer[i] = buf[i];
-  }
-  else if ( dataType_ == STK_SINT8 && wavFile_ ) { // 8-bit WAV data is unsigned!
-    unsigned char *buf = (unsigned char *) &buffer[0];
-    if ( fseek( fd_, dataOffset_+offset, SEEK_SET ) == -1 ) goto error;
-    if ( fread( buf, nSamples, 1, fd_) != 1 ) goto error;
-    if ( doNormalize ) {
-      StkFloat gain = 1.0 / 128.0;
-      for ( i=nSamples-1; i>=0; i-- )
-        buffer[i] = ( buf[i] - 128 ) * gain;
-    }
-    else {
-      for ( i=nSamples-1; i>=0; i-- )
-        buffer[i] = buf[i] - 128.0;
-    }
-  }
-  else if ( dataType_ == STK_SINT8 ) { // signed 8-bit data
-    char *buf = (char *) &buffer[0];
-    if ( fseek( fd_, dataOffset_+offset, SEEK_SET ) == -1 ) goto error;
-    if ( fread( buf, nSamples, 1, fd_ ) != 1 ) goto error;
-    if ( doNormalize ) {
-      StkFloat gain = 1.0 / 128.0;
-      for ( i=nSamples-1; i>=0; i-- )
-        buffer[i] = buf[i] * gain;
-    }
-    else {
-      for ( i=nSamples-1; i>=0; i-- )
-        buffer[i] = buf[i];
-    }
-  }
-  else if ( dataType_ == STK_SINT24 ) {
-    // 24-bit values are harder to import efficiently since there is
-    // no native 24-bit type.  The following routine works but is much
-    // less efficient than that used for the other data types.
-    SINT32 temp;
-    unsigned char *ptr = (unsigned char *) &temp;
-    StkFloat gain = 1.0 / 2147483648.0;
-    if ( fseek(fd_, dataOffset_+(offset*3), SEEK_SET ) == -1 ) goto error;
-    for ( i=0; i<nSamples; i++ ) {
-#ifdef __LITTLE_ENDIAN__
-      if ( byteswap_ ) {
-        if ( fread( ptr, 3, 1, fd_ ) != 1 ) goto error;
-        temp &= 0x00ffffff;
-        swap32( (unsigned char *) ptr );
-      }
-      else {
-        if ( fread( ptr+1, 3, 1, fd_ ) != 1 ) goto error;
-        temp &= 0xffffff00;
-      }
-#else
-      if ( byteswap_ ) {
-        if ( fread( ptr+1, 3, 1, fd_ ) != 1 ) goto error;
-        temp &= 0xffffff00;
-        swap32( (unsigned char *) ptr );
-      }
-      else {
-        if ( fread( ptr, 3, 1, fd_ ) != 1 ) goto error;
-        temp &= 0x00ffffff;
-      }
-#endif
 
-      if ( doNormalize ) {
-        buffer[i] = (StkFloat) temp * gain; // "gain" also  includes 1 / 256 factor.
-      }
-      else
-        buffer[i] = (StkFloat) temp / 256;  // right shift without affecting the sign bit
-    }
+  // Read the samples in blocks and convert them into the StkFrames data buffer.
+  unsigned int bytes = SampleConvert::sampleBytes( dataType_ );
+  unsigned char data[8192];
+  long blockSamples = sizeof(data) / bytes;
+  if ( fseek( fd_, dataOffset_+(offset*bytes), SEEK_SET ) == -1 ) goto error;
+  for ( i=0; i<nSamples; i+=blockSamples ) {
+    long count = ( nSamples - i < blockSamples ) ? nSamples - i : blockSamples;
+    if ( fread( data, count * bytes, 1, fd_ ) != 1 ) goto error;
+    SampleConvert::toFloat( &buffer[i], data, count, dataType_, byteswap_, doNormalize,
+                            dataType_ == STK_SINT8 && wavFile_ ); // 8-bit WAV data is unsigned!
   }
 
   buffer.setDataRate( fileRate_ );
@@ -883,4 +859,21 @@ void FileRead :: read( StkFrames& buffer, unsigned long startFrame, bool doNorma
   handleError( StkError::FILE_ERROR);
 }
 
+void FileRead :: readMapped( StkFrames& buffer, unsigned long offset, long nSamples, bool doNormalize )
+{
+  unsigned int bytes = SampleConvert::sampleBytes( dataType_ );
+
+  // The mapping ends early if the file is shorter than its header claims.
+  size_t start = (size_t) dataOffset_ + (size_t) offset * bytes;
+  if ( start + (size_t) nSamples * bytes > mapSize_ ) {
+    oStream_ << "FileRead: Error reading file data.";
+    handleError( StkError::FILE_ERROR );
+  }
+
+  SampleConvert::toFloat( &buffer[0], mapping_ + start, nSamples, dataType_, byteswap_, doNormalize,
+                          dataType_ == STK_SINT8 && wavFile_ ); // 8-bit WAV data is unsigned!
+
+  buffer.setDataRate( fileRate_ );
+}
+
 } // stk namespace
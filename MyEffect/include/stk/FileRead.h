@@ -34,6 +34,15 @@ namespace stk {
     such variable is found, the sample rate is
     assumed to be 44100 Hz.
 
+    Files can optionally be memory-mapped (see
+    setMemoryMapped()), in which case the audio data
+    is mapped into memory once when the file is
+    opened and read() converts samples straight from
+    the mapping, without seeking or copying through
+    the C library.  Floating-point data in native
+    byte order can then be accessed in place with
+    floatData().
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -105,6 +114,27 @@ public:
    */
   void read( StkFrames& buffer, unsigned long startFrame = 0, bool doNormalize = true );
 
+  //! Enable or disable memory-mapped reading (default = false).
+  /*!
+    When enabled, the audio data of a file is mapped into memory
+    when it is opened (or immediately, if a file is already open),
+    and read() converts samples directly from the mapping.  If the
+    file cannot be mapped, the file is read from disk as usual.
+  */
+  void setMemoryMapped( bool mapped );
+
+  //! Returns \e true if the data of the open file is memory-mapped.
+  bool isMemoryMapped( void ) const { return mapping_ != 0; };
+
+  //! Return a pointer to the interleaved 32-bit floating-point data of a memory-mapped file.
+  /*!
+    The pointer refers to the file data in place (no copy is made)
+    and remains valid until the file is closed.  It is only available
+    for memory-mapped FLOAT32 files in native byte order (e.g. float
+    WAV files on little-endian machines); otherwise 0 is returned.
+  */
+  const FLOAT32 *floatData( void ) const;
+
 protected:
 
   // Get STK RAW file information.
@@ -126,6 +156,13 @@ protected:
   // Helper function for MAT-file parsing.
   bool findNextMatArray( SINT32 *chunkSize, SINT32 *rows, SINT32 *columns, SINT32 *nametype );
 
+  // Map / unmap the file data for memory-mapped reading.
+  bool mapData( void );
+  void unmapData( void );
+
+  // Convert samples from the memory-mapped data.
+  void readMapped( StkFrames& buffer, unsigned long offset, long nSamples, bool doNormalize );
+
   FILE *fd_;
   bool byteswap_;
   bool wavFile_;
@@ -134,6 +171,13 @@ protected:
   unsigned int channels_;
   StkFormat dataType_;
   StkFloat fileRate_;
+
+  bool memoryMapped_;
+  unsigned char *mapping_;
+  size_t mapSize_;
+#if defined(_WIN32)
+  void *mapHandle_;
+#endif
 };
 
 } // stk namespace
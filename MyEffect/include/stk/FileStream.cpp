@@ -0,0 +1,254 @@
+/***************************************************/
+/*! \class FileStream
+    \brief STK background file streaming class.
+
+    This class reads an audio file in chunks on a dedicated I/O
+    thread, keeping a ring of chunk buffers filled ahead of the
+    playback position (in either direction, wrapping around for
+    looped playback).  It is used by FileWvIn and FileLoop in
+    streaming mode, so that their tick() functions never wait for
+    the disk.
+*/
+/***************************************************/
+
+#include "FileStream.h"
+
+namespace stk {
+
+FileStream :: FileStream( void )
+  : normalizing_(false), looping_(false), chunkSize_(0), hop_(1), nFileChunks_(0),
+    nSlots_(0), current_(0), missed_(-1), request_(-1), direction_(1), serial_(0),
+    underruns_(0), quit_(false), signalled_(false)
+{
+}
+
+FileStream :: ~FileStream( void )
+{
+  this->close();
+}
+
+void FileStream :: open( std::string fileName, bool raw, bool doNormalize,
+                         unsigned long chunkSize, unsigned int nChunks, bool looping )
+{
+  this->close();
+
+  if ( chunkSize < 2 || nChunks < 2 ) {
+    oStream_ << "FileStream::open: chunkSize and nChunks must both be at least 2!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  // Attempt to open the file ... an error might be thrown here.
+  file_.open( fileName, raw );
+
+  normalizing_ = doNormalize;
+  looping_ = looping;
+  chunkSize_ = chunkSize;
+  hop_ = chunkSize - 1; // overlap chunks by one frame
+  nFileChunks_ = (long) ( ( file_.fileSize() + hop_ - 1 ) / hop_ );
+
+  if ( looping_ ) {
+    firstFrame_.resize( 1, file_.channels() );
+    file_.read( firstFrame_, 0, normalizing_ );
+  }
+
+  nSlots_ = nChunks;
+  slots_.reset( new Slot[nSlots_] );
+  for ( unsigned int i=0; i<nSlots_; i++ )
+    slots_[i].frames.resize( chunkSize_, file_.channels() );
+
+  current_ = 0;
+  missed_ = -1;
+  request_.store( -1 ); // no chunk requested yet, so the first acquire() always wakes the I/O thread
+  direction_.store( 1 );
+  serial_.store( 0 );
+  underruns_.store( 0 );
+  quit_.store( false );
+  signalled_.store( false );
+
+  // Load the start of the file now, so playback can begin without an underrun, and
+  // (in the slots the start doesn't need) the end, for playback starting there backwards.
+  if ( nFileChunks_ > (long) nSlots_ ) {
+    fill( 0, 1, 0, nSlots_ - nSlots_ / 2 );
+    fill( nFileChunks_ - 1, -1, 0, nSlots_ / 2 );
+  }
+  else
+    fill( 0, 1, 0, nSlots_ );
+
+  thread_ = std::thread( &FileStream::run, this );
+}
+
+void FileStream :: close( void )
+{
+  if ( thread_.joinable() ) {
+    quit_.store( true );
+    wake_.post();
+    thread_.join();
+  }
+
+  current_ = 0;
+  slots_.reset();
+  nSlots_ = 0;
+  if ( file_.isOpen() ) file_.close();
+}
+
+const StkFrames* FileStream :: acquire( long chunk, int direction )
+{
+  const StkFrames *frames = 0;
+  if ( current_ && current_->chunk.load( std::memory_order_relaxed ) == chunk )
+    frames = &current_->frames;
+  else {
+    this->release();
+
+    for ( unsigned int i=0; i<nSlots_ && !frames; i++ ) {
+      Slot& slot = slots_[i];
+      if ( slot.chunk.load( std::memory_order_relaxed ) != chunk ) continue;
+
+      int expected = SLOT_READY;
+      if ( !slot.state.compare_exchange_strong( expected, SLOT_IN_USE, std::memory_order_acquire ) ) continue;
+
+      // The slot can't be reloaded while in use, but it may have been reloaded just before.
+      if ( slot.chunk.load( std::memory_order_relaxed ) == chunk ) {
+        current_ = &slot;
+        frames = &slot.frames;
+      }
+      else slot.state.store( SLOT_READY, std::memory_order_release );
+    }
+
+    // Not loaded yet: count the underrun (once per chunk) rather than wait for it.
+    if ( !frames && chunk != missed_ ) {
+      underruns_.fetch_add( 1, std::memory_order_relaxed );
+      missed_ = chunk;
+    }
+  }
+
+  // Tell the I/O thread where playback is (only when it moves to another chunk or turns around).
+  // This comes after the lookup, so whether the chunk was ready doesn't depend on how soon the
+  // woken I/O thread gets to run.
+  if ( chunk != request_.load( std::memory_order_relaxed ) || direction != direction_.load( std::memory_order_relaxed ) )
+    this->request( chunk, direction );
+
+  return frames;
+}
+
+void FileStream :: release( void )
+{
+  if ( current_ ) {
+    current_->state.store( SLOT_READY, std::memory_order_release );
+    current_ = 0;
+  }
+}
+
+void FileStream :: prefetch( long chunk, int direction )
+{
+  if ( this->isOpen() ) this->request( chunk, direction );
+}
+
+// Move the read-ahead window, waking the I/O thread unless a wake-up is already pending.
+void FileStream :: request( long chunk, int direction )
+{
+  request_.store( chunk, std::memory_order_relaxed );
+  direction_.store( direction, std::memory_order_relaxed );
+  serial_.fetch_add( 1 );
+  if ( !signalled_.exchange( true ) ) wake_.post();
+}
+
+// The chunk \e ahead chunks past \e chunk in the playback direction, or -1 past the ends of the file.
+long FileStream :: wanted( long chunk, int direction, unsigned int ahead ) const
+{
+  long next = chunk + ( direction < 0 ? -(long) ahead : (long) ahead );
+  if ( looping_ ) {
+    next %= nFileChunks_;
+    if ( next < 0 ) next += nFileChunks_;
+  }
+  else if ( next < 0 || next >= nFileChunks_ )
+    return -1;
+
+  return next;
+}
+
+// Load the playback chunk and the \e window - 1 after it, nearest first, into free slots or
+// else slots holding other chunks.  Returns false if a new position was requested meanwhile
+// (the caller should start again).
+bool FileStream :: fill( long chunk, int direction, unsigned long serial, unsigned int window )
+{
+  for ( unsigned int ahead=0; ahead<window; ahead++ ) {
+    long next = wanted( chunk, direction, ahead );
+    if ( next < 0 ) break;
+
+    bool loaded = false;
+    for ( unsigned int i=0; i<nSlots_ && !loaded; i++ ) {
+      int state = slots_[i].state.load( std::memory_order_acquire );
+      loaded = ( state == SLOT_READY || state == SLOT_IN_USE ) && slots_[i].chunk.load( std::memory_order_relaxed ) == next;
+    }
+    if ( loaded ) continue;
+
+    // Use an empty slot, or else reuse one holding a chunk playback won't reach soon.
+    for ( unsigned int i=0; i<2*nSlots_; i++ ) {
+      Slot& slot = slots_[i % nSlots_];
+      if ( i < nSlots_ && slot.state.load( std::memory_order_relaxed ) != SLOT_FREE ) continue;
+
+      long held = slot.chunk.load( std::memory_order_relaxed );
+      bool keep = false;
+      for ( unsigned int k=0; k<ahead && !keep; k++ )
+        keep = ( held == wanted( chunk, direction, k ) );
+      if ( keep ) continue;
+
+      int expected = slot.state.load( std::memory_order_relaxed );
+      if ( expected == SLOT_IN_USE || expected == SLOT_LOADING ) continue;
+      if ( !slot.state.compare_exchange_strong( expected, SLOT_LOADING, std::memory_order_acquire ) ) continue;
+
+      load( slot, next );
+      break;
+    }
+
+    if ( serial_.load( std::memory_order_acquire ) != serial ) return false;
+  }
+
+  return true;
+}
+
+void FileStream :: load( Slot& slot, long chunk )
+{
+  StkFrames& frames = slot.frames;
+  unsigned long start = (unsigned long) chunk * hop_;
+
+  for ( unsigned int i=0; i<frames.size(); i++ ) frames[i] = 0.0;
+
+  try {
+    file_.read( frames, start, normalizing_ );
+  }
+  catch ( StkError& ) {
+    // leave the chunk silent rather than stopping the I/O thread
+  }
+
+  // When looping, the frame after the end of the file is the first frame.
+  if ( looping_ && start + chunkSize_ > file_.fileSize() ) {
+    unsigned long end = file_.fileSize() - start;
+    for ( unsigned int j=0; j<frames.channels(); j++ )
+      frames( end, j ) = firstFrame_[j];
+  }
+
+  slot.chunk.store( chunk, std::memory_order_relaxed );
+  slot.state.store( SLOT_READY, std::memory_order_release );
+}
+
+void FileStream :: run( void )
+{
+  // open() has already loaded the chunks around the starting position.
+  unsigned long serial = 0;
+
+  while ( !quit_.load() ) {
+    // Sleep until playback moves on (no timeout: every request posts unless one is pending).
+    if ( serial_.load() == serial ) {
+      wake_.wait();
+      continue;
+    }
+
+    // Take the wake-up first, so a request made from here on posts another one.
+    signalled_.store( false );
+    serial = serial_.load();
+    fill( request_.load( std::memory_order_relaxed ), direction_.load( std::memory_order_relaxed ), serial, nSlots_ );
+  }
+}
+
+} // stk namespace
@@ -0,0 +1,133 @@
+#ifndef STK_FILESTREAM_H
+#define STK_FILESTREAM_H
+
+#include "FileRead.h"
+#include "Semaphore.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace stk {
+
+/***************************************************/
+/*! \class FileStream
+    \brief STK background file streaming class.
+
+    This class reads an audio file in chunks on a dedicated I/O
+    thread, keeping a ring of chunk buffers filled ahead of the
+    playback position (in either direction, wrapping around for
+    looped playback).  It is used by FileWvIn and FileLoop in
+    streaming mode, so that their tick() functions never wait for
+    the disk.
+
+    Chunk \e n holds \e chunkSize frames starting at frame
+    n * (chunkSize - 1), so consecutive chunks overlap by one frame
+    for interpolation.  Frames past the end of the file read as zero,
+    or as the first frame of the file when looping.
+
+    The audio thread calls acquire() for the chunk it needs.  This
+    only swaps buffers with atomic operations, and wakes the I/O
+    thread through a Semaphore, which never locks: if the chunk has
+    not been loaded yet, it returns 0 and counts an underrun instead
+    of waiting.  Apart from prefetch(), all other functions should be
+    called from a non-audio thread.
+*/
+/***************************************************/
+
+class FileStream : public Stk
+{
+ public:
+  //! Default constructor.
+  FileStream( void );
+
+  //! Class destructor (stops the I/O thread).
+  ~FileStream( void );
+
+  //! Open a file for streaming and start the I/O thread.
+  /*!
+    The file is opened separately from any other FileRead object,
+    so the I/O thread never shares a file handle with the caller.
+    The first chunks of the file, and its last chunks (for playback
+    that starts at the end with a negative rate), are loaded before
+    this function returns.  An StkError is thrown if the file cannot
+    be opened.
+  */
+  void open( std::string fileName, bool raw, bool doNormalize,
+             unsigned long chunkSize, unsigned int nChunks = 4, bool looping = false );
+
+  //! Stop the I/O thread and close the file.
+  void close( void );
+
+  //! Returns \e true if a file is open for streaming.
+  bool isOpen( void ) const { return thread_.joinable(); };
+
+  //! Return the number of the chunk holding the frame at \e time.
+  long chunkAt( StkFloat time ) const { return (long) ( time / hop_ ); };
+
+  //! Return the first frame in the file of chunk \e chunk.
+  StkFloat chunkStart( long chunk ) const { return (StkFloat) chunk * hop_; };
+
+  //! Audio thread: return the data of chunk \e chunk, or 0 if it is not loaded yet (an underrun).
+  /*!
+    The returned buffer stays valid until the next call to
+    acquire() or release().  The \e direction (1 or -1) tells the
+    I/O thread which way to read ahead.
+  */
+  const StkFrames* acquire( long chunk, int direction );
+
+  //! Audio thread: give back the buffer returned by the last acquire().
+  void release( void );
+
+  //! Any thread: start reading ahead from chunk \e chunk in \e direction (1 or -1), before playback jumps there.
+  /*!
+    This does not wait for the chunks to load, and never locks.
+  */
+  void prefetch( long chunk, int direction );
+
+  //! Return the number of times playback reached a chunk that had not been loaded.
+  unsigned long getUnderruns( void ) const { return underruns_.load( std::memory_order_relaxed ); };
+
+ protected:
+
+  enum SlotState { SLOT_FREE, SLOT_LOADING, SLOT_READY, SLOT_IN_USE };
+
+  struct Slot {
+    StkFrames frames;
+    std::atomic<long> chunk;
+    std::atomic<int> state;
+    Slot( void ) : chunk(-1), state(SLOT_FREE) {};
+  };
+
+  void run( void );
+  bool fill( long chunk, int direction, unsigned long serial, unsigned int window );
+  void request( long chunk, int direction );
+  long wanted( long chunk, int direction, unsigned int ahead ) const;
+  void load( Slot& slot, long chunk );
+
+  FileRead file_;
+  StkFrames firstFrame_;
+  bool normalizing_;
+  bool looping_;
+  unsigned long chunkSize_;
+  unsigned long hop_;
+  long nFileChunks_;
+
+  std::unique_ptr<Slot[]> slots_;
+  unsigned int nSlots_;
+  Slot *current_;          // slot in use by the audio thread
+  long missed_;            // last chunk counted as an underrun
+
+  std::atomic<long> request_;
+  std::atomic<int> direction_;
+  std::atomic<unsigned long> serial_;
+  std::atomic<unsigned long> underruns_;
+  std::atomic<bool> quit_;
+  std::atomic<bool> signalled_; // wake_ posted and not yet taken by the I/O thread
+
+  std::thread thread_;
+  Semaphore wake_;
+};
+
+} // stk namespace
+
+#endif
@@ -22,6 +22,7 @@
 /***************************************************/
 
 #include "FileWrite.h"
+#include "SampleConvert.h"
 #include <string>
 #include <cstdio>
 #include <cstring>
@@ -105,10 +106,11 @@ FileWrite :: FileWrite()
 {
 }
 
-FileWrite::FileWrite( std::string fileName, unsigned int nChannels, FILE_TYPE type, Stk::StkFormat format )
+FileWrite::FileWrite( std::string fileName, unsigned int nChannels, FILE_TYPE type, Stk::StkFormat format,
+                      StkFloat fileRate )
   : fd_( 0 )
 {
-  this->open( fileName, nChannels, type, format );
+  this->open( fileName, nChannels, type, format, fileRate );
 }
 
 FileWrite :: ~FileWrite()
@@ -140,7 +142,8 @@ bool FileWrite :: isOpen( void )
   else return false;
 }
 
-void FileWrite :: open( std::string fileName, unsigned int nChannels, FileWrite::FILE_TYPE type, Stk::StkFormat format )
+void FileWrite :: open( std::string fileName, unsigned int nChannels, FileWrite::FILE_TYPE type, Stk::StkFormat format,
+                        StkFloat fileRate )
 {
   // Call close() in case another file is already open.
   this->close();
@@ -152,6 +155,7 @@ void FileWrite :: open( std::string fileName, unsigned int nChannels, FileWrite:
 
   channels_ = nChannels;
   fileType_ = type;
+  fileRate_ = ( fileRate > 0.0 ) ? fileRate : Stk::sampleRate();
 
   if ( format != STK_SINT8 && format != STK_SINT16 &&
        format != STK_SINT24 && format != STK_SINT32 &&
@@ -223,7 +227,7 @@ bool FileWrite :: setWavFile( std::string fileName )
   }
 
   struct WaveHeader hdr = { {'R','I','F','F'}, 44, {'W','A','V','E'}, {'f','m','t',' '}, 16, 1, 1,
-                            (SINT32) Stk::sampleRate(), 0, 2, 16, 0, 0, 0, 
+                            (SINT32) fileRate_, 0, 2, 16, 0, 0, 0, 
                             {'\x01','\x00','\x00','\x00','\x00','\x00','\x10','\x00','\x80','\x00','\x00','\xAA','\x00','\x38','\x9B','\x71'},
                             {'f','a','c','t'}, 4, 0 };
   hdr.nChannels = (SINT16) channels_;
@@ -352,7 +356,7 @@ bool FileWrite :: setSndFile( std::string fileName )
     return false;
   }
 
-  struct SndHeader hdr = {".sn", 40, 0, 3, (SINT32) Stk::sampleRate(), 1, "Created by STK"};
+  struct SndHeader hdr = {".sn", 40, 0, 3, (SINT32) fileRate_, 1, "Created by STK"};
   hdr.pref[3] = 'd';
   hdr.nChannels = channels_;
   if ( dataType_ == STK_SINT8 )
@@ -448,7 +452,7 @@ bool FileWrite :: setAifFile( std::string fileName )
   // convert to that.
   SINT16 i;
   unsigned long exp;
-  unsigned long rate = (unsigned long) Stk::sampleRate();
+  unsigned long rate = (unsigned long) fileRate_;
   memset( hdr.srate, 0, 10 );
   exp = rate;
   for ( i=0; i<32; i++ ) {
@@ -603,7 +607,7 @@ bool FileWrite :: setMatFile( std::string fileName )
   hdr.fs[12] = 9;             // Matlab IEEE 754 double data type
   hdr.fs[13] = 8;             // 8 bytes of data to follow
   FLOAT64 *sampleRate = (FLOAT64 *)&hdr.fs[14];
-  *sampleRate = (FLOAT64) Stk::sampleRate();
+  *sampleRate = (FLOAT64) fileRate_;
 
   // Write audio samples in array data element
   hdr.adf[0] = (SINT32) 14;       // Matlab array data type value
@@ -718,70 +722,16 @@ void FileWrite :: write( StkFrames& buffer )
     return;
   }
 
+  // Convert the samples in blocks and write each block at once.
   unsigned long nSamples = buffer.size();
-  if ( dataType_ == STK_SINT16 ) {
-    SINT16 sample;
-    for ( unsigned long k=0; k<nSamples; k++ ) {
-      sample = (SINT16) (buffer[k] * 32767.0);
-      //sample = ((SINT16) (( buffer[k] + 1.0 ) * 32767.5 + 0.5)) - 32768;
-      if ( byteswap_ ) swap16( (unsigned char *)&sample );
-      if ( fwrite(&sample, 2, 1, fd_) != 1 ) goto error;
-    }
-  }
-  else if ( dataType_ == STK_SINT8 ) {
-    if ( fileType_ == FILE_WAV ) { // 8-bit WAV data is unsigned!
-      unsigned char sample;
-      for ( unsigned long k=0; k<nSamples; k++ ) {
-        sample = (unsigned char) (buffer[k] * 127.0 + 128.0);
-        if ( fwrite(&sample, 1, 1, fd_) != 1 ) goto error;
-      }
-    }
-    else {
-      signed char sample;
-      for ( unsigned long k=0; k<nSamples; k++ ) {
-        sample = (signed char) (buffer[k] * 127.0);
-        //sample = ((signed char) (( buffer[k] + 1.0 ) * 127.5 + 0.5)) - 128;
-        if ( fwrite(&sample, 1, 1, fd_) != 1 ) goto error;
-      }
-    }
-  }
-  else if ( dataType_ == STK_SINT32 ) {
-    SINT32 sample;
-    for ( unsigned long k=0; k<nSamples; k++ ) {
-      sample = (SINT32) (buffer[k] * 2147483647.0);
-      //sample = ((SINT32) (( buffer[k] + 1.0 ) * 2147483647.5 + 0.5)) - 2147483648;
-      if ( byteswap_ ) swap32( (unsigned char *)&sample );
-      if ( fwrite(&sample, 4, 1, fd_) != 1 ) goto error;
-    }
-  }
-  else if ( dataType_ == STK_FLOAT32 ) {
-    FLOAT32 sample;
-    for ( unsigned long k=0; k<nSamples; k++ ) {
-      sample = (FLOAT32) (buffer[k]);
-      if ( byteswap_ ) swap32( (unsigned char *)&sample );
-      if ( fwrite(&sample, 4, 1, fd_) != 1 ) goto error;
-    }
-  }
-  else if ( dataType_ == STK_FLOAT64 ) {
-    FLOAT64 sample;
-    for ( unsigned long k=0; k<nSamples; k++ ) {
-      sample = (FLOAT64) (buffer[k]);
-      if ( byteswap_ ) swap64( (unsigned char *)&sample );
-      if ( fwrite(&sample, 8, 1, fd_) != 1 ) goto error;
-    }
-  }
-  else if ( dataType_ == STK_SINT24 ) {
-    SINT32 sample;
-    for ( unsigned long k=0; k<nSamples; k++ ) {
-      sample = (SINT32) (buffer[k] * 8388607.0);
-      if ( byteswap_ ) {
-        swap32( (unsigned char *)&sample );
-        unsigned char *ptr = (unsigned char *) &sample;
-        if ( fwrite(ptr+1, 3, 1, fd_) != 1 ) goto error;
-      }
-      else
-        if ( fwrite(&sample, 3, 1, fd_) != 1 ) goto error;
-    }
+  unsigned int bytes = SampleConvert::sampleBytes( dataType_ );
+  unsigned char data[8192];
+  unsigned long blockSamples = sizeof(data) / bytes;
+  for ( unsigned long k=0; k<nSamples; k+=blockSamples ) {
+    unsigned long count = ( nSamples - k < blockSamples ) ? nSamples - k : blockSamples;
+    SampleConvert::fromFloat( data, &buffer[k], count, dataType_, byteswap_,
+                              dataType_ == STK_SINT8 && fileType_ == FILE_WAV ); // 8-bit WAV data is unsigned!
+    if ( fwrite( data, count * bytes, 1, fd_ ) != 1 ) goto error;
   }
 
   frameCounter_ += buffer.frames();
@@ -46,8 +46,10 @@ class FileWrite : public Stk
   //! Overloaded constructor used to specify a file name, type, and data format with this object.
   /*!
     An StkError is thrown for invalid argument values or if an error occurs when initializing the output file.
+    The sample rate written to the file header is \e fileRate, or the current STK sample rate if it is zero.
   */
-  FileWrite( std::string fileName, unsigned int nChannels = 1, FILE_TYPE type = FILE_WAV, Stk::StkFormat format = STK_SINT16 );
+  FileWrite( std::string fileName, unsigned int nChannels = 1, FILE_TYPE type = FILE_WAV, Stk::StkFormat format = STK_SINT16,
+             StkFloat fileRate = 0.0 );
 
   //! Class destructor.
   virtual ~FileWrite();
@@ -55,9 +57,11 @@ class FileWrite : public Stk
   //! Create a file of the specified type and name and output samples to it in the given data format.
   /*!
     An StkError is thrown for invalid argument values or if an error occurs when initializing the output file.
+    The sample rate written to the file header is \e fileRate, or the current STK sample rate if it is zero.
   */
   void open( std::string fileName, unsigned int nChannels = 1,
-             FileWrite::FILE_TYPE type = FILE_WAV, Stk::StkFormat format = STK_SINT16 );
+             FileWrite::FILE_TYPE type = FILE_WAV, Stk::StkFormat format = STK_SINT16,
+             StkFloat fileRate = 0.0 );
 
   //! If a file is open, write out samples in the queue and then close it.
   void close( void );
@@ -104,6 +108,7 @@ class FileWrite : public Stk
 
   FILE *fd_;
   FILE_TYPE fileType_;
+  StkFloat fileRate_;
   StkFormat dataType_;
   unsigned int channels_;
   unsigned long frameCounter_;
@@ -0,0 +1,152 @@
+/***************************************************/
+/*! \class FileWriteQueue
+    \brief STK background file writing class.
+
+    This class writes buffers of audio data to a FileWrite object on
+    a dedicated I/O thread, fed through a lock-free single-producer /
+    single-consumer ring.  It is used by FileWvOut in asynchronous
+    mode, so that its tick() functions never wait for the disk.
+*/
+/***************************************************/
+
+#include "FileWriteQueue.h"
+#include <chrono>
+#include <cstring>
+
+namespace stk {
+
+FileWriteQueue :: FileWriteQueue( void )
+  : file_(0), nSlots_(0), mask_(0), head_(0), tail_(0), maxBacklog_(0), overruns_(0),
+    droppedFrames_(0), writeErrors_(0), quit_(false)
+{
+}
+
+FileWriteQueue :: ~FileWriteQueue( void )
+{
+  this->close();
+}
+
+void FileWriteQueue :: open( FileWrite *file, unsigned int bufferFrames, unsigned int nChannels, unsigned int nBuffers )
+{
+  this->close();
+
+  if ( bufferFrames == 0 || nBuffers < 2 ) {
+    oStream_ << "FileWriteQueue::open: bufferFrames must be greater than zero and nBuffers at least 2!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  file_ = file;
+
+  // A power of two, so slots are found by masking the (wrapping) counters.
+  nSlots_ = 1;
+  while ( nSlots_ < nBuffers ) nSlots_ <<= 1;
+  mask_ = nSlots_ - 1;
+  slots_.reset( new Slot[nSlots_] );
+  for ( unsigned int i=0; i<nSlots_; i++ ) {
+    slots_[i].frames.resize( bufferFrames, nChannels );
+    slots_[i].nFrames = 0;
+  }
+
+  head_.store( 0 );
+  tail_.store( 0 );
+  maxBacklog_.store( 0 );
+  overruns_.store( 0 );
+  droppedFrames_.store( 0 );
+  writeErrors_.store( 0 );
+  quit_.store( false );
+
+  thread_ = std::thread( &FileWriteQueue::run, this );
+}
+
+void FileWriteQueue :: close( void )
+{
+  if ( thread_.joinable() ) {
+    quit_.store( true );
+    wake_.post();
+    thread_.join(); // the I/O thread writes everything queued before it stops
+  }
+
+  slots_.reset();
+  nSlots_ = 0;
+  mask_ = 0;
+  file_ = 0;
+}
+
+bool FileWriteQueue :: push( const StkFrames& frames, unsigned int nFrames, bool wait )
+{
+  if ( nSlots_ == 0 ) return false;
+
+  unsigned long head = head_.load( std::memory_order_relaxed );
+  while ( head - tail_.load( std::memory_order_acquire ) >= nSlots_ ) {
+    if ( !wait ) {
+      // The disk has fallen too far behind: drop the data rather than wait.
+      overruns_.fetch_add( 1, std::memory_order_relaxed );
+      droppedFrames_.fetch_add( nFrames, std::memory_order_relaxed );
+      return false;
+    }
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+  }
+
+  Slot& slot = slots_[head & mask_];
+  if ( nFrames > slot.frames.frames() ) nFrames = slot.frames.frames();
+  unsigned int nSamples = nFrames * slot.frames.channels();
+  for ( unsigned int i=0; i<nSamples; i++ ) slot.frames[i] = frames[i];
+  slot.nFrames = nFrames;
+
+  // Sequentially consistent with drain(), so either the I/O thread sees this buffer before
+  // it sleeps or this sees that the ring was empty (the I/O thread is asleep) and wakes it.
+  head_.store( head + 1 );
+  unsigned long tail = tail_.load();
+  if ( tail == head ) wake_.post();
+
+  unsigned int backlog = (unsigned int) ( head + 1 - tail );
+  if ( backlog > maxBacklog_.load( std::memory_order_relaxed ) )
+    maxBacklog_.store( backlog, std::memory_order_relaxed );
+
+  return true;
+}
+
+unsigned int FileWriteQueue :: getBacklog( void ) const
+{
+  return (unsigned int) ( head_.load( std::memory_order_acquire ) - tail_.load( std::memory_order_acquire ) );
+}
+
+// Write all queued buffers to the file.
+void FileWriteQueue :: drain( void )
+{
+  unsigned long tail = tail_.load( std::memory_order_relaxed );
+  while ( tail != head_.load() ) {
+    Slot& slot = slots_[tail & mask_];
+
+    try {
+      if ( slot.nFrames == slot.frames.frames() )
+        file_->write( slot.frames );
+      else if ( slot.nFrames > 0 ) {
+        // A partly filled buffer (the end of the recording).
+        StkFrames partial( slot.nFrames, slot.frames.channels() );
+        memcpy( &partial[0], &slot.frames[0], partial.size() * sizeof(StkFloat) );
+        file_->write( partial );
+      }
+    }
+    catch ( StkError& ) {
+      writeErrors_.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    tail_.store( ++tail );
+  }
+}
+
+void FileWriteQueue :: run( void )
+{
+  while ( true ) {
+    drain();
+    if ( quit_.load() ) break;
+
+    // Sleep until a buffer is pushed into the empty ring, or close() is called (no timeout).
+    wake_.wait();
+  }
+
+  drain();
+}
+
+} // stk namespace
@@ -0,0 +1,108 @@
+#ifndef STK_FILEWRITEQUEUE_H
+#define STK_FILEWRITEQUEUE_H
+
+#include "FileWrite.h"
+#include "Semaphore.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace stk {
+
+/***************************************************/
+/*! \class FileWriteQueue
+    \brief STK background file writing class.
+
+    This class writes buffers of audio data to a FileWrite object on
+    a dedicated I/O thread.  It is used by FileWvOut in asynchronous
+    mode, so that its tick() functions never wait for the disk.
+
+    The buffers are passed to the I/O thread through a lock-free
+    single-producer / single-consumer ring with a fixed number of
+    slots, all allocated when the queue is opened.  If the disk falls
+    so far behind that the ring is full, push() drops the buffer and
+    counts an overrun instead of waiting.  push() only wakes the I/O
+    thread when the ring was empty, through a Semaphore, which never
+    locks.  close() writes everything still queued before it returns.
+
+    push() may be called from the audio thread (one thread only).
+    All other functions should be called from a non-audio thread.
+*/
+/***************************************************/
+
+class FileWriteQueue : public Stk
+{
+ public:
+  //! Default constructor.
+  FileWriteQueue( void );
+
+  //! Class destructor (writes any queued buffers and stops the I/O thread).
+  ~FileWriteQueue( void );
+
+  //! Start writing buffers of up to \e bufferFrames frames to \e file, with \e nBuffers slots in the queue (rounded up to a power of two).
+  /*!
+    The file must already be open, and must not be written to or
+    closed by the caller until this queue is closed.
+  */
+  void open( FileWrite *file, unsigned int bufferFrames, unsigned int nChannels, unsigned int nBuffers = 8 );
+
+  //! Write all queued buffers to the file and stop the I/O thread.
+  void close( void );
+
+  //! Returns \e true if the I/O thread is running.
+  bool isOpen( void ) const { return thread_.joinable(); };
+
+  //! Audio thread: queue the first \e nFrames frames of \e frames for writing.
+  /*!
+    The data is copied into the next free slot.  If there is none,
+    the data is dropped and \e false is returned, unless \e wait is
+    true (only to be used off the audio thread), in which case the
+    call waits for a slot to become free.
+  */
+  bool push( const StkFrames& frames, unsigned int nFrames, bool wait = false );
+
+  //! Return the number of buffers waiting to be written.
+  unsigned int getBacklog( void ) const;
+
+  //! Return the largest backlog since the queue was opened.
+  unsigned int getMaxBacklog( void ) const { return maxBacklog_.load( std::memory_order_relaxed ); };
+
+  //! Return the number of buffers dropped because the queue was full.
+  unsigned long getOverruns( void ) const { return overruns_.load( std::memory_order_relaxed ); };
+
+  //! Return the number of frames dropped because the queue was full.
+  unsigned long getDroppedFrames( void ) const { return droppedFrames_.load( std::memory_order_relaxed ); };
+
+  //! Return the number of buffers the I/O thread failed to write.
+  unsigned long getWriteErrors( void ) const { return writeErrors_.load( std::memory_order_relaxed ); };
+
+ protected:
+
+  struct Slot {
+    StkFrames frames;
+    unsigned int nFrames;
+  };
+
+  void run( void );
+  void drain( void );
+
+  FileWrite *file_;
+  std::unique_ptr<Slot[]> slots_;
+  unsigned int nSlots_;
+  unsigned int mask_;                 // nSlots_ - 1 (nSlots_ is a power of two)
+
+  std::atomic<unsigned long> head_;   // slots pushed (written by the audio thread)
+  std::atomic<unsigned long> tail_;   // slots written (written by the I/O thread)
+  std::atomic<unsigned int> maxBacklog_;
+  std::atomic<unsigned long> overruns_;
+  std::atomic<unsigned long> droppedFrames_;
+  std::atomic<unsigned long> writeErrors_;
+  std::atomic<bool> quit_;
+
+  std::thread thread_;
+  Semaphore wake_;                    // posted when the ring goes from empty to not empty
+};
+
+} // stk namespace
+
+#endif
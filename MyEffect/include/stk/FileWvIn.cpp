@@ -21,6 +21,10 @@
     chunkThreshold (in sample frames) will be read incrementally in
     chunks of \e chunkSize each (also in sample frames).
 
+    Files loaded entirely into memory are shared through the
+    SampleCache, so all objects playing the same file hold a single
+    copy of its data, which is read from disk only once.
+
     When the file end is reached, subsequent calls to the tick()
     functions return zeros and isFinished() returns \e true.
 
@@ -38,7 +42,9 @@ namespace stk {
 
 FileWvIn :: FileWvIn( unsigned long chunkThreshold, unsigned long chunkSize )
   : finished_(true), interpolate_(false), time_(0.0), rate_(0.0),
-    chunkThreshold_(chunkThreshold), chunkSize_(chunkSize)
+    chunkThreshold_(chunkThreshold), chunkSize_(chunkSize),
+    streaming_(false), looping_(false), streamChunks_(4), raw_(false),
+    samples_(&data_), fileSize_(0)
 {
   Stk::addSampleRateAlert( this );
 }
@@ -46,7 +52,9 @@ FileWvIn :: FileWvIn( unsigned long chunkThreshold, unsigned long chunkSize )
 FileWvIn :: FileWvIn( std::string fileName, bool raw, bool doNormalize,
                       unsigned long chunkThreshold, unsigned long chunkSize )
   : finished_(true), interpolate_(false), time_(0.0), rate_(0.0),
-    chunkThreshold_(chunkThreshold), chunkSize_(chunkSize)
+    chunkThreshold_(chunkThreshold), chunkSize_(chunkSize),
+    streaming_(false), looping_(false), streamChunks_(4), raw_(false),
+    samples_(&data_), fileSize_(0)
 {
   openFile( fileName, raw, doNormalize );
   Stk::addSampleRateAlert( this );
@@ -66,46 +74,107 @@ void FileWvIn :: sampleRateChanged( StkFloat newRate, StkFloat oldRate )
 
 void FileWvIn :: closeFile( void )
 {
+  stream_.close();
   if ( file_.isOpen() ) file_.close();
+  shared_.reset();
+  samples_ = &data_;
+  fileSize_ = 0;
   finished_ = true;
   lastFrame_.resize( 0, 0 );
 }
 
 void FileWvIn :: openFile( std::string fileName, bool raw, bool doNormalize )
 {
+  // Hold on to the current data while loading, in case the same file is reopened.
+  std::shared_ptr<const StkFrames> previous = shared_;
+
   // Call close() in case another file is already open.
   this->closeFile();
 
-  // Attempt to open the file ... an error might be thrown here.
-  file_.open( fileName, raw );
+  fileName_ = fileName;
+  raw_ = raw;
+
+  // Load the whole file (or share it, if already loaded) unless it is large
+  // enough for chunking ... an error might be thrown here.
+  shared_ = SampleCache::load( fileName, raw, doNormalize, false, chunkThreshold_ );
+
+  if ( shared_ ) {
+    chunking_ = false;
+    samples_ = shared_.get();
+    fileSize_ = shared_->frames();
+    data_.resize( 0, shared_->channels() ); // keeps the channel count and rate
+    data_.setDataRate( shared_->dataRate() );
+  }
+  else {
+    // Attempt to open the file ... an error might be thrown here.
+    file_.open( fileName, raw );
+    fileSize_ = file_.fileSize();
 
-  // Determine whether chunking or not.
-  if ( file_.fileSize() > chunkThreshold_ ) {
     chunking_ = true;
     chunkPointer_ = 0;
     data_.resize( chunkSize_, file_.channels() );
     if ( doNormalize ) normalizing_ = true;
     else normalizing_ = false;
-  }
-  else {
-    chunking_ = false;
-    data_.resize( (size_t) file_.fileSize(), file_.channels() );
-  }
 
-  // Load all or part of the data.
-  file_.read( data_, 0, doNormalize );
+    // Load the first chunk of data.
+    file_.read( data_, 0, doNormalize );
+  }
 
   // Resize our lastFrame container.
-  lastFrame_.resize( 1, file_.channels() );
+  lastFrame_.resize( 1, data_.channels() );
 
   // Set default rate based on file sampling rate.
   this->setRate( data_.dataRate() / Stk::sampleRate() );
 
-  if ( doNormalize & !chunking_ ) this->normalize();
+  if ( streaming_ ) this->startStreaming();
 
   this->reset();
 }
 
+void FileWvIn :: openData( std::shared_ptr<const StkFrames> data )
+{
+  if ( !data || data->frames() == 0 ) {
+    oStream_ << "FileWvIn::openData: no data!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  this->closeFile();
+
+  shared_ = data;
+  chunking_ = false;
+  samples_ = shared_.get();
+  fileSize_ = shared_->frames();
+  data_.resize( 0, shared_->channels() ); // keeps the channel count and rate
+  data_.setDataRate( shared_->dataRate() );
+
+  lastFrame_.resize( 1, data_.channels() );
+  this->setRate( data_.dataRate() / Stk::sampleRate() );
+  this->reset();
+}
+
+void FileWvIn :: setStreaming( bool streaming, unsigned int nChunks )
+{
+  streaming_ = streaming;
+  streamChunks_ = nChunks;
+
+  if ( streaming_ ) this->startStreaming();
+  else stream_.close();
+}
+
+void FileWvIn :: startStreaming( void )
+{
+  if ( file_.isOpen() && chunking_ )
+    stream_.open( fileName_, raw_, normalizing_, chunkSize_, streamChunks_, looping_ );
+}
+
+const StkFrames* FileWvIn :: streamChunk( StkFloat& tyme )
+{
+  long chunk = stream_.chunkAt( tyme );
+  const StkFrames *frames = stream_.acquire( chunk, rate_ < 0.0 ? -1 : 1 );
+  tyme -= stream_.chunkStart( chunk );
+  return frames;
+}
+
 void FileWvIn :: reset(void)
 {
   time_ = (StkFloat) 0.0;
@@ -122,22 +191,29 @@ void FileWvIn :: normalize(void)
 void FileWvIn :: normalize( StkFloat peak )
 {
   // When chunking, the "normalization" scaling is performed by FileRead.
-  if ( chunking_ ) return;
+  if ( chunking_ || !shared_ ) return;
+
+  // The data may be shared with other objects, so scale a copy of it.
+  std::shared_ptr<StkFrames> data( new StkFrames( *shared_ ) );
+  data->setDataRate( shared_->dataRate() );
 
   size_t i;
   StkFloat max = 0.0;
 
-  for ( i=0; i<data_.size(); i++ ) {
-    if ( fabs( data_[i] ) > max )
-      max = (StkFloat) fabs((double) data_[i]);
+  for ( i=0; i<data->size(); i++ ) {
+    if ( fabs( (*data)[i] ) > max )
+      max = (StkFloat) fabs((double) (*data)[i]);
   }
 
   if ( max > 0.0 ) {
     max = 1.0 / max;
     max *= peak;
-    for ( i=0; i<data_.size(); i++ )
-      data_[i] *= max;
+    for ( i=0; i<data->size(); i++ )
+      (*data)[i] *= max;
   }
+
+  shared_ = data;
+  samples_ = data.get();
 }
 
 void FileWvIn :: setRate( StkFloat rate )
@@ -145,8 +221,11 @@ void FileWvIn :: setRate( StkFloat rate )
   rate_ = rate;
 
   // If negative rate and at beginning of sound, move pointer to end
-  // of sound.
-  if ( (rate_ < 0) && (time_ == 0.0) ) time_ = file_.fileSize() - 1.0;
+  // of sound (and have the I/O thread read ahead from there, if streaming).
+  if ( (rate_ < 0) && (time_ == 0.0) ) {
+    time_ = fileSize_ - 1.0;
+    if ( chunking_ && streaming_ ) stream_.prefetch( stream_.chunkAt( time_ ), -1 );
+  }
 
   if ( fmod( rate_, 1.0 ) != 0.0 ) interpolate_ = true;
   else interpolate_ = false;
@@ -158,8 +237,8 @@ void FileWvIn :: addTime( StkFloat time )
   time_ += time;
 
   if ( time_ < 0.0 ) time_ = 0.0;
-  if ( time_ > file_.fileSize() - 1.0 ) {
-    time_ = file_.fileSize() - 1.0;
+  if ( time_ > fileSize_ - 1.0 ) {
+    time_ = fileSize_ - 1.0;
     for ( unsigned int i=0; i<lastFrame_.size(); i++ ) lastFrame_[i] = 0.0;
     finished_ = true;
   }
@@ -176,14 +255,25 @@ StkFloat FileWvIn :: tick( unsigned int channel )
 
   if ( finished_ ) return 0.0;
 
-  if ( time_ < 0.0 || time_ > (StkFloat) ( file_.fileSize() - 1.0 ) ) {
+  if ( time_ < 0.0 || time_ > (StkFloat) ( fileSize_ - 1.0 ) ) {
     for ( unsigned int i=0; i<lastFrame_.size(); i++ ) lastFrame_[i] = 0.0;
     finished_ = true;
     return 0.0;
   }
 
   StkFloat tyme = time_;
-  if ( chunking_ ) {
+  const StkFrames *frames = samples_;
+  if ( chunking_ && streaming_ ) {
+
+    // Take the chunk from the I/O thread (output silence if it isn't ready).
+    frames = streamChunk( tyme );
+    if ( !frames ) {
+      for ( unsigned int i=0; i<lastFrame_.size(); i++ ) lastFrame_[i] = 0.0;
+      time_ += rate_;
+      return lastFrame_[channel];
+    }
+  }
+  else if ( chunking_ ) {
 
     // Check the time address vs. our current buffer limits.
     if ( ( time_ < (StkFloat) chunkPointer_ ) ||
@@ -209,11 +299,11 @@ StkFloat FileWvIn :: tick( unsigned int channel )
 
   if ( interpolate_ ) {
     for ( unsigned int i=0; i<lastFrame_.size(); i++ )
-      lastFrame_[i] = data_.interpolate( tyme, i );
+      lastFrame_[i] = frames->interpolate( tyme, i );
   }
   else {
     for ( unsigned int i=0; i<lastFrame_.size(); i++ )
-      lastFrame_[i] = data_( (size_t) tyme, i );
+      lastFrame_[i] = (*frames)( (size_t) tyme, i );
   }
 
   // Increment time, which can be negative.
@@ -224,7 +314,7 @@ StkFloat FileWvIn :: tick( unsigned int channel )
 
 StkFrames& FileWvIn :: tick( StkFrames& frames )
 {
-  if ( !file_.isOpen() ) {
+  if ( !this->isOpen() ) {
 #if defined(_STK_DEBUG_)
     oStream_ << "FileWvIn::tick(): no file data is loaded!";
     handleError( StkError::DEBUG_PRINT );
@@ -3,6 +3,8 @@
 
 #include "WvIn.h"
 #include "FileRead.h"
+#include "FileStream.h"
+#include "SampleCache.h"
 
 namespace stk {
 
@@ -27,7 +29,14 @@ namespace stk {
     This behavior is controlled by the optional constructor arguments
     \e chunkThreshold and \e chunkSize.  File sizes greater than \e
     chunkThreshold (in sample frames) will be read incrementally in
-    chunks of \e chunkSize each (also in sample frames).
+    chunks of \e chunkSize each (also in sample frames).  By default
+    the chunks are read inside tick(), which blocks at every chunk
+    boundary; in streaming mode (see setStreaming()) they are read
+    ahead on a background thread instead.
+
+    Files loaded entirely into memory are shared through the
+    SampleCache, so all objects playing the same file hold a single
+    copy of its data, which is read from disk only once.
 
     When the file end is reached, subsequent calls to the tick()
     functions return zeros and isFinished() returns \e true.
@@ -68,6 +77,17 @@ public:
   */
   virtual void openFile( std::string fileName, bool raw = false, bool doNormalize = true );
 
+  //! Play data already loaded into memory (e.g. by SampleCache::load()) instead of a file.
+  /*!
+    This shares the data, without copying it or accessing any file,
+    and resets the read position.  It does not allocate memory (once
+    data with the same number of channels has been opened), so it can
+    be called from an audio thread, provided that the caller also
+    holds a reference to the data (so it is never freed there).  An
+    StkError will be thrown if \e data is empty.
+  */
+  void openData( std::shared_ptr<const StkFrames> data );
+
   //! Close a file if one is open.
   virtual void closeFile( void );
 
@@ -89,7 +109,7 @@ public:
   virtual void normalize( StkFloat peak );
 
   //! Return the file size in sample frames.
-  virtual unsigned long getSize( void ) const { return file_.fileSize(); };
+  virtual unsigned long getSize( void ) const { return fileSize_; };
 
   //! Return the input file sample rate in Hz (not the data read rate).
   /*!
@@ -100,7 +120,7 @@ public:
   virtual StkFloat getFileRate( void ) const { return data_.dataRate(); };
 
   //! Query whether a file is open.
-  bool isOpen( void ) { return file_.isOpen(); };
+  bool isOpen( void ) { return file_.isOpen() || shared_; };
 
   //! Query whether reading is complete.
   bool isFinished( void ) const { return finished_; };
@@ -126,6 +146,22 @@ public:
   */
   void setInterpolate( bool doInterpolate ) { interpolate_ = doInterpolate; };
 
+  //! Turn background streaming of incrementally loaded files on/off.
+  /*!
+    In streaming mode, chunks are read ahead of the playback position
+    (in the direction of the read rate) by a dedicated I/O thread,
+    into a ring of \e nChunks buffers, so tick() never reads from
+    disk.  If playback reaches a chunk that hasn't been loaded yet,
+    tick() outputs zeros and counts an underrun (see getUnderruns())
+    instead of waiting.  This has no effect on files loaded entirely
+    into memory.  It can be called before or after openFile(), but
+    not while another thread is calling tick().
+  */
+  void setStreaming( bool streaming, unsigned int nChunks = 4 );
+
+  //! Return the number of streaming underruns since the file was opened.
+  unsigned long getUnderruns( void ) const { return stream_.getUnderruns(); };
+
   //! Return the specified channel value of the last computed frame.
   /*!
     If no file is loaded, the returned value is 0.0.  The \c
@@ -165,6 +201,12 @@ protected:
 
   void sampleRateChanged( StkFloat newRate, StkFloat oldRate );
 
+  // Start the I/O thread for the open file (if chunking).
+  void startStreaming( void );
+
+  // Streaming: the chunk holding frame \e tyme (made relative to it), or 0 on an underrun.
+  const StkFrames* streamChunk( StkFloat& tyme );
+
   FileRead file_;
   bool finished_;
   bool interpolate_;
@@ -176,6 +218,17 @@ protected:
   unsigned long chunkSize_;
   long chunkPointer_;
 
+  FileStream stream_;
+  bool streaming_;
+  bool looping_;
+  unsigned int streamChunks_;
+  std::string fileName_;
+  bool raw_;
+
+  std::shared_ptr<const StkFrames> shared_; // file data loaded entirely (see SampleCache)
+  const StkFrames *samples_;                // shared_ data, or data_ when chunking
+  unsigned long fileSize_;
+
 };
 
 inline StkFloat FileWvIn :: lastOut( unsigned int channel )
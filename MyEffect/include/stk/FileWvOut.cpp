@@ -17,6 +17,11 @@
     Currently, FileWvOut is non-interpolating and the output rate is
     always Stk::sampleRate().
 
+    By default, each full output buffer is written to disk from
+    within tick().  In asynchronous mode (see setAsynchronous()),
+    full buffers are instead queued for a background thread, so that
+    tick() never waits for the disk.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -26,12 +31,12 @@
 namespace stk {
 
 FileWvOut :: FileWvOut( unsigned int bufferFrames )
-  :bufferFrames_( bufferFrames )
+  :bufferFrames_( bufferFrames ), asynchronous_( false ), asyncBuffers_( 8 )
 {
 }
 
 FileWvOut::FileWvOut( std::string fileName, unsigned int nChannels, FileWrite::FILE_TYPE type, Stk::StkFormat format, unsigned int bufferFrames )
-  :bufferFrames_( bufferFrames )
+  :bufferFrames_( bufferFrames ), asynchronous_( false ), asyncBuffers_( 8 )
 {
   this->openFile( fileName, nChannels, type, format );
 }
@@ -46,7 +51,11 @@ void FileWvOut :: closeFile( void )
   if ( file_.isOpen() ) {
 
     // Output any remaining samples in the buffer before closing.
-    if ( bufferIndex_ > 0 ) {
+    if ( queue_.isOpen() ) {
+      if ( bufferIndex_ > 0 ) queue_.push( data_, bufferIndex_, true );
+      queue_.close(); // waits for the queued buffers to be written
+    }
+    else if ( bufferIndex_ > 0 ) {
       data_.resize( bufferIndex_, data_.channels() );
       file_.write( data_ );
     }
@@ -76,6 +85,19 @@ void FileWvOut :: openFile( std::string fileName,
 
   bufferIndex_ = 0;
   iData_ = 0;
+
+  if ( asynchronous_ ) queue_.open( &file_, bufferFrames_, nChannels, asyncBuffers_ );
+}
+
+void FileWvOut :: setAsynchronous( bool asynchronous, unsigned int nBuffers )
+{
+  asynchronous_ = asynchronous;
+  asyncBuffers_ = nBuffers;
+  if ( !file_.isOpen() ) return;
+
+  // Buffers already queued are written before any later ones.
+  if ( asynchronous_ ) queue_.open( &file_, bufferFrames_, data_.channels(), asyncBuffers_ );
+  else queue_.close();
 }
 
 void FileWvOut :: incrementFrame( void )
@@ -84,7 +106,8 @@ void FileWvOut :: incrementFrame( void )
   bufferIndex_++;
 
   if ( bufferIndex_ == bufferFrames_ ) {
-    file_.write( data_ );
+    if ( queue_.isOpen() ) queue_.push( data_, bufferFrames_ ); // dropped (and counted) if the queue is full
+    else file_.write( data_ );
     bufferIndex_ = 0;
     iData_ = 0;
   }
@@ -3,6 +3,7 @@
 
 #include "WvOut.h"
 #include "FileWrite.h"
+#include "FileWriteQueue.h"
 
 namespace stk {
 
@@ -25,6 +26,11 @@ namespace stk {
     Currently, FileWvOut is non-interpolating and the output rate is
     always Stk::sampleRate().
 
+    By default, each full output buffer is written to disk from
+    within tick().  In asynchronous mode (see setAsynchronous()),
+    full buffers are instead queued for a background thread, so that
+    tick() never waits for the disk.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -86,6 +92,27 @@ class FileWvOut : public WvOut
   */
   void tick( const StkFrames& frames );
 
+  //! Turn asynchronous (background thread) writing on/off.
+  /*!
+    In asynchronous mode, full buffers are handed to a background
+    thread through a queue of \e nBuffers buffers, and tick() never
+    writes to the file itself.  If the disk falls behind by more than
+    \e nBuffers buffers, further buffers are dropped and counted (see
+    getOverruns()) rather than waited for.  closeFile() writes all
+    queued data before closing the file.  This can be called before or
+    after openFile(), but not while another thread is calling tick().
+  */
+  void setAsynchronous( bool asynchronous, unsigned int nBuffers = 8 );
+
+  //! Return the number of buffers dropped in asynchronous mode since the file was opened.
+  unsigned long getOverruns( void ) const { return queue_.getOverruns(); };
+
+  //! Return the number of frames dropped in asynchronous mode since the file was opened.
+  unsigned long getDroppedFrames( void ) const { return queue_.getDroppedFrames(); };
+
+  //! Return the largest number of buffers waiting to be written in asynchronous mode since the file was opened.
+  unsigned int getMaxBacklog( void ) const { return queue_.getMaxBacklog(); };
+
  protected:
 
   void incrementFrame( void );
@@ -95,6 +122,10 @@ class FileWvOut : public WvOut
   unsigned int bufferIndex_;
   unsigned int iData_;
 
+  FileWriteQueue queue_;
+  bool asynchronous_;
+  unsigned int asyncBuffers_;
+
 };
 
 } // stk namespace
@@ -16,24 +16,39 @@
     This structure results in one extra multiply per computed sample,
     but allows easy control of the overall filter gain.
 
+    Outputs are computed as dot products over a doubled circular
+    buffer of inputs or, for blocks of outputs from long filters, by
+    FFT (overlap-save) convolution.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
 
 #include "Fir.h"
 #include <cmath>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 1 )
+  #define STK_FIR_SSE
+  #include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #define STK_FIR_NEON
+  #include <arm_neon.h>
+#endif
 
 namespace stk {
 
 Fir :: Fir()
+  : write_(0), fftBlock_(0), fftMinFrames_(0)
 {
   // The default constructor should setup for pass-through.
   b_.push_back( 1.0 );
 
-  inputs_.resize( 1, 1, 0.0 );
+  this->setTaps( true );
 }
 
 Fir :: Fir( std::vector<StkFloat> &coefficients )
+  : write_(0), fftBlock_(0), fftMinFrames_(0)
 {
   // Check the arguments.
   if ( coefficients.size() == 0 ) {
@@ -44,8 +59,7 @@ Fir :: Fir( std::vector<StkFloat> &coefficients )
   gain_ = 1.0;
   b_ = coefficients;
 
-  inputs_.resize( b_.size(), 1, 0.0 );
-  this->clear();
+  this->setTaps( true );
 }
 
 Fir :: ~Fir()
@@ -60,15 +74,149 @@ void Fir :: setCoefficients( std::vector<StkFloat> &coefficients, bool clearStat
     handleError( StkError::FUNCTION_ARGUMENT );
   }
 
-  if ( b_.size() != coefficients.size() ) {
-    b_ = coefficients;
-    inputs_.resize( b_.size(), 1, 0.0 );
-  }
+  bool resized = b_.size() != coefficients.size();
+  if ( resized ) b_ = coefficients;
   else {
     for ( unsigned int i=0; i<b_.size(); i++ ) b_[i] = coefficients[i];
   }
 
+  this->setTaps( resized );
   if ( clearState ) this->clear();
 }
 
+void Fir :: setTaps( bool clearState )
+{
+  unsigned int i, nTaps = b_.size();
+  taps_.resize( nTaps );
+  for ( i=0; i<nTaps; i++ ) taps_[i] = b_[nTaps-1-i];
+
+  if ( clearState ) {
+    inputs_.resize( 2 * nTaps, 1, 0.0 );
+    write_ = 0;
+  }
+
+  fftBlock_ = 0;
+  if ( nTaps < FFT_MIN_TAPS ) {
+    spectrum_.clear();
+    window_.clear();
+    return;
+  }
+
+  // Each FFT of 2^k >= 2 * nTaps inputs gives the outputs for 2^k - nTaps + 1 of them.  It is
+  // used for a block of outputs when it takes fewer operations than dot products would.
+  unsigned int size = 2;
+  while ( size < 2 * nTaps ) size <<= 1;
+  fft_.setSize( size );
+  fftBlock_ = size - nTaps + 1;
+
+  unsigned int log2Size = 0;
+  while ( ( 1u << log2Size ) < size ) log2Size++;
+  fftMinFrames_ = ( 12 * size * log2Size ) / nTaps + 1;
+  if ( fftMinFrames_ > fftBlock_ ) fftBlock_ = 0;
+
+  spectrum_.assign( size, 0.0 );
+  for ( i=0; i<nTaps; i++ ) spectrum_[i] = b_[i];
+  fft_.forward( &spectrum_[0], &spectrum_[0] );
+  window_.resize( size );
+}
+
+void Fir :: tickBlock( StkFloat *iSamples, unsigned int iHop, StkFloat *oSamples, unsigned int oHop, unsigned int nFrames )
+{
+  if ( nFrames == 0 ) return;
+
+  unsigned int nTaps = taps_.size();
+  while ( fftBlock_ && nFrames >= fftMinFrames_ ) {
+    unsigned int count = ( nFrames < fftBlock_ ) ? nFrames : fftBlock_;
+    this->tickFft( iSamples, iHop, oSamples, oHop, count );
+    iSamples += count * iHop;
+    oSamples += count * oHop;
+    nFrames -= count;
+  }
+
+  for ( unsigned int j=0; j<nFrames; j++, iSamples += iHop, oSamples += oHop ) {
+    StkFloat *history = &inputs_[write_];
+    history[0] = history[nTaps] = gain_ * *iSamples;
+    if ( ++write_ == nTaps ) write_ = 0;
+    *oSamples = dotProduct( &taps_[0], history + 1, nTaps );
+  }
+
+  lastFrame_[0] = *(oSamples-oHop);
+}
+
+void Fir :: tickFft( StkFloat *iSamples, unsigned int iHop, StkFloat *oSamples, unsigned int oHop, unsigned int nFrames )
+{
+  // Overlap-save: transform the last nTaps - 1 inputs and the new ones, multiply by the
+  // coefficients' spectrum and keep the outputs not wrapped around by the circular convolution.
+  unsigned int j, nTaps = taps_.size(), size = fft_.getSize();
+  StkFloat *window = &window_[0];
+  memcpy( window, &inputs_[write_+1], ( nTaps - 1 ) * sizeof( StkFloat ) );
+  for ( j=0; j<nFrames; j++, iSamples += iHop )
+    window[nTaps-1+j] = gain_ * *iSamples;
+  for ( j=nTaps-1+nFrames; j<size; j++ ) window[j] = 0.0;
+
+  // The last nTaps inputs become the history (before the outputs overwrite the inputs).
+  memcpy( &inputs_[0], &window[nFrames-1], nTaps * sizeof( StkFloat ) );
+  memcpy( &inputs_[nTaps], &window[nFrames-1], nTaps * sizeof( StkFloat ) );
+  write_ = 0;
+
+  fft_.forward( window, window );
+  FFT::multiply( window, window, &spectrum_[0], size );
+  fft_.inverse( window, window );
+
+  for ( j=0; j<nFrames; j++, oSamples += oHop )
+    *oSamples = window[nTaps-1+j];
+}
+
+StkFloat Fir :: vectorDotProduct( const StkFloat *a, const StkFloat *b, unsigned int size )
+{
+  // Sixteen partial sums (lane i holds the products of elements i, i + 16, ...) added in the
+  // same order by every version, so that all give identical results.
+  unsigned int i = 0, blocks = size & ~15u;
+  StkFloat sum;
+
+#if defined(STK_FIR_SSE)
+  if ( sizeof(StkFloat) == sizeof(float) ) {
+    const float *x = (const float *) a, *y = (const float *) b;
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps(), s2 = _mm_setzero_ps(), s3 = _mm_setzero_ps();
+    for ( ; i<blocks; i+=16 ) {
+      s0 = _mm_add_ps( s0, _mm_mul_ps( _mm_loadu_ps( x+i ), _mm_loadu_ps( y+i ) ) );
+      s1 = _mm_add_ps( s1, _mm_mul_ps( _mm_loadu_ps( x+i+4 ), _mm_loadu_ps( y+i+4 ) ) );
+      s2 = _mm_add_ps( s2, _mm_mul_ps( _mm_loadu_ps( x+i+8 ), _mm_loadu_ps( y+i+8 ) ) );
+      s3 = _mm_add_ps( s3, _mm_mul_ps( _mm_loadu_ps( x+i+12 ), _mm_loadu_ps( y+i+12 ) ) );
+    }
+    float lanes[4];
+    _mm_storeu_ps( lanes, _mm_add_ps( _mm_add_ps( s0, s2 ), _mm_add_ps( s1, s3 ) ) );
+    sum = ( lanes[0] + lanes[2] ) + ( lanes[1] + lanes[3] );
+  }
+  else
+#elif defined(STK_FIR_NEON)
+  if ( sizeof(StkFloat) == sizeof(float) ) {
+    const float *x = (const float *) a, *y = (const float *) b;
+    float32x4_t s0 = vdupq_n_f32( 0.0f ), s1 = s0, s2 = s0, s3 = s0;
+    for ( ; i<blocks; i+=16 ) {
+      s0 = vaddq_f32( s0, vmulq_f32( vld1q_f32( x+i ), vld1q_f32( y+i ) ) );
+      s1 = vaddq_f32( s1, vmulq_f32( vld1q_f32( x+i+4 ), vld1q_f32( y+i+4 ) ) );
+      s2 = vaddq_f32( s2, vmulq_f32( vld1q_f32( x+i+8 ), vld1q_f32( y+i+8 ) ) );
+      s3 = vaddq_f32( s3, vmulq_f32( vld1q_f32( x+i+12 ), vld1q_f32( y+i+12 ) ) );
+    }
+    float lanes[4];
+    vst1q_f32( lanes, vaddq_f32( vaddq_f32( s0, s2 ), vaddq_f32( s1, s3 ) ) );
+    sum = ( lanes[0] + lanes[2] ) + ( lanes[1] + lanes[3] );
+  }
+  else
+#endif
+  {
+    StkFloat s[16] = { 0.0 };
+    for ( ; i<blocks; i+=16 ) {
+      for ( unsigned int k=0; k<16; k++ ) s[k] += a[i+k] * b[i+k];
+    }
+    StkFloat lanes[4];
+    for ( unsigned int k=0; k<4; k++ ) lanes[k] = ( s[k] + s[k+8] ) + ( s[k+4] + s[k+12] );
+    sum = ( lanes[0] + lanes[2] ) + ( lanes[1] + lanes[3] );
+  }
+
+  for ( ; i<size; i++ ) sum += a[i] * b[i];
+  return sum;
+}
+
 } // stk namespace
@@ -2,6 +2,7 @@
 #define STK_FIR_H
 
 #include "Filter.h"
+#include "FFT.h"
 
 namespace stk {
 
@@ -23,6 +24,16 @@ namespace stk {
     This structure results in one extra multiply per computed sample,
     but allows easy control of the overall filter gain.
 
+    The input history is kept in a circular buffer stored twice over,
+    so that the last \e nb + 1 inputs are always contiguous and each
+    output is a single dot product (vectorized with SSE or NEON where
+    available) rather than a shift of the whole history.  The
+    StkFrames tick() functions of filters with more than a few dozen
+    coefficients compute blocks of outputs by FFT (overlap-save)
+    convolution instead, whenever that takes fewer operations.  Both
+    methods produce the same outputs, to within rounding, and neither
+    adds latency.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -81,19 +92,43 @@ public:
 
 protected:
 
+  // Filters with fewer coefficients are never computed by FFT.
+  static const unsigned int FFT_MIN_TAPS = 32;
+
+  void setTaps( bool clearState );
+  void tickBlock( StkFloat *iSamples, unsigned int iHop, StkFloat *oSamples, unsigned int oHop, unsigned int nFrames );
+  void tickFft( StkFloat *iSamples, unsigned int iHop, StkFloat *oSamples, unsigned int oHop, unsigned int nFrames );
+  static StkFloat dotProduct( const StkFloat *a, const StkFloat *b, unsigned int size );
+  static StkFloat vectorDotProduct( const StkFloat *a, const StkFloat *b, unsigned int size );
+
+  // inputs_ holds the last b_.size() inputs twice over (with the gain applied).
+  unsigned int write_;                  // the next position written in inputs_
+  std::vector<StkFloat> taps_;          // the coefficients in reverse order
+  unsigned int fftBlock_;               // the most outputs computed per FFT (0 = never use the FFT)
+  unsigned int fftMinFrames_;           // the fewest outputs worth computing by FFT
+  FFT fft_;
+  std::vector<StkFloat> spectrum_;      // the coefficients' spectrum
+  std::vector<StkFloat> window_;        // FFT work space
 };
 
-inline StkFloat Fir :: tick( StkFloat input )
+inline StkFloat Fir :: dotProduct( const StkFloat *a, const StkFloat *b, unsigned int size )
 {
-  lastFrame_[0] = 0.0;
-  inputs_[0] = gain_ * input;
+  if ( size >= 16 ) return vectorDotProduct( a, b, size );
 
-  for ( unsigned int i=b_.size()-1; i>0; i-- ) {
-    lastFrame_[0] += b_[i] * inputs_[i];
-    inputs_[i] = inputs_[i-1];
-  }
-  lastFrame_[0] += b_[0] * inputs_[0];
+  StkFloat sum = 0.0;
+  for ( unsigned int i=0; i<size; i++ ) sum += a[i] * b[i];
+  return sum;
+}
 
+inline StkFloat Fir :: tick( StkFloat input )
+{
+  // The oldest to the newest inputs then start after the one just written.
+  unsigned int nTaps = taps_.size();
+  StkFloat *history = &inputs_[write_];
+  history[0] = history[nTaps] = gain_ * input;
+  if ( ++write_ == nTaps ) write_ = 0;
+
+  lastFrame_[0] = dotProduct( &taps_[0], history + 1, nTaps );
   return lastFrame_[0];
 }
 
@@ -107,19 +142,8 @@ inline StkFrames& Fir :: tick( StkFrames& frames, unsigned int channel )
 #endif
 
   StkFloat *samples = &frames[channel];
-  unsigned int i, hop = frames.channels();
-  for ( unsigned int j=0; j<frames.frames(); j++, samples += hop ) {
-    inputs_[0] = gain_ * *samples;
-    *samples = 0.0;
-
-    for ( i=b_.size()-1; i>0; i-- ) {
-      *samples += b_[i] * inputs_[i];
-      inputs_[i] = inputs_[i-1];
-    }
-    *samples += b_[0] * inputs_[0];
-  }
-
-  lastFrame_[0] = *(samples-hop);
+  unsigned int hop = frames.channels();
+  this->tickBlock( samples, hop, samples, hop, frames.frames() );
   return frames;
 }
 
@@ -132,21 +156,7 @@ inline StkFrames& Fir :: tick( StkFrames& iFrames, StkFrames& oFrames, unsigned
   }
 #endif
 
-  StkFloat *iSamples = &iFrames[iChannel];
-  StkFloat *oSamples = &oFrames[oChannel];
-  unsigned int i, iHop = iFrames.channels(), oHop = oFrames.channels();
-  for ( unsigned int j=0; j<iFrames.frames(); j++, iSamples += iHop, oSamples += oHop ) {
-    inputs_[0] = gain_ * *iSamples;
-    *oSamples = 0.0;
-
-    for ( i=b_.size()-1; i>0; i-- ) {
-      *oSamples += b_[i] * inputs_[i];
-      inputs_[i] = inputs_[i-1];
-    }
-    *oSamples += b_[0] * inputs_[0];
-  }
-
-  lastFrame_[0] = *(oSamples-oHop);
+  this->tickBlock( &iFrames[iChannel], iFrames.channels(), &oFrames[oChannel], oFrames.channels(), iFrames.frames() );
   return iFrames;
 }
 
@@ -120,14 +120,6 @@ class FreeVerb : public Effect
   //! Update interdependent parameters.
   void update( void );
 
-  // Clamp very small floats to zero, version from
-  // http://music.columbia.edu/pipermail/linux-audio-user/2004-July/013489.html .
-  // However, this is for 32-bit floats only.
-  //static inline StkFloat undenormalize( volatile StkFloat s ) { 
-  //  s += 9.8607615E-32f; 
-  //  return s - 9.8607615E-32f; 
-  //}
-    
   static const int nCombs = 8;
   static const int nAllpasses = 4;
   static const int stereoSpread = 23;
@@ -194,14 +186,12 @@ inline StkFloat FreeVerb::tick( StkFloat inputL, StkFloat inputR, unsigned int c
   // Parallel LBCF filters
   for ( int i = 0; i < nCombs; i++ ) {
     // Left channel
-    //StkFloat yn = fInput + (roomSize_ * FreeVerb::undenormalize(combLPL_[i].tick(FreeVerb::undenormalize(combDelayL_[i].nextOut()))));
-    StkFloat yn = fInput + (roomSize_ * combLPL_[i].tick( combDelayL_[i].nextOut() ) );
+    StkFloat yn = fInput + (roomSize_ * undenormalize( combLPL_[i].tick( undenormalize( combDelayL_[i].nextOut() ) ) ) );
     combDelayL_[i].tick(yn);
     outL += yn;
 
     // Right channel
-    //yn = fInput + (roomSize_ * FreeVerb::undenormalize(combLPR_[i].tick(FreeVerb::undenormalize(combDelayR_[i].nextOut()))));
-    yn = fInput + (roomSize_ * combLPR_[i].tick( combDelayR_[i].nextOut() ) );
+    yn = fInput + (roomSize_ * undenormalize( combLPR_[i].tick( undenormalize( combDelayR_[i].nextOut() ) ) ) );
     combDelayR_[i].tick(yn);
     outR += yn;
   }
@@ -209,8 +199,7 @@ inline StkFloat FreeVerb::tick( StkFloat inputL, StkFloat inputR, unsigned int c
   // Series allpass filters
   for ( int i = 0; i < nAllpasses; i++ ) {
     // Left channel
-    //StkFloat vn_m = FreeVerb::undenormalize(allPassDelayL_[i].nextOut());
-    StkFloat vn_m = allPassDelayL_[i].nextOut();
+    StkFloat vn_m = undenormalize( allPassDelayL_[i].nextOut() );
     StkFloat vn = outL + (g_ * vn_m);
     allPassDelayL_[i].tick(vn);
         
@@ -218,8 +207,7 @@ inline StkFloat FreeVerb::tick( StkFloat inputL, StkFloat inputR, unsigned int c
     outL = -vn + (1.0 + g_)*vn_m;
 
     // Right channel
-    //vn_m = FreeVerb::undenormalize(allPassDelayR_[i].nextOut());
-    vn_m = allPassDelayR_[i].nextOut();
+    vn_m = undenormalize( allPassDelayR_[i].nextOut() );
     vn = outR + (g_ * vn_m);
     allPassDelayR_[i].tick(vn);
 
@@ -20,15 +20,33 @@
     This structure results in one extra multiply per computed sample,
     but allows easy control of the overall filter gain.
 
+    Above second order, the coefficients are factored into a cascade
+    of second-order sections, run in transposed direct form II (see
+    Iir.h).
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
 
 #include "Iir.h"
+#include <algorithm>
+#include <complex>
+
+#if defined(__SSE__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 1 )
+  #define STK_IIR_SSE
+  #include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #define STK_IIR_NEON
+  #include <arm_neon.h>
+#endif
 
 namespace stk {
 
+// The StkFrames tick() functions filter this many frames at a time, in work_.
+static const unsigned int IIR_CHUNK = 256;
+
 Iir :: Iir()
+  : nSections_(0), groups_(0), factored_(false)
 {
   // The default constructor should setup for pass-through.
   b_.push_back( 1.0 );
@@ -36,9 +54,14 @@ Iir :: Iir()
 
   inputs_.resize( 1, 1, 0.0 );
   outputs_.resize( 1, 1, 0.0 );
+
+  work_.resize( IIR_CHUNK );
+  this->reserve();
+  this->factor();
 }
 
 Iir :: Iir( std::vector<StkFloat> &bCoefficients, std::vector<StkFloat> &aCoefficients )
+  : nSections_(0), groups_(0), factored_(false)
 {
   // Check the arguments.
   if ( bCoefficients.size() == 0 || aCoefficients.size() == 0 ) {
@@ -57,6 +80,10 @@ Iir :: Iir( std::vector<StkFloat> &bCoefficients, std::vector<StkFloat> &aCoeffi
 
   inputs_.resize( b_.size(), 1, 0.0 );
   outputs_.resize( a_.size(), 1, 0.0 );
+
+  work_.resize( IIR_CHUNK );
+  this->reserve();
+  this->factor();
   this->clear();
 }
 
@@ -83,11 +110,13 @@ void Iir :: setNumerator( std::vector<StkFloat> &bCoefficients, bool clearState
   if ( b_.size() != bCoefficients.size() ) {
     b_ = bCoefficients;
     inputs_.resize( b_.size(), 1, 0.0 );
+    this->reserve();
   }
   else {
     for ( unsigned int i=0; i<b_.size(); i++ ) b_[i] = bCoefficients[i];
   }
 
+  factored_ = false;
   if ( clearState ) this->clear();
 }
 
@@ -107,6 +136,7 @@ void Iir :: setDenominator( std::vector<StkFloat> &aCoefficients, bool clearStat
   if ( a_.size() != aCoefficients.size() ) {
     a_ = aCoefficients;
     outputs_.resize( a_.size(), 1, 0.0 );
+    this->reserve();
   }
   else {
     for ( unsigned int i=0; i<a_.size(); i++ ) a_[i] = aCoefficients[i];
@@ -120,6 +150,558 @@ void Iir :: setDenominator( std::vector<StkFloat> &aCoefficients, bool clearStat
     for ( i=0; i<b_.size(); i++ ) b_[i] /= a_[0];
     for ( i=1; i<a_.size(); i++ )  a_[i] /= a_[0];
   }
+
+  factored_ = false;
+}
+
+void Iir :: clear( void )
+{
+  Filter::clear();
+  std::fill( states_.begin(), states_.end(), 0.0 );
+}
+
+// Find the roots of c[0] z^n + c[1] z^(n-1) + ... + c[n] (with c[0] and c[n] nonzero) as the
+// eigenvalues of its companion matrix, balanced and then reduced by the shifted QR algorithm for
+// upper Hessenberg matrices (as balanc() and hqr() in Numerical Recipes).  Being computed in real
+// arithmetic, complex roots come in exact conjugate pairs.  The matrix and eigenvalues are kept in
+// \e scratch, which must hold ( n + 3 ) * ( n + 1 ) values, and \e roots must have room for n.
+// Returns false if the QR iterations do not converge.
+static bool iirRoots( const double *c, int n, double *scratch, std::vector< std::complex<double> > &roots )
+{
+  int i, j, k, l, m;
+  roots.clear();
+  if ( n < 1 ) return true;
+
+  // The matrix, indexed from 1 as h[i][j] = h[i * ( n + 1 ) + j].
+  double *h = scratch;
+  const int row = n + 1;
+  std::fill( h, h + row * row, 0.0 );
+  for ( j=1; j<=n; j++ ) h[row + j] = -c[j] / c[0];
+  for ( i=2; i<=n; i++ ) h[i * row + i - 1] = 1.0;
+
+  // Balance the rows and columns by powers of two.
+  bool done = false;
+  while ( !done ) {
+    done = true;
+    for ( i=1; i<=n; i++ ) {
+      double r = 0.0, s = 0.0;
+      for ( j=1; j<=n; j++ ) {
+        if ( j == i ) continue;
+        s += fabs( h[j * row + i] );
+        r += fabs( h[i * row + j] );
+      }
+      if ( s == 0.0 || r == 0.0 ) continue;
+      double f = 1.0, sum = s + r;
+      while ( s < r / 2.0 ) { f *= 2.0; s *= 4.0; }
+      while ( s > r * 2.0 ) { f /= 2.0; s /= 4.0; }
+      if ( ( s + r ) / f < 0.95 * sum ) {
+        done = false;
+        for ( j=1; j<=n; j++ ) h[i * row + j] /= f;
+        for ( j=1; j<=n; j++ ) h[j * row + i] *= f;
+      }
+    }
+  }
+
+  #define H( a, b ) h[(a) * row + (b)]
+  double *wr = h + row * row, *wi = wr + row;
+  double norm = 0.0, p = 0.0, q = 0.0, r = 0.0, s, t = 0.0, u, v, w, x, y, z;
+  for ( i=1; i<=n; i++ )
+    for ( j=std::max( i - 1, 1 ); j<=n; j++ ) norm += fabs( H( i, j ) );
+
+  int nn = n;
+  while ( nn >= 1 ) {
+    int iterations = 0;
+    do {
+      // Look for a single small subdiagonal element.
+      for ( l=nn; l>=2; l-- ) {
+        s = fabs( H( l-1, l-1 ) ) + fabs( H( l, l ) );
+        if ( s == 0.0 ) s = norm;
+        if ( fabs( H( l, l-1 ) ) + s == s ) {
+          H( l, l-1 ) = 0.0;
+          break;
+        }
+      }
+      x = H( nn, nn );
+      if ( l == nn ) {
+        // One root found.
+        wr[nn] = x + t;
+        wi[nn--] = 0.0;
+      }
+      else {
+        y = H( nn-1, nn-1 );
+        w = H( nn, nn-1 ) * H( nn-1, nn );
+        if ( l == nn - 1 ) {
+          // Two roots found.
+          p = 0.5 * ( y - x );
+          q = p * p + w;
+          z = sqrt( fabs( q ) );
+          x += t;
+          if ( q >= 0.0 ) {
+            z = p + ( p >= 0.0 ? z : -z );
+            wr[nn-1] = wr[nn] = x + z;
+            if ( z != 0.0 ) wr[nn] = x - w / z;
+            wi[nn-1] = wi[nn] = 0.0;
+          }
+          else {
+            wr[nn-1] = wr[nn] = x + p;
+            wi[nn-1] = -z;
+            wi[nn] = z;
+          }
+          nn -= 2;
+        }
+        else {
+          if ( iterations == 30 ) return false;
+          if ( iterations == 10 || iterations == 20 ) {
+            // Exceptional shift.
+            t += x;
+            for ( i=1; i<=nn; i++ ) H( i, i ) -= x;
+            s = fabs( H( nn, nn-1 ) ) + fabs( H( nn-1, nn-2 ) );
+            y = x = 0.75 * s;
+            w = -0.4375 * s * s;
+          }
+          ++iterations;
+
+          // Form the shift and look for two consecutive small subdiagonal elements.
+          for ( m=nn-2; m>=l; m-- ) {
+            z = H( m, m );
+            r = x - z;
+            s = y - z;
+            p = ( r * s - w ) / H( m+1, m ) + H( m, m+1 );
+            q = H( m+1, m+1 ) - z - r - s;
+            r = H( m+2, m+1 );
+            s = fabs( p ) + fabs( q ) + fabs( r );
+            p /= s;
+            q /= s;
+            r /= s;
+            if ( m == l ) break;
+            u = fabs( H( m, m-1 ) ) * ( fabs( q ) + fabs( r ) );
+            v = fabs( p ) * ( fabs( H( m-1, m-1 ) ) + fabs( z ) + fabs( H( m+1, m+1 ) ) );
+            if ( u + v == v ) break;
+          }
+          for ( i=m+2; i<=nn; i++ ) {
+            H( i, i-2 ) = 0.0;
+            if ( i != m + 2 ) H( i, i-3 ) = 0.0;
+          }
+
+          // The double QR step on rows l to nn and columns m to nn.
+          for ( k=m; k<=nn-1; k++ ) {
+            if ( k != m ) {
+              p = H( k, k-1 );
+              q = H( k+1, k-1 );
+              r = 0.0;
+              if ( k != nn - 1 ) r = H( k+2, k-1 );
+              if ( ( x = fabs( p ) + fabs( q ) + fabs( r ) ) != 0.0 ) {
+                p /= x;
+                q /= x;
+                r /= x;
+              }
+            }
+            s = sqrt( p * p + q * q + r * r );
+            if ( p < 0.0 ) s = -s;
+            if ( s != 0.0 ) {
+              if ( k == m ) {
+                if ( l != m ) H( k, k-1 ) = -H( k, k-1 );
+              }
+              else
+                H( k, k-1 ) = -s * x;
+              p += s;
+              x = p / s;
+              y = q / s;
+              z = r / s;
+              q /= p;
+              r /= p;
+              for ( j=k; j<=nn; j++ ) {
+                p = H( k, j ) + q * H( k+1, j );
+                if ( k != nn - 1 ) {
+                  p += r * H( k+2, j );
+                  H( k+2, j ) -= p * z;
+                }
+                H( k+1, j ) -= p * y;
+                H( k, j ) -= p * x;
+              }
+              int last = std::min( nn, k + 3 );
+              for ( i=l; i<=last; i++ ) {
+                p = x * H( i, k ) + y * H( i, k+1 );
+                if ( k != nn - 1 ) {
+                  p += z * H( i, k+2 );
+                  H( i, k+2 ) -= p * r;
+                }
+                H( i, k+1 ) -= p * q;
+                H( i, k ) -= p;
+              }
+            }
+          }
+        }
+      }
+    } while ( l < nn - 1 );
+  }
+  #undef H
+
+  for ( i=1; i<=n; i++ ) roots.push_back( std::complex<double>( wr[i], wi[i] ) );
+  return true;
+}
+
+// Group roots into factors of at most second order: complex pairs, then the real roots paired in
+// order of value, then \e delays factors of z^-1 (the first perhaps with the last real root).  The
+// real roots are sorted in \e reals.
+template<class Factor>
+static void iirFactors( const std::vector< std::complex<double> > &roots, unsigned int delays, std::vector<double> &reals, std::vector<Factor> &factors )
+{
+  Factor f;
+  reals.clear();
+  factors.clear();
+  for ( unsigned int i=0; i<roots.size(); i++ ) {
+    if ( roots[i].imag() == 0.0 ) reals.push_back( roots[i].real() );
+    else if ( roots[i].imag() > 0.0 ) {
+      f.c[0] = 1.0;
+      f.c[1] = -2.0 * roots[i].real();
+      f.c[2] = std::norm( roots[i] );
+      f.root = roots[i];
+      factors.push_back( f );
+    }
+  }
+
+  std::sort( reals.begin(), reals.end() );
+  unsigned int i = 0;
+  for ( ; i+1<reals.size(); i+=2 ) {
+    f.c[0] = 1.0;
+    f.c[1] = -( reals[i] + reals[i+1] );
+    f.c[2] = reals[i] * reals[i+1];
+    f.root = fabs( reals[i] ) > fabs( reals[i+1] ) ? reals[i] : reals[i+1];
+    factors.push_back( f );
+  }
+  if ( i < reals.size() ) {
+    if ( delays > 0 ) {
+      f.c[0] = 0.0; f.c[1] = 1.0; f.c[2] = -reals[i];
+      delays--;
+    }
+    else {
+      f.c[0] = 1.0; f.c[1] = -reals[i]; f.c[2] = 0.0;
+    }
+    f.root = reals[i];
+    factors.push_back( f );
+  }
+
+  f.root = 0.0;
+  for ( ; delays>=2; delays-=2 ) {
+    f.c[0] = 0.0; f.c[1] = 0.0; f.c[2] = 1.0;
+    factors.push_back( f );
+  }
+  if ( delays > 0 ) {
+    f.c[0] = 0.0; f.c[1] = 1.0; f.c[2] = 0.0;
+    factors.push_back( f );
+  }
+}
+
+// The index of the factor not yet \e used whose root is nearest \e root, which is then marked used.
+template<class Factor>
+static unsigned int iirNearest( const std::complex<double> &root, const std::vector<Factor> &factors, unsigned char *used )
+{
+  unsigned int nearest = 0;
+  double distance = -1.0;
+  for ( unsigned int i=0; i<factors.size(); i++ ) {
+    if ( used[i] ) continue;
+    double d = std::abs( factors[i].root - root );
+    if ( distance < 0.0 || d < distance ) {
+      distance = d;
+      nearest = i;
+    }
+  }
+  used[nearest] = 1;
+  return nearest;
+}
+
+void Iir :: reserve( void )
+{
+  // Size the scratch space for the order of the coefficients (it never shrinks), so that factor()
+  // does not allocate.
+  unsigned int n = std::max( b_.size(), a_.size() ) - 1, m = std::max( n, 1u ), groups = ( m + 3 ) / 4;
+  if ( matrix_.size() < ( n + 4 ) * ( n + 1 ) ) matrix_.resize( ( n + 4 ) * ( n + 1 ) );
+  if ( pairs_.size() < 2 * m ) pairs_.resize( 2 * m );
+  if ( used_.size() < 2 * m ) used_.resize( 2 * m );
+  reals_.reserve( n );
+  zeros_.reserve( n );
+  poles_.reserve( n );
+  numerators_.reserve( m );
+  denominators_.reserve( m );
+  sectionPoles_.reserve( m );
+  sectionZeros_.reserve( m );
+  sections_.reserve( groups * 20 );
+  states_.reserve( groups * 8 );
+}
+
+void Iir :: factor( void )
+{
+  unsigned int i, j, nb = b_.size(), na = a_.size(), delays = 0;
+  factored_ = true;
+
+  // Leading zeros of the numerator are a delay; trailing zeros (of either) do nothing.
+  while ( delays < nb && b_[delays] == 0.0 ) delays++;
+  if ( delays == nb ) delays = 0;
+  while ( nb > delays + 1 && b_[nb-1] == 0.0 ) nb--;
+  while ( na > 1 && a_[na-1] == 0.0 ) na--;
+
+  // Find the zeros and poles, unless the difference equation is of second order or less.  It does
+  // not use a[0] (the coefficients are normalized when they are set).
+  bool ok = std::max( nb, na ) > 3;
+  double *polynomial = &matrix_[0], *scratch = polynomial + std::max( nb, na );
+  if ( ok ) {
+    for ( i=delays; i<nb; i++ ) polynomial[i-delays] = b_[i];
+    ok = iirRoots( polynomial, nb - delays - 1, scratch, zeros_ );
+  }
+  if ( ok ) {
+    polynomial[0] = 1.0;
+    for ( i=1; i<na; i++ ) polynomial[i] = a_[i];
+    ok = iirRoots( polynomial, na - 1, scratch, poles_ );
+  }
+
+  for ( i=0; ok && i<zeros_.size(); i++ )
+    if ( !std::isfinite( zeros_[i].real() ) || !std::isfinite( zeros_[i].imag() ) ) ok = false;
+  for ( i=0; ok && i<poles_.size(); i++ )
+    if ( !std::isfinite( poles_[i].real() ) || !std::isfinite( poles_[i].imag() ) ) ok = false;
+  if ( !ok ) {
+    // Use the difference equation, starting from silence if the sections were running.
+    if ( nSections_ > 0 ) Filter::clear();
+    nSections_ = groups_ = 0;
+    sectionPoles_.clear();
+    sectionZeros_.clear();
+    return;
+  }
+
+  iirFactors( zeros_, delays, reals_, numerators_ );
+  iirFactors( poles_, 0, reals_, denominators_ );
+
+  unsigned int nSections = std::max( std::max( numerators_.size(), denominators_.size() ), (size_t) 1 );
+  Factor unity = { { 1.0, 0.0, 0.0 }, 0.0 };
+  numerators_.resize( nSections, unity );
+  denominators_.resize( nSections, unity );
+
+  // Section i is made from denominators_[pairs_[2*i]] and numerators_[pairs_[2*i+1]].
+  unsigned char *usedPoles = &used_[0], *usedZeros = usedPoles + nSections;
+  std::fill( usedPoles, usedPoles + 2 * nSections, 0 );
+  bool follow = nSections == nSections_ && sectionPoles_.size() == nSections;
+  if ( follow ) {
+    // The same number of sections: each keeps its place and state, taking the poles and then the
+    // zeros nearest its old ones, so that the sections of a sweep are not reordered or re-paired.
+    for ( i=0; i<nSections; i++ ) {
+      pairs_[2*i] = iirNearest( sectionPoles_[i], denominators_, usedPoles );
+      pairs_[2*i+1] = iirNearest( sectionZeros_[i], numerators_, usedZeros );
+    }
+  }
+  else {
+    // Sort the poles closest to the unit circle first (by insertion, which keeps the order of
+    // equals), match each in turn with the nearest remaining zeros, and run the sections in the
+    // opposite order, the most resonant last.  They start from zero.
+    for ( i=1; i<nSections; i++ ) {
+      Factor f = denominators_[i];
+      for ( j=i; j>0 && std::abs( denominators_[j-1].root ) < std::abs( f.root ); j-- )
+        denominators_[j] = denominators_[j-1];
+      denominators_[j] = f;
+    }
+    for ( i=0; i<nSections; i++ ) {
+      j = nSections - 1 - i;
+      pairs_[2*j] = i;
+      pairs_[2*j+1] = iirNearest( denominators_[i].root, numerators_, usedZeros );
+    }
+  }
+
+  this->setSectionCount( nSections );
+  if ( !follow ) std::fill( states_.begin(), states_.end(), 0.0 );
+
+  // The numerator's leading coefficient goes with the first section.
+  sectionPoles_.resize( nSections );
+  sectionZeros_.resize( nSections );
+  double scale = b_[delays];
+  for ( i=0; i<nSections; i++ ) {
+    const Factor &denominator = denominators_[pairs_[2*i]];
+    const Factor &numerator = numerators_[pairs_[2*i+1]];
+    StkFloat *c = &sections_[( i >> 2 ) * 20 + ( i & 3 )];
+    c[0] = (StkFloat) ( scale * numerator.c[0] );
+    c[4] = (StkFloat) ( scale * numerator.c[1] );
+    c[8] = (StkFloat) ( scale * numerator.c[2] );
+    c[12] = (StkFloat) denominator.c[1];
+    c[16] = (StkFloat) denominator.c[2];
+    sectionPoles_[i] = denominator.root;
+    sectionZeros_[i] = numerator.root;
+    scale = 1.0;
+  }
+}
+
+void Iir :: setSectionCount( unsigned int nSections )
+{
+  // The sections are stored in groups of four, padded with pass-through sections.  Their states
+  // are kept if the number is unchanged, and cleared otherwise.
+  if ( nSections == nSections_ ) return;
+  groups_ = ( nSections + 3 ) / 4;
+  sections_.assign( groups_ * 20, 0.0 );
+  states_.assign( groups_ * 8, 0.0 );
+  for ( unsigned int i=nSections; i<groups_*4; i++ ) sections_[( i >> 2 ) * 20 + ( i & 3 )] = 1.0;
+  nSections_ = nSections;
+}
+
+void Iir :: setSections( std::vector<StkFloat> &sections, bool clearState )
+{
+  // Check the argument.
+  if ( sections.size() == 0 || sections.size() % 6 != 0 ) {
+    oStream_ << "Iir::setSections: coefficient vector size must be a nonzero multiple of 6!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  unsigned int i, j, nSections = sections.size() / 6;
+  for ( i=0; i<nSections; i++ ) {
+    if ( sections[6*i+3] == 0.0 ) {
+      oStream_ << "Iir::setSections: a[0] coefficient cannot == 0!";
+      handleError( StkError::FUNCTION_ARGUMENT );
+    }
+  }
+
+  this->setSectionCount( nSections );
+
+  // Keep the difference equation (the product of the sections) for the other functions.
+  std::vector<double> b( 1, 1.0 ), a( 1, 1.0 );
+  for ( i=0; i<nSections; i++ ) {
+    const StkFloat *section = &sections[6*i];
+    double a0 = section[3];
+    StkFloat *c = &sections_[( i >> 2 ) * 20 + ( i & 3 )];
+    for ( j=0; j<3; j++ ) c[4*j] = (StkFloat) ( section[j] / a0 );
+    c[12] = (StkFloat) ( section[4] / a0 );
+    c[16] = (StkFloat) ( section[5] / a0 );
+
+    std::vector<double> bProduct( b.size() + 2, 0.0 ), aProduct( a.size() + 2, 0.0 );
+    for ( j=0; j<b.size(); j++ ) {
+      for ( unsigned int k=0; k<3; k++ ) {
+        bProduct[j+k] += b[j] * section[k] / a0;
+        aProduct[j+k] += a[j] * section[3+k] / a0;
+      }
+    }
+    b.swap( bProduct );
+    a.swap( aProduct );
+  }
+
+  if ( b_.size() != b.size() ) inputs_.resize( b.size(), 1, 0.0 );
+  if ( a_.size() != a.size() ) outputs_.resize( a.size(), 1, 0.0 );
+  b_.assign( b.begin(), b.end() );
+  a_.assign( a.begin(), a.end() );
+  this->reserve();
+
+  // The sections are not refactored, and have no poles and zeros to match new ones against.
+  factored_ = true;
+  sectionPoles_.clear();
+  sectionZeros_.clear();
+
+  if ( clearState ) this->clear();
+}
+
+// Run the samples in w through a group of four sections, in place.  Each sample passes through the
+// sections in turn.  The vector versions run the four as a pipeline, one section per lane: each
+// step feeds a new sample into the first lane and moves the other lanes' outputs along by one.
+// All versions compute the same values, in the same order, as Iir::tick( StkFloat ).
+static void iirGroup( const StkFloat *c, StkFloat *s, StkFloat *w, unsigned int n, unsigned int sections )
+{
+  unsigned int t;
+#if defined(STK_IIR_SSE)
+  if ( sizeof(StkFloat) == sizeof(float) ) {
+    const float *cf = (const float *) c;
+    float *sf = (float *) s, *wf = (float *) w;
+    const __m128 b0 = _mm_loadu_ps( cf ), b1 = _mm_loadu_ps( cf+4 ), b2 = _mm_loadu_ps( cf+8 );
+    const __m128 a1 = _mm_loadu_ps( cf+12 ), a2 = _mm_loadu_ps( cf+16 );
+    const __m128 lanes = _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f );
+    __m128 s1 = _mm_loadu_ps( sf ), s2 = _mm_loadu_ps( sf+4 ), y = _mm_setzero_ps();
+    for ( t=0; t<n+3; t++ ) {
+      __m128 x = _mm_shuffle_ps( y, y, _MM_SHUFFLE( 2, 1, 0, 0 ) );
+      x = _mm_move_ss( x, _mm_set_ss( t < n ? wf[t] : 0.0f ) );
+      y = _mm_add_ps( _mm_mul_ps( b0, x ), s1 );
+      __m128 next1 = _mm_add_ps( _mm_sub_ps( _mm_mul_ps( b1, x ), _mm_mul_ps( a1, y ) ), s2 );
+      __m128 next2 = _mm_sub_ps( _mm_mul_ps( b2, x ), _mm_mul_ps( a2, y ) );
+      if ( t >= 3 && t < n ) {
+        s1 = next1;
+        s2 = next2;
+      }
+      else {
+        // Filling or emptying the pipeline: only lanes k with 0 <= t - k < n hold a sample.
+        __m128 active = _mm_and_ps( _mm_cmple_ps( lanes, _mm_set1_ps( (float) t ) ),
+                                    _mm_cmpgt_ps( lanes, _mm_set1_ps( (float) t - (float) n ) ) );
+        s1 = _mm_or_ps( _mm_and_ps( active, next1 ), _mm_andnot_ps( active, s1 ) );
+        s2 = _mm_or_ps( _mm_and_ps( active, next2 ), _mm_andnot_ps( active, s2 ) );
+      }
+      if ( t >= 3 ) wf[t-3] = _mm_cvtss_f32( _mm_shuffle_ps( y, y, _MM_SHUFFLE( 3, 3, 3, 3 ) ) );
+    }
+    _mm_storeu_ps( sf, s1 );
+    _mm_storeu_ps( sf+4, s2 );
+    return;
+  }
+#elif defined(STK_IIR_NEON)
+  if ( sizeof(StkFloat) == sizeof(float) ) {
+    const float *cf = (const float *) c;
+    float *sf = (float *) s, *wf = (float *) w;
+    const float32x4_t b0 = vld1q_f32( cf ), b1 = vld1q_f32( cf+4 ), b2 = vld1q_f32( cf+8 );
+    const float32x4_t a1 = vld1q_f32( cf+12 ), a2 = vld1q_f32( cf+16 );
+    const float laneIndices[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    const float32x4_t lanes = vld1q_f32( laneIndices );
+    float32x4_t s1 = vld1q_f32( sf ), s2 = vld1q_f32( sf+4 ), y = vdupq_n_f32( 0.0f );
+    for ( t=0; t<n+3; t++ ) {
+      float32x4_t x = vsetq_lane_f32( t < n ? wf[t] : 0.0f, vextq_f32( y, y, 3 ), 0 );
+      y = vaddq_f32( vmulq_f32( b0, x ), s1 );
+      float32x4_t next1 = vaddq_f32( vsubq_f32( vmulq_f32( b1, x ), vmulq_f32( a1, y ) ), s2 );
+      float32x4_t next2 = vsubq_f32( vmulq_f32( b2, x ), vmulq_f32( a2, y ) );
+      if ( t >= 3 && t < n ) {
+        s1 = next1;
+        s2 = next2;
+      }
+      else {
+        // Filling or emptying the pipeline: only lanes k with 0 <= t - k < n hold a sample.
+        uint32x4_t active = vandq_u32( vcleq_f32( lanes, vdupq_n_f32( (float) t ) ),
+                                       vcgtq_f32( lanes, vdupq_n_f32( (float) t - (float) n ) ) );
+        s1 = vbslq_f32( active, next1, s1 );
+        s2 = vbslq_f32( active, next2, s2 );
+      }
+      if ( t >= 3 ) wf[t-3] = vgetq_lane_f32( y, 3 );
+    }
+    vst1q_f32( sf, s1 );
+    vst1q_f32( sf+4, s2 );
+    return;
+  }
+#endif
+
+  // One section at a time (skipping the padding).
+  for ( unsigned int k=0; k<sections; k++ ) {
+    StkFloat b0 = c[k], b1 = c[k+4], b2 = c[k+8], a1 = c[k+12], a2 = c[k+16];
+    StkFloat s1 = s[k], s2 = s[k+4], x, y;
+    for ( t=0; t<n; t++ ) {
+      x = w[t];
+      y = b0 * x + s1;
+      s1 = ( b1 * x - a1 * y ) + s2;
+      s2 = b2 * x - a2 * y;
+      w[t] = y;
+    }
+    s[k] = s1;
+    s[k+4] = s2;
+  }
+}
+
+void Iir :: tickBlock( StkFloat *iSamples, unsigned int iHop, StkFloat *oSamples, unsigned int oHop, unsigned int nFrames )
+{
+  unsigned int i;
+  if ( !factored_ ) this->factor();
+  if ( nSections_ == 0 ) {
+    for ( i=0; i<nFrames; i++, iSamples += iHop, oSamples += oHop )
+      *oSamples = this->tickDirect( *iSamples );
+    return;
+  }
+
+  StkFloat *w = &work_[0];
+  while ( nFrames > 0 ) {
+    unsigned int n = std::min( nFrames, IIR_CHUNK );
+    for ( i=0; i<n; i++ ) w[i] = gain_ * iSamples[i * iHop];
+    for ( unsigned int g=0; g<groups_; g++ )
+      iirGroup( &sections_[g * 20], &states_[g * 8], w, n, std::min( nSections_ - 4 * g, 4u ) );
+    for ( i=0; i<n; i++ ) oSamples[i * oHop] = w[i];
+
+    lastFrame_[0] = w[n-1];
+    iSamples += n * iHop;
+    oSamples += n * oHop;
+    nFrames -= n;
+  }
 }
 
 } // stk namespace
@@ -2,6 +2,7 @@
 #define STK_IIR_H
 
 #include "Filter.h"
+#include <complex>
 
 namespace stk {
 
@@ -27,6 +28,28 @@ namespace stk {
     This structure results in one extra multiply per computed sample,
     but allows easy control of the overall filter gain.
 
+    Filters of up to second order are computed from the difference
+    equation directly.  Above that it is slow and, above about 8th
+    order, numerically fragile, so the numerator and denominator are
+    factored (from the eigenvalues of their companion matrices) into a
+    cascade of second-order sections, with each pair of poles matched
+    to the nearest pair of zeros.  The factoring is done at the first
+    tick() after the coefficients are set (however many times they
+    were set), without allocating memory unless the order has grown.
+    While the number of sections is unchanged, each keeps its place
+    and state, following the poles and zeros nearest its old ones;
+    otherwise they are paired afresh and their states cleared.  The sections are
+    run in transposed direct form II.  The StkFrames tick() functions
+    run them in groups of four as a pipeline across SSE lanes (each
+    lane one sample behind the last), with identical results.  If the
+    factoring fails, the difference equation is used.
+
+    Rounded to single precision, the coefficients of a high-order
+    difference equation may no longer describe a stable filter (an
+    8th-order lowpass with a low cutoff is already too much), whatever
+    the structure used to compute it.  Such filters should be designed
+    as second-order sections and set with setSections().
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -107,11 +130,84 @@ public:
   */
   StkFrames& tick( StkFrames& iFrames, StkFrames &oFrames, unsigned int iChannel = 0, unsigned int oChannel = 0 );
 
+  //! Set the filter as a cascade of second-order sections, given in order as six coefficients each: b[0], b[1], b[2], a[0], a[1] and a[2].
+  /*!
+    The sections are used as given (normalized by their a[0]).  An
+    StkError can be thrown if the vector size is not a nonzero
+    multiple of six, or if an a[0] coefficient is equal to zero.  The
+    internal state of the filter is not cleared unless the \e
+    clearState flag is \c true.
+  */
+  void setSections( std::vector<StkFloat> &sections, bool clearState = false );
+
+  //! Return the number of second-order sections the filter is computed with (0 if it uses the difference equation).
+  /*!
+    The coefficients are factored first, if they have changed.
+  */
+  unsigned int getNumSections( void ) { if ( !factored_ ) this->factor(); return nSections_; };
+
+  //! Reset the filter state and the last output to zero.
+  void clear( void );
+
 protected:
 
+  // A first- or second-order factor c0 + c1 z^-1 + c2 z^-2 of the numerator or denominator, and its
+  // root of largest magnitude (the one with positive imaginary part, for a complex pair).
+  struct Factor
+  {
+    double c[3];
+    std::complex<double> root;
+  };
+
+  void factor( void );
+  void reserve( void );
+  void setSectionCount( unsigned int nSections );
+  StkFloat tickDirect( StkFloat input );
+  void tickBlock( StkFloat *iSamples, unsigned int iHop, StkFloat *oSamples, unsigned int oHop, unsigned int nFrames );
+
+  // The sections in groups of four: b0, b1, b2, a1 and a2 of each group in turn (groups_ * 20
+  // values), padded with pass-through sections; their states, s1 and s2 (groups_ * 8 values); and
+  // the pole and zero each was made from.
+  unsigned int nSections_;
+  unsigned int groups_;
+  std::vector<StkFloat> sections_;
+  std::vector<StkFloat> states_;
+  std::vector< std::complex<double> > sectionPoles_;
+  std::vector< std::complex<double> > sectionZeros_;
+  std::vector<StkFloat> work_;
+  bool factored_;
+
+  // Scratch space for factor(), reserved by reserve() for the current order.
+  std::vector<double> matrix_;
+  std::vector<double> reals_;
+  std::vector< std::complex<double> > zeros_;
+  std::vector< std::complex<double> > poles_;
+  std::vector<Factor> numerators_;
+  std::vector<Factor> denominators_;
+  std::vector<unsigned int> pairs_;
+  std::vector<unsigned char> used_;
 };
 
 inline StkFloat Iir :: tick( StkFloat input )
+{
+  if ( !factored_ ) this->factor();
+  if ( nSections_ == 0 ) return tickDirect( input );
+
+  StkFloat x = gain_ * input, y;
+  for ( unsigned int i=0; i<nSections_; i++ ) {
+    const StkFloat *c = &sections_[( i >> 2 ) * 20 + ( i & 3 )];
+    StkFloat *s = &states_[( i >> 2 ) * 8 + ( i & 3 )];
+    y = c[0] * x + s[0];
+    s[0] = ( c[4] * x - c[12] * y ) + s[4];
+    s[4] = c[8] * x - c[16] * y;
+    x = y;
+  }
+
+  lastFrame_[0] = x;
+  return lastFrame_[0];
+}
+
+inline StkFloat Iir :: tickDirect( StkFloat input )
 {
   unsigned int i;
 
@@ -142,25 +238,8 @@ inline StkFrames& Iir :: tick( StkFrames& frames, unsigned int channel )
 #endif
 
   StkFloat *samples = &frames[channel];
-  unsigned int i, hop = frames.channels();
-  for ( unsigned int j=0; j<frames.frames(); j++, samples += hop ) {
-    outputs_[0] = 0.0;
-    inputs_[0] = gain_ * *samples;
-    for ( i=b_.size()-1; i>0; i-- ) {
-      outputs_[0] += b_[i] * inputs_[i];
-      inputs_[i] = inputs_[i-1];
-    }
-    outputs_[0] += b_[0] * inputs_[0];
-
-    for ( i=a_.size()-1; i>0; i-- ) {
-      outputs_[0] += -a_[i] * outputs_[i];
-      outputs_[i] = outputs_[i-1];
-    }
-
-    *samples = outputs_[0];
-  }
-
-  lastFrame_[0] = *(samples-hop);
+  unsigned int hop = frames.channels();
+  this->tickBlock( samples, hop, samples, hop, frames.frames() );
   return frames;
 }
 
@@ -173,27 +252,7 @@ inline StkFrames& Iir :: tick( StkFrames& iFrames, StkFrames& oFrames, unsigned
   }
 #endif
 
-  StkFloat *iSamples = &iFrames[iChannel];
-  StkFloat *oSamples = &oFrames[oChannel];
-  unsigned int i, iHop = iFrames.channels(), oHop = oFrames.channels();
-  for ( unsigned int j=0; j<iFrames.frames(); j++, iSamples += iHop, oSamples += oHop ) {
-    outputs_[0] = 0.0;
-    inputs_[0] = gain_ * *iSamples;
-    for ( i=b_.size()-1; i>0; i-- ) {
-      outputs_[0] += b_[i] * inputs_[i];
-      inputs_[i] = inputs_[i-1];
-    }
-    outputs_[0] += b_[0] * inputs_[0];
-
-    for ( i=a_.size()-1; i>0; i-- ) {
-      outputs_[0] += -a_[i] * outputs_[i];
-      outputs_[i] = outputs_[i-1];
-    }
-
-    *oSamples = outputs_[0];
-  }
-
-  lastFrame_[0] = *(oSamples-oHop);
+  this->tickBlock( &iFrames[iChannel], iFrames.channels(), &oFrames[oChannel], oFrames.channels(), iFrames.frames() );
   return iFrames;
 }
 
@@ -121,28 +121,28 @@ inline StkFloat JCRev :: tick( StkFloat input, unsigned int channel )
   StkFloat temp, temp0, temp1, temp2, temp3, temp4, temp5, temp6;
   StkFloat filtout;
 
-  temp = allpassDelays_[0].lastOut();
+  temp = undenormalize( allpassDelays_[0].lastOut() );
   temp0 = allpassCoefficient_ * temp;
   temp0 += input;
   allpassDelays_[0].tick(temp0);
   temp0 = -(allpassCoefficient_ * temp0) + temp;
     
-  temp = allpassDelays_[1].lastOut();
+  temp = undenormalize( allpassDelays_[1].lastOut() );
   temp1 = allpassCoefficient_ * temp;
   temp1 += temp0;
   allpassDelays_[1].tick(temp1);
   temp1 = -(allpassCoefficient_ * temp1) + temp;
     
-  temp = allpassDelays_[2].lastOut();
+  temp = undenormalize( allpassDelays_[2].lastOut() );
   temp2 = allpassCoefficient_ * temp;
   temp2 += temp1;
   allpassDelays_[2].tick(temp2);
   temp2 = -(allpassCoefficient_ * temp2) + temp;
     
-  temp3 = temp2 + ( combFilters_[0].tick( combCoefficient_[0] * combDelays_[0].lastOut() ) );
-  temp4 = temp2 + ( combFilters_[1].tick( combCoefficient_[1] * combDelays_[1].lastOut() ) );
-  temp5 = temp2 + ( combFilters_[2].tick( combCoefficient_[2] * combDelays_[2].lastOut() ) );
-  temp6 = temp2 + ( combFilters_[3].tick( combCoefficient_[3] * combDelays_[3].lastOut() ) );
+  temp3 = temp2 + ( combFilters_[0].tick( combCoefficient_[0] * undenormalize( combDelays_[0].lastOut() ) ) );
+  temp4 = temp2 + ( combFilters_[1].tick( combCoefficient_[1] * undenormalize( combDelays_[1].lastOut() ) ) );
+  temp5 = temp2 + ( combFilters_[2].tick( combCoefficient_[2] * undenormalize( combDelays_[2].lastOut() ) ) );
+  temp6 = temp2 + ( combFilters_[3].tick( combCoefficient_[3] * undenormalize( combDelays_[3].lastOut() ) ) );
 
   combDelays_[0].tick(temp3);
   combDelays_[1].tick(temp4);
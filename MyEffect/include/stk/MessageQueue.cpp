@@ -0,0 +1,110 @@
+/***************************************************/
+/*! \class MessageQueue
+    \brief STK lock-free control message queue class.
+
+    This class is a bounded queue of time-stamped Skini::Message
+    structures, which any number of threads can push onto and one
+    thread can pop from, without locks.  Each slot carries a sequence
+    number telling whether it is free for the producers or filled for
+    the consumer, so producers only contend on claiming a slot.
+*/
+/***************************************************/
+
+#include "MessageQueue.h"
+#include <chrono>
+#include <cstddef>
+#include <utility>
+
+namespace stk {
+
+MessageQueue :: MessageQueue( unsigned int capacity )
+  : mask_(0), head_(0), tail_(0), overflows_(0)
+{
+  this->setCapacity( capacity );
+}
+
+void MessageQueue :: setCapacity( unsigned int capacity )
+{
+  size_t size = 2;
+  while ( size < capacity ) size <<= 1;
+
+  slots_.reset( new Slot[size] );
+  for ( size_t i=0; i<size; i++ ) {
+    slots_[i].sequence.store( i, std::memory_order_relaxed );
+    slots_[i].timeStamp = 0.0;
+  }
+
+  mask_ = size - 1;
+  head_.store( 0 );
+  tail_.store( 0 );
+  overflows_.store( 0 );
+}
+
+bool MessageQueue :: push( const Skini::Message& message, double timeStamp )
+{
+  if ( timeStamp < 0.0 ) timeStamp = now();
+
+  // Claim a free slot.
+  Slot *slot;
+  size_t position = head_.load( std::memory_order_relaxed );
+  while ( true ) {
+    slot = &slots_[position & mask_];
+    size_t sequence = slot->sequence.load( std::memory_order_acquire );
+    // Signed and as wide as the counters (long is only 32 bits on 64-bit Windows).
+    std::ptrdiff_t difference = (std::ptrdiff_t) ( sequence - position );
+    if ( difference == 0 ) {
+      if ( head_.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) ) break;
+    }
+    else if ( difference < 0 ) {
+      // The slot has not been popped since the last time around: the queue is full.
+      overflows_.fetch_add( 1, std::memory_order_relaxed );
+      return false;
+    }
+    else position = head_.load( std::memory_order_relaxed );
+  }
+
+  slot->message = message;
+  slot->timeStamp = timeStamp;
+  slot->sequence.store( position + 1, std::memory_order_release );
+  return true;
+}
+
+bool MessageQueue :: pop( Skini::Message& message, double *timeStamp )
+{
+  size_t position = tail_.load( std::memory_order_relaxed );
+  Slot& slot = slots_[position & mask_];
+  if ( slot.sequence.load( std::memory_order_acquire ) != position + 1 ) return false;
+
+  std::swap( message, slot.message );
+  if ( timeStamp ) *timeStamp = slot.timeStamp;
+
+  // Hand the slot back to the producers for their next time around.
+  slot.sequence.store( position + mask_ + 1, std::memory_order_release );
+  tail_.store( position + 1, std::memory_order_relaxed );
+  return true;
+}
+
+bool MessageQueue :: peek( double *timeStamp ) const
+{
+  size_t position = tail_.load( std::memory_order_relaxed );
+  const Slot& slot = slots_[position & mask_];
+  if ( slot.sequence.load( std::memory_order_acquire ) != position + 1 ) return false;
+
+  *timeStamp = slot.timeStamp;
+  return true;
+}
+
+unsigned int MessageQueue :: size( void ) const
+{
+  size_t tail = tail_.load( std::memory_order_relaxed );
+  size_t head = head_.load( std::memory_order_relaxed );
+  std::ptrdiff_t difference = (std::ptrdiff_t) ( head - tail );
+  return ( difference > 0 ) ? (unsigned int) difference : 0;
+}
+
+double MessageQueue :: now( void )
+{
+  return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+} // stk namespace
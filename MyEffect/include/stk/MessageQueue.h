@@ -0,0 +1,90 @@
+#ifndef STK_MESSAGEQUEUE_H
+#define STK_MESSAGEQUEUE_H
+
+#include "Skini.h"
+#include <atomic>
+#include <memory>
+
+namespace stk {
+
+/***************************************************/
+/*! \class MessageQueue
+    \brief STK lock-free control message queue class.
+
+    This class is a bounded queue of time-stamped Skini::Message
+    structures, which any number of threads (e.g. MIDI, socket and
+    stdin input) can push onto without locks, and one thread (the
+    audio thread) can pop from without locks, waiting or memory
+    allocation.  It is used by Messager.
+
+    All message slots are allocated when the capacity is set.  A
+    push onto a full queue fails rather than waits.  Each message is
+    stamped with a time in seconds on the now() clock, given by its
+    source or taken when it is pushed, so that the consumer can apply
+    it at the matching point within an audio block.
+*/
+/***************************************************/
+
+class MessageQueue : public Stk
+{
+ public:
+  //! Default constructor, with room for at least \e capacity messages.
+  MessageQueue( unsigned int capacity = 256 );
+
+  //! Set the capacity (rounded up to a power of two) and discard any queued messages.
+  /*!
+    This must not be called while other threads use the queue.
+  */
+  void setCapacity( unsigned int capacity );
+
+  //! Return the capacity.
+  unsigned int getCapacity( void ) const { return mask_ + 1; };
+
+  //! Any thread: queue a copy of \e message, stamped with \e timeStamp (or the current time if negative).
+  /*!
+    If the queue is full, the message is dropped and \e false is
+    returned.
+  */
+  bool push( const Skini::Message& message, double timeStamp = -1.0 );
+
+  //! Consumer thread: pop the oldest message and its time stamp.
+  /*!
+    Returns \e false if the queue is empty.  The message contents
+    are exchanged with the queue slot rather than copied, so no
+    memory is allocated.
+  */
+  bool pop( Skini::Message& message, double *timeStamp = 0 );
+
+  //! Consumer thread: return the time stamp of the oldest message without popping it.
+  /*!
+    Returns \e false if the queue is empty.
+  */
+  bool peek( double *timeStamp ) const;
+
+  //! Return the number of queued messages (only a snapshot while other threads use the queue).
+  unsigned int size( void ) const;
+
+  //! Return the number of messages dropped because the queue was full.
+  unsigned long getOverflows( void ) const { return overflows_.load( std::memory_order_relaxed ); };
+
+  //! Return the current time in seconds on the clock used for time stamps.
+  static double now( void );
+
+ protected:
+
+  struct Slot {
+    std::atomic<size_t> sequence;
+    Skini::Message message;
+    double timeStamp;
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t mask_;
+  std::atomic<size_t> head_;  // next slot to push (shared by the producers)
+  std::atomic<size_t> tail_;  // next slot to pop (written by the consumer)
+  std::atomic<unsigned long> overflows_;
+};
+
+} // stk namespace
+
+#endif
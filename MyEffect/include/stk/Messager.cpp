@@ -14,7 +14,11 @@
     socket, or stdin) take place asynchronously, filling the message
     queue.  A call to popMessage() will pop the next available control
     message from the queue and return it via the referenced Message
-    structure.  When a \e non-realtime scorefile is set, it is not
+    structure.  The queue is lock-free, so popMessage() never waits
+    for the input threads and can be called from an audio callback.
+    Messages are time-stamped by their source, so that they can be
+    applied at the right frame of an audio block (see startBlock()).
+    When a \e non-realtime scorefile is set, it is not
     possible to start reading realtime input messages (from MIDI,
     socket, or stdin).  Likewise, it is not possible to read from a
     scorefile when a realtime input mechanism is running.
@@ -44,6 +48,12 @@ namespace stk {
 extern "C" THREAD_RETURN THREAD_TYPE stdinHandler(void * ptr);
 extern "C" THREAD_RETURN THREAD_TYPE socketHandler(void * ptr);
 
+// Push a message from an input thread, waiting while the queue is full.
+static void queueMessage( Messager::MessagerData *data, const Skini::Message& message, double timeStamp = -1.0 )
+{
+  while ( !data->queue.push( message, timeStamp ) ) Stk::sleep( 50 );
+}
+
 #endif // __STK_REALTIME__
 
 static const int STK_FILE   = 0x1;
@@ -52,9 +62,11 @@ static const int STK_FILE   = 0x1;
 //static const int STK_SOCKET = 0x8;
 
 Messager :: Messager()
+  : blockTime_(-1.0), previousBlockTime_(-1.0), blockFrames_(0), lastFrame_(0)
 {
   data_.sources = 0;
   data_.queueLimit = DEFAULT_QUEUE_LIMIT;
+  data_.queue.setCapacity( data_.queueLimit );
 #if defined(__STK_REALTIME__)
   data_.socket = 0;
   data_.midi = 0;
@@ -64,14 +76,11 @@ Messager :: Messager()
 Messager :: ~Messager()
 {
   // Clear the queue in case any thread is waiting on its limit.
-#if defined(__STK_REALTIME__)
-  data_.mutex.lock();
-#endif
-  while ( data_.queue.size() ) data_.queue.pop();
+  Skini::Message message;
+  while ( data_.queue.pop( message ) );
   data_.sources = 0;
 
 #if defined(__STK_REALTIME__)
-  data_.mutex.unlock();
   if ( data_.socket ) {
     socketThread_.wait();
     delete data_.socket;
@@ -108,32 +117,59 @@ void Messager :: popMessage( Skini::Message& message )
     return;
   }
 
-  if ( data_.queue.size() == 0 ) {
-    // An empty (or invalid) message is indicated by a type = 0.
+  // Move the queued message to the message structure.  An empty (or
+  // invalid) message is indicated by a type = 0.
+  if ( !data_.queue.pop( message ) )
     message.type = 0;
+}
+
+void Messager :: startBlock( unsigned int nFrames )
+{
+  double now = MessageQueue::now();
+
+  // The first block covers the time of one block before it.
+  if ( blockTime_ < 0.0 && nFrames > 0 )
+    blockTime_ = now - nFrames / Stk::sampleRate();
+
+  previousBlockTime_ = blockTime_;
+  blockTime_ = now;
+  blockFrames_ = nFrames;
+  lastFrame_ = 0;
+}
+
+void Messager :: popMessage( Skini::Message& message, unsigned int *frame )
+{
+  *frame = 0;
+  if ( data_.sources == STK_FILE || blockTime_ < 0.0 ) {
+    this->popMessage( message );
     return;
   }
 
-  // Copy queued message to the message pointer structure and then "pop" it.
-#if defined(__STK_REALTIME__)
-  data_.mutex.lock();
-#endif
-  message = data_.queue.front();
-  data_.queue.pop();
-#if defined(__STK_REALTIME__)
-  data_.mutex.unlock();
-#endif
+  // Leave the messages received during this block for the next one.
+  double timeStamp;
+  if ( !data_.queue.peek( &timeStamp ) || timeStamp >= blockTime_ ) {
+    message.type = 0;
+    return;
+  }
+
+  data_.queue.pop( message );
+
+  // Map the message time between the starts of the previous block and
+  // this one onto the frames of this block.
+  double period = blockTime_ - previousBlockTime_;
+  if ( period > 0.0 && timeStamp > previousBlockTime_ ) {
+    double position = ( timeStamp - previousBlockTime_ ) / period * blockFrames_;
+    unsigned int offset = (unsigned int) position;
+    if ( offset >= blockFrames_ ) offset = ( blockFrames_ > 0 ) ? blockFrames_ - 1 : 0;
+    if ( offset > lastFrame_ ) lastFrame_ = offset;
+  }
+
+  *frame = lastFrame_;
 }
 
-void Messager :: pushMessage( Skini::Message& message )
+bool Messager :: pushMessage( Skini::Message& message )
 {
-#if defined(__STK_REALTIME__)
-  data_.mutex.lock();
-#endif
-  data_.queue.push( message );
-#if defined(__STK_REALTIME__)
-  data_.mutex.unlock();
-#endif
+  return data_.queue.push( message );
 }
 
 #if defined(__STK_REALTIME__)
@@ -166,6 +202,7 @@ THREAD_RETURN THREAD_TYPE stdinHandler(void *ptr)
 {
   Messager::MessagerData *data = (Messager::MessagerData *) ptr;
   Skini::Message message;
+  Skini skini; // each input thread parses with its own Skini object
 
   std::string line;
   while ( !std::getline( std::cin, line).eof() ) {
@@ -173,18 +210,14 @@ THREAD_RETURN THREAD_TYPE stdinHandler(void *ptr)
     if ( line.compare(0, 4, "Exit") == 0 || line.compare(0, 4, "exit") == 0 )
       break;
 
-    data->mutex.lock();
-    if ( data->skini.parseString( line, message ) )
-      data->queue.push( message );
-    data->mutex.unlock();
-
-    while ( data->queue.size() >= data->queueLimit ) Stk::sleep( 50 );
+    if ( skini.parseString( line, message ) )
+      queueMessage( data, message );
   }
 
   // We assume here that if someone types an "exit" message in the
   // terminal window, all processing should stop.
   message.type = __SK_Exit_;
-  data->queue.push( message );
+  queueMessage( data, message );
   data->sources &= ~STK_STDIN;
 
   return NULL;
@@ -217,11 +250,15 @@ void midiHandler( double timeStamp, std::vector<unsigned char> *bytes, void *ptr
       message.floatValues[1] = (StkFloat) message.intValues[1];
   }
 
-  while ( data->queue.size() >= data->queueLimit ) Stk::sleep( 50 );
+  // RtMidi time stamps are the delta times between messages.  Follow
+  // them, so that messages delivered together keep their spacing,
+  // but fall back to the arrival time when they drift away from it.
+  double arrival = MessageQueue::now();
+  data->midiTime += timeStamp;
+  if ( data->midiTime > arrival || arrival - data->midiTime > 0.01 )
+    data->midiTime = arrival;
 
-  data->mutex.lock();
-  data->queue.push( message );
-  data->mutex.unlock();
+  queueMessage( data, message, data->midiTime );
 }
 
 bool Messager :: startMidiInput( int port )
@@ -315,6 +352,7 @@ THREAD_RETURN THREAD_TYPE socketHandler(void *ptr)
 {
   Messager::MessagerData *data = (Messager::MessagerData *) ptr;
   Skini::Message message;
+  Skini skini; // each input thread parses with its own Skini object
   std::vector<int>& fd = data->fd;
 
   struct timeval timeout;
@@ -373,15 +411,13 @@ THREAD_RETURN THREAD_TYPE socketHandler(void *ptr)
         while ( index < bytesRead ) {
           line += buffer[index];
           if ( buffer[index++] == '\n' ) {
-            data->mutex.lock();
             if ( line.compare(0, 4, "Exit") == 0 || line.compare(0, 4, "exit") == 0 ) {
               // Ignore this line and assume the connection will be
               // closed on a subsequent read call.
               ;
             }
-            else if ( data->skini.parseString( line, message ) )
-              data->queue.push( message );
-            data->mutex.unlock();
+            else if ( skini.parseString( line, message ) )
+              queueMessage( data, message );
             line.erase();
           }
         }
@@ -415,14 +451,12 @@ THREAD_RETURN THREAD_TYPE socketHandler(void *ptr)
         else if ( !(data->sources & STK_STDIN) ) {
           // No stdin thread running, so quit now.
           message.type = __SK_Exit_;
-          data->queue.push( message );
+          queueMessage( data, message );
         }
       }
       fdclose.clear();
     }
 
-    // Wait until we're below the queue limit.
-    while ( data->queue.size() >= data->queueLimit ) Stk::sleep( 50 );
   }
 
   return NULL;
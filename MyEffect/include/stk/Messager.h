@@ -3,11 +3,10 @@
 
 #include "Stk.h"
 #include "Skini.h"
-#include <queue>
+#include "MessageQueue.h"
 
 #if defined(__STK_REALTIME__)
 
-#include "Mutex.h"
 #include "Thread.h"
 #include "TcpServer.h"
 #include "RtMidi.h"
@@ -34,7 +33,13 @@ const int DEFAULT_QUEUE_LIMIT = 200;
     socket, or stdin) take place asynchronously, filling the message
     queue.  A call to popMessage() will pop the next available control
     message from the queue and return it via the referenced Message
-    structure.  When a \e non-realtime scorefile is set, it is not
+    structure.  The queue is lock-free, so popMessage() never waits
+    for the input threads and can be called from an audio callback.
+    Each queued message is time-stamped by its source, and when an
+    audio callback calls startBlock() before popping the messages of
+    a block, popMessage() also returns the frame at which each one
+    should be applied, which keeps their relative timing (with one
+    block of latency).  When a \e non-realtime scorefile is set, it is not
     possible to start reading realtime input messages (from MIDI,
     socket, or stdin).  Likewise, it is not possible to read from a
     scorefile when a realtime input mechanism is running.
@@ -60,12 +65,12 @@ class Messager : public Stk
   // messager threads.  It must be public.
   struct MessagerData {
     Skini skini;
-    std::queue<Skini::Message> queue;
+    MessageQueue queue;
     unsigned int queueLimit;
     int sources;
 
 #if defined(__STK_REALTIME__)
-    Mutex mutex;
+    double midiTime;
     RtMidiIn *midi;
     TcpServer *socket;
     std::vector<int> fd;
@@ -74,7 +79,11 @@ class Messager : public Stk
 
     // Default constructor.
     MessagerData()
-      :queueLimit(0), sources(0) {}
+      :queueLimit(0), sources(0)
+#if defined(__STK_REALTIME__)
+      , midiTime(0.0)
+#endif
+      {}
   };
 
   //! Default constructor.
@@ -92,8 +101,31 @@ class Messager : public Stk
   */
   void popMessage( Skini::Message& message );
 
-  //! Push the referenced message onto the message stack.
-  void pushMessage( Skini::Message& message );
+  //! Start a new audio block of \e nFrames frames, for the timing of the messages popped in it.
+  /*!
+    Messages received before this call are popped (by the following
+    calls of the popMessage() function below) with the frame of the
+    block at which they should be applied, mapping the time between
+    the previous call and this one onto the block.  Messages received
+    after this call wait for the next block.
+  */
+  void startBlock( unsigned int nFrames );
+
+  //! Pop the next message of the current block and write the frame at which to apply it to \e frame.
+  /*!
+    As above, a type value of zero indicates that there is no (more)
+    message for this block.  The returned frames never decrease
+    within a block.  Scorefile messages are returned with frame 0
+    (their time is given by the message time field).
+  */
+  void popMessage( Skini::Message& message, unsigned int *frame );
+
+  //! Push the referenced message onto the message queue.
+  /*!
+    The message is stamped with the current time.  If the queue is
+    full, the message is dropped and \e false is returned.
+  */
+  bool pushMessage( Skini::Message& message );
 
   //! Specify a SKINI formatted scorefile from which messages should be read.
   /*!
@@ -154,6 +186,12 @@ class Messager : public Stk
 
   MessagerData data_;
 
+  // Block timing (audio thread).
+  double blockTime_;
+  double previousBlockTime_;
+  unsigned int blockFrames_;
+  unsigned int lastFrame_;
+
 #if defined(__STK_REALTIME__)
   Thread stdinThread_;
   Thread socketThread_;
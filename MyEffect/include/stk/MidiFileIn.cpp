@@ -11,17 +11,25 @@
     Tempo changes are internally tracked by the class and reflected in
     the values returned by the function getTickSeconds().
 
+    The whole file is read into memory when it is opened.  For
+    sequencing, all tracks can also be parsed once into a
+    time-sorted index of flat Event structures, which is read in
+    time order with getNextMergedEvent() and can be positioned with
+    seek().
+
     by Gary P. Scavone, 2003 - 2010.
 */
 /**********************************************************************/
 
 #include "MidiFileIn.h"
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 
 namespace stk {
 
 MidiFileIn :: MidiFileIn( std::string fileName )
+  : indexed_(false), eventIndex_(0)
 {
   // Attempt to open the file.
   file_.open( fileName.c_str(), std::ios::in | std::ios::binary );
@@ -111,6 +119,19 @@ MidiFileIn :: MidiFileIn( std::string fileName )
     else tickSeconds_.push_back( (double) (0.5 / tickrate) );
   }
 
+  // Read the whole file into memory, so that events are parsed
+  // without any further file access.
+  {
+    file_.clear();
+    file_.seekg( 0, std::ios_base::end );
+    long fileSize = (long) file_.tellg();
+    if ( fileSize <= 0 ) goto error;
+    data_.resize( fileSize );
+    file_.seekg( 0, std::ios_base::beg );
+    if ( !file_.read( (char *) &data_[0], fileSize ) ) goto error;
+    file_.close();
+  }
+
   // Save the initial tickSeconds parameter.
   TempoChange tempoEvent;
   tempoEvent.count = 0;
@@ -159,8 +180,8 @@ MidiFileIn :: MidiFileIn( std::string fileName )
 
 MidiFileIn :: ~MidiFileIn()
 {
-  // An ifstream object implicitly closes itself during destruction
-  // but we'll make an explicit call to "close" anyway.
+  // The file is closed once it has been read into memory, but we'll
+  // make an explicit call to "close" anyway.
   file_.close(); 
 }
 
@@ -213,72 +234,30 @@ unsigned long MidiFileIn :: getNextEvent( std::vector<unsigned char> *event, uns
   if ( (trackPointers_[track] - trackOffsets_[track]) >= trackLengths_[track] )
     return 0;
 
-  unsigned long ticks = 0, bytes = 0;
+  unsigned long ticks = 0;
   bool isTempoEvent = false;
-
-  // Read the event delta time.
-  file_.seekg( trackPointers_[track], std::ios_base::beg );
-  if ( !readVariableLength( &ticks ) ) goto error;
-
-  // Parse the event stream to determine the event length.
-  unsigned char c;
-  if ( !file_.read( (char *)&c, 1 ) ) goto error;
-  switch ( c ) {
-
-  case 0xFF: // A Meta-Event
-    unsigned long position;
-    trackStatus_[track] = 0;
-    event->push_back( c );
-    if ( !file_.read( (char *)&c, 1 ) ) goto error;
-    event->push_back( c );
-    if ( format_ != 1 && ( c == 0x51 ) ) isTempoEvent = true;
-    position = file_.tellg();
-    if ( !readVariableLength( &bytes ) ) goto error;
-    bytes += ( (unsigned long)file_.tellg() - position );
-    file_.seekg( position, std::ios_base::beg );
-    break;
-
-  case 0xF0:
-  case 0xF7: // The start or continuation of a Sysex event
-    trackStatus_[track] = 0;
-    event->push_back( c );
-    position = file_.tellg();
-    if ( !readVariableLength( &bytes ) ) goto error;
-    bytes += ( (unsigned long)file_.tellg() - position );
-    file_.seekg( position, std::ios_base::beg );
-    break;
-
-  default: // Should be a MIDI channel event
-    if ( c & 0x80 ) { // MIDI status byte
-      if ( c > 0xF0 ) goto error;
-      trackStatus_[track] = c;
-      event->push_back( c );
-      c &= 0xF0;
-      if ( (c == 0xC0) || (c == 0xD0) ) bytes = 1;
-      else bytes = 2;
-    }
-    else if ( trackStatus_[track] & 0x80 ) { // Running status
-      event->push_back( trackStatus_[track] );
-      event->push_back( c );
-      c = trackStatus_[track] & 0xF0;
-      if ( (c != 0xC0) && (c != 0xD0) ) bytes = 1;
-    }
-    else goto error;
-
-  }
-
-  // Read the rest of the event into the event vector.
-  unsigned long i;
-  for ( i=0; i<bytes; i++ ) {
-    if ( !file_.read( (char *)&c, 1 ) ) goto error;
-    event->push_back( c );
+  long position = trackPointers_[track], body = 0;
+  unsigned char status = trackStatus_[track];
+  Event e;
+
+  // Decode the event from the file data.
+  if ( !decodeEvent( &position, &status, &ticks, &e, &body ) ) goto error;
+  trackStatus_[track] = status;
+
+  event->assign( e.message, e.message + e.size );
+  if ( !e.isMidi() ) {
+    // Meta and sysex events are returned as in the file, with their length value.
+    event->insert( event->end(), data_.begin() + body, data_.begin() + position );
+    if ( format_ != 1 && e.message[0] == 0xFF && e.message[1] == 0x51 && e.dataLength >= 3 )
+      isTempoEvent = true;
   }
 
   if ( !usingTimeCode_ ) {
     if ( isTempoEvent ) {
       // Parse the tempo event and update tickSeconds_[track].
       double tickrate = (double) (division_ & 0x7FFF);
-      unsigned long value = ( event->at(3) << 16 ) + ( event->at(4) << 8 ) + event->at(5);
+      const unsigned char *data = getEventData( e );
+      unsigned long value = ( data[0] << 16 ) + ( data[1] << 8 ) + data[2];
       tickSeconds_[track] = (double) (0.000001 * value / tickrate);
     }
 
@@ -294,7 +273,7 @@ unsigned long MidiFileIn :: getNextEvent( std::vector<unsigned char> *event, uns
   }
 
   // Save the current track pointer value.
-  trackPointers_[track] = file_.tellg();
+  trackPointers_[track] = position;
 
   return ticks;
 
@@ -327,26 +306,233 @@ unsigned long MidiFileIn :: getNextMidiEvent( std::vector<unsigned char> *midiEv
   return ticks;
 }
 
-bool MidiFileIn :: readVariableLength( unsigned long *value )
+bool MidiFileIn :: readVariableLength( long *position, unsigned long *value )
 {
-  // It is assumed that this function is called with the file read
-  // pointer positioned at the start of a variable-length value.  The
-  // function returns "true" if the value is successfully parsed and
-  // "false" otherwise.
+  // It is assumed that this function is called with the read position
+  // at the start of a variable-length value.  The function returns
+  // "true" if the value is successfully parsed and "false" otherwise.
   *value = 0;
-  char c;
+  long p = *position, size = (long) data_.size();
+  unsigned char c;
 
-  if ( !file_.read( &c, 1 ) ) return false;
+  if ( p >= size ) return false;
+  c = data_[p++];
   *value = (unsigned long) c;
   if ( *value & 0x80 ) {
     *value &= 0x7f;
     do {
-      if ( !file_.read( &c, 1 ) ) return false;
+      if ( p >= size ) return false;
+      c = data_[p++];
       *value = ( *value << 7 ) + ( c & 0x7f );
     } while ( c & 0x80 );
   }
 
+  *position = p;
   return true;
-} 
+}
+
+bool MidiFileIn :: decodeEvent( long *position, unsigned char *status, unsigned long *ticks, Event *event, long *body )
+{
+  long p = *position, size = (long) data_.size();
+  unsigned long i, bytes = 0;
+  unsigned char c;
+
+  event->size = 0;
+  event->dataOffset = 0;
+  event->dataLength = 0;
+
+  // Read the event delta time.
+  if ( !readVariableLength( &p, ticks ) ) return false;
+
+  // Parse the event stream to determine the event length.
+  if ( p >= size ) return false;
+  c = data_[p++];
+  switch ( c ) {
+
+  case 0xFF: // A Meta-Event
+    *status = 0;
+    if ( p >= size ) return false;
+    event->message[event->size++] = c;
+    event->message[event->size++] = data_[p++];
+    *body = p;
+    if ( !readVariableLength( &p, &bytes ) ) return false;
+    break;
+
+  case 0xF0:
+  case 0xF7: // The start or continuation of a Sysex event
+    *status = 0;
+    event->message[event->size++] = c;
+    *body = p;
+    if ( !readVariableLength( &p, &bytes ) ) return false;
+    break;
+
+  default: // Should be a MIDI channel event
+    if ( c & 0x80 ) { // MIDI status byte
+      if ( c > 0xF0 ) return false;
+      *status = c;
+      event->message[event->size++] = c;
+      c &= 0xF0;
+      if ( (c == 0xC0) || (c == 0xD0) ) bytes = 1;
+      else bytes = 2;
+    }
+    else if ( *status & 0x80 ) { // Running status
+      event->message[event->size++] = *status;
+      event->message[event->size++] = c;
+      c = *status & 0xF0;
+      if ( (c != 0xC0) && (c != 0xD0) ) bytes = 1;
+    }
+    else return false;
+
+    if ( (unsigned long) ( size - p ) < bytes ) return false;
+    for ( i=0; i<bytes; i++ )
+      event->message[event->size++] = data_[p++];
+    *position = p;
+    return true;
+  }
+
+  // The meta-event or sysex data.
+  if ( (unsigned long) ( size - p ) < bytes ) return false;
+  event->dataOffset = (unsigned int) p;
+  event->dataLength = (unsigned int) bytes;
+  *position = p + bytes;
+  return true;
+}
+
+// Order events by time in seconds (and ticks, for format 2 files).
+static bool compareEvents( const MidiFileIn::Event& a, const MidiFileIn::Event& b )
+{
+  if ( a.seconds != b.seconds ) return a.seconds < b.seconds;
+  return a.ticks < b.ticks;
+}
+
+static bool eventBefore( const MidiFileIn::Event& event, double seconds )
+{
+  return event.seconds < seconds;
+}
+
+void MidiFileIn :: indexEvents( void )
+{
+  if ( indexed_ ) return;
+
+  // The tempo map of a track: the tick count, time and tick duration
+  // from each tempo change on.
+  struct TempoSegment {
+    unsigned long ticks;
+    double seconds;
+    double tickSeconds;
+  };
+  std::vector<TempoSegment> tempoMap;
+  double tickrate = (double) (division_ & 0x7FFF);
+
+  events_.clear();
+  for ( unsigned int track=0; track<nTracks_; track++ ) {
+    size_t first = events_.size();
+    long position = trackOffsets_[track];
+    long end = trackOffsets_[track] + trackLengths_[track];
+    unsigned long ticks = 0, delta;
+    unsigned char status = 0;
+    long body;
+    Event event;
+    event.seconds = 0.0;
+    event.track = (unsigned short) track;
+
+    while ( position < end ) {
+      if ( !decodeEvent( &position, &status, &delta, &event, &body ) ) {
+        events_.clear();
+        oStream_ << "MidiFileIn::indexEvents: error parsing track " << track << "!";
+        handleError( StkError::FILE_ERROR );
+      }
+      ticks += delta;
+      event.ticks = ticks;
+      events_.push_back( event );
+    }
+
+    // Format 0 and 1 files are timed with the tempo events in track 0,
+    // format 2 tracks with their own.
+    if ( track == 0 || format_ == 2 ) {
+      TempoSegment segment;
+      segment.ticks = 0;
+      segment.seconds = 0.0;
+      segment.tickSeconds = tempoEvents_[0].tickSeconds;
+      tempoMap.assign( 1, segment );
+
+      for ( size_t i=first; i<events_.size() && !usingTimeCode_; i++ ) {
+        const Event& e = events_[i];
+        if ( e.message[0] != 0xFF || e.message[1] != 0x51 || e.dataLength < 3 ) continue;
+        const unsigned char *data = getEventData( e );
+        unsigned long value = ( data[0] << 16 ) + ( data[1] << 8 ) + data[2];
+        TempoSegment& last = tempoMap.back();
+        segment.ticks = e.ticks;
+        segment.seconds = last.seconds + ( e.ticks - last.ticks ) * last.tickSeconds;
+        segment.tickSeconds = (double) (0.000001 * value / tickrate);
+        if ( segment.ticks > last.ticks ) tempoMap.push_back( segment );
+        else last = segment;
+      }
+    }
+
+    // Convert the track event times to seconds.
+    unsigned int k = 0;
+    for ( size_t i=first; i<events_.size(); i++ ) {
+      Event& e = events_[i];
+      while ( k < tempoMap.size() - 1 && tempoMap[k+1].ticks <= e.ticks ) k++;
+      e.seconds = tempoMap[k].seconds + ( e.ticks - tempoMap[k].ticks ) * tempoMap[k].tickSeconds;
+    }
+  }
+
+  // The tracks were added in order, so a stable sort keeps simultaneous
+  // events ordered by track and then by their order in the track.
+  std::stable_sort( events_.begin(), events_.end(), compareEvents );
+  eventIndex_ = 0;
+  indexed_ = true;
+}
+
+unsigned long MidiFileIn :: getNumberOfEvents( void )
+{
+  indexEvents();
+  return (unsigned long) events_.size();
+}
+
+const MidiFileIn::Event& MidiFileIn :: getEvent( unsigned long index )
+{
+  indexEvents();
+  if ( index >= events_.size() ) {
+    oStream_ << "MidiFileIn::getEvent: invalid event index (" << index << ").";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  return events_[index];
+}
+
+double MidiFileIn :: getDuration( void )
+{
+  indexEvents();
+  if ( events_.empty() ) return 0.0;
+  return events_.back().seconds;
+}
+
+unsigned long MidiFileIn :: seek( double seconds )
+{
+  indexEvents();
+  eventIndex_ = (unsigned long) ( std::lower_bound( events_.begin(), events_.end(), seconds, eventBefore ) - events_.begin() );
+  return eventIndex_;
+}
+
+const MidiFileIn::Event *MidiFileIn :: getNextMergedEvent( void )
+{
+  indexEvents();
+  if ( eventIndex_ >= events_.size() ) return 0;
+  return &events_[eventIndex_++];
+}
+
+const MidiFileIn::Event *MidiFileIn :: getNextMergedMidiEvent( void )
+{
+  indexEvents();
+  while ( eventIndex_ < events_.size() ) {
+    const Event *event = &events_[eventIndex_++];
+    if ( event->isMidi() ) return event;
+  }
+
+  return 0;
+}
 
 } // stk namespace
@@ -22,6 +22,13 @@ namespace stk {
     Tempo changes are internally tracked by the class and reflected in
     the values returned by the function getTickSeconds().
 
+    The whole file is read into memory when it is opened.  For
+    sequencing (e.g. offline rendering of long files), all tracks can
+    also be parsed once into a time-sorted index of flat Event
+    structures, with absolute tick and seconds timestamps, which is
+    read in time order with getNextMergedEvent() and can be
+    positioned at any time with seek().
+
     by Gary P. Scavone, 2003 - 2010.
 */
 /**********************************************************************/
@@ -29,6 +36,27 @@ namespace stk {
 class MidiFileIn : public Stk
 {
  public:
+  //! A MIDI file event, as stored in the event index.
+  /*!
+      Channel messages are stored complete in \e message (with a
+      status byte, even when running status is used in the file).
+      For meta-events, \e message holds 0xFF and the meta-event type;
+      for sysex events, 0xF0 or 0xF7.  Their data bytes (following
+      the length value) are returned by getEventData().
+  */
+  struct Event {
+    double seconds;           // absolute time in seconds
+    unsigned long ticks;      // absolute time in ticks
+    unsigned int dataOffset;  // meta-event or sysex data position
+    unsigned int dataLength;  // meta-event or sysex data size, in bytes
+    unsigned short track;
+    unsigned char size;       // number of bytes in message
+    unsigned char message[3];
+
+    //! Returns true for a MIDI channel message (not a meta or sysex event).
+    bool isMidi( void ) const { return message[0] < 0xF0; };
+  };
+
   //! Default constructor.
   /*!
       If an error occurs while opening or parsing the file header, an
@@ -98,16 +126,57 @@ class MidiFileIn : public Stk
   */
   unsigned long getNextMidiEvent( std::vector<unsigned char> *midiEvent, unsigned int track = 0 );
 
+  //! Return the number of events in all tracks.
+  /*!
+      This and the following functions use the event index, which is
+      built the first time one of them is called.  If an error occurs
+      while parsing a track, an StkError exception will be thrown.
+  */
+  unsigned long getNumberOfEvents( void );
+
+  //! Return an event of the index, sorted by time (for equal times, by track and then order in the track).
+  /*!
+      Format 2 files hold independent sequences in their tracks; each
+      track is timed with its own tempo events and the tracks are
+      sorted as if played together.
+  */
+  const Event& getEvent( unsigned long index );
+
+  //! Return a pointer to the meta-event or sysex data bytes of \e event (\e event.dataLength of them).
+  const unsigned char *getEventData( const Event& event ) const { return &data_[event.dataOffset]; };
+
+  //! Return the time, in seconds, of the last event in the file.
+  double getDuration( void );
+
+  //! Position the merged event reader at the first event at or after \e seconds and return its index.
+  unsigned long seek( double seconds );
+
+  //! Return the next event of all tracks in time order, or a NULL pointer after the last one.
+  const Event *getNextMergedEvent( void );
+
+  //! Return the next MIDI channel event of all tracks in time order, skipping meta and sysex events, or a NULL pointer after the last one.
+  const Event *getNextMergedMidiEvent( void );
+
  protected:
 
   // This protected class function is used for reading variable-length
   // MIDI file values. It is assumed that this function is called with
-  // the file read pointer positioned at the start of a
-  // variable-length value.  The function returns true if the value is
+  // the read position at the start of a variable-length value, which
+  // is advanced past it.  The function returns true if the value is
   // successfully parsed.  Otherwise, it returns false.
-  bool readVariableLength( unsigned long *value );
+  bool readVariableLength( long *position, unsigned long *value );
+
+  // Decode the track event at the given position (advanced past it)
+  // with the given running status (updated) and return its delta
+  // time in ticks.  For meta and sysex events, body is set to the
+  // position of their length value.  Returns false on a read error.
+  bool decodeEvent( long *position, unsigned char *status, unsigned long *ticks, Event *event, long *body );
+
+  // Parse all tracks into the event index (once).
+  void indexEvents( void );
 
   std::ifstream file_;
+  std::vector<unsigned char> data_;
   unsigned int nTracks_;
   int format_;
   int division_;
@@ -116,7 +185,7 @@ class MidiFileIn : public Stk
   std::vector<long> trackPointers_;
   std::vector<long> trackOffsets_;
   std::vector<long> trackLengths_;
-  std::vector<char> trackStatus_;
+  std::vector<unsigned char> trackStatus_;
 
   // This structure and the following variables are used to save and
   // keep track of a format 1 tempo map (and the initial tickSeconds
@@ -128,6 +197,11 @@ class MidiFileIn : public Stk
   std::vector<TempoChange> tempoEvents_;
   std::vector<unsigned long> trackCounters_;
   std::vector<unsigned int> trackTempoIndex_;
+
+  // The event index and the merged event reader position.
+  std::vector<Event> events_;
+  bool indexed_;
+  unsigned long eventIndex_;
 };
 
 } // stk namespace
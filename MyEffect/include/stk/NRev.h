@@ -115,12 +115,12 @@ inline StkFloat NRev :: tick( StkFloat input, unsigned int channel )
 
   temp0 = 0.0;
   for ( i=0; i<6; i++ ) {
-    temp = input + (combCoefficient_[i] * combDelays_[i].lastOut());
+    temp = input + (combCoefficient_[i] * undenormalize( combDelays_[i].lastOut() ));
     temp0 += combDelays_[i].tick(temp);
   }
 
   for ( i=0; i<3; i++ )	{
-    temp = allpassDelays_[i].lastOut();
+    temp = undenormalize( allpassDelays_[i].lastOut() );
     temp1 = allpassCoefficient_ * temp;
     temp1 += temp0;
     allpassDelays_[i].tick(temp1);
@@ -128,20 +128,20 @@ inline StkFloat NRev :: tick( StkFloat input, unsigned int channel )
   }
 
 	// One-pole lowpass filter.
-  lowpassState_ = 0.7 * lowpassState_ + 0.3 * temp0;
-  temp = allpassDelays_[3].lastOut();
+  lowpassState_ = undenormalize( 0.7 * lowpassState_ + 0.3 * temp0 );
+  temp = undenormalize( allpassDelays_[3].lastOut() );
   temp1 = allpassCoefficient_ * temp;
   temp1 += lowpassState_;
   allpassDelays_[3].tick( temp1 );
   temp1 = -( allpassCoefficient_ * temp1 ) + temp;
     
-  temp = allpassDelays_[4].lastOut();
+  temp = undenormalize( allpassDelays_[4].lastOut() );
   temp2 = allpassCoefficient_ * temp;
   temp2 += temp1;
   allpassDelays_[4].tick( temp2 );
   lastFrame_[0] = effectMix_*( -( allpassCoefficient_ * temp2 ) + temp );
     
-  temp = allpassDelays_[5].lastOut();
+  temp = undenormalize( allpassDelays_[5].lastOut() );
   temp3 = allpassCoefficient_ * temp;
   temp3 += temp1;
   allpassDelays_[5].tick( temp3 );
@@ -0,0 +1,159 @@
+/***************************************************/
+/*! \class SampleCache
+    \brief STK shared audio file data class.
+
+    This class keeps a process-wide cache of audio file data loaded
+    entirely into memory, so that all FileWvIn and FileLoop objects
+    playing the same file share a single, reference-counted copy.
+*/
+/***************************************************/
+
+#include "SampleCache.h"
+#include "FileRead.h"
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+
+#if !defined(_WIN32)
+  #include <limits.h>
+#endif
+
+namespace stk {
+
+namespace {
+
+  struct CacheEntry {
+    std::weak_ptr<const StkFrames> frames;
+    unsigned long fileSize;
+  };
+
+  struct CacheData {
+    std::mutex mutex;
+    std::map<std::string, CacheEntry> entries;
+    unsigned long loads;
+    CacheData( void ) : loads(0) {};
+  };
+
+  // Constructed on first use, so the cache can be used during static initialization.
+  CacheData& sampleCache( void )
+  {
+    static CacheData instance;
+    return instance;
+  }
+
+  // The absolute path of a file, with "." and ".." (and, except on Windows, symbolic links)
+  // resolved, so the same file named in different ways shares one entry.  The name is kept
+  // as given if it can't be resolved (e.g. the file doesn't exist, for the error from FileRead).
+  std::string canonicalPath( const std::string& fileName )
+  {
+#if defined(_WIN32)
+    char path[_MAX_PATH];
+    if ( _fullpath( path, fileName.c_str(), _MAX_PATH ) ) return path;
+#else
+    char *path = realpath( fileName.c_str(), 0 );
+    if ( path ) {
+      std::string result( path );
+      free( path );
+      return result;
+    }
+#endif
+    return fileName;
+  }
+
+  // Remove the entries no longer referenced by anyone.
+  void purgeCache( CacheData& c )
+  {
+    std::map<std::string, CacheEntry>::iterator it = c.entries.begin();
+    while ( it != c.entries.end() ) {
+      if ( it->second.frames.expired() ) c.entries.erase( it++ );
+      else ++it;
+    }
+  }
+
+} // anonymous namespace
+
+std::shared_ptr<const StkFrames> SampleCache :: load( std::string fileName, bool raw, bool doNormalize,
+                                                      bool loopFrame, unsigned long maxFrames )
+{
+  // The same file loaded differently is cached separately.
+  std::string key = canonicalPath( fileName );
+  key += raw ? "|raw" : "|";
+  key += doNormalize ? "|normalized" : "|";
+  key += loopFrame ? "|loop" : "|";
+
+  CacheData& c = sampleCache();
+  {
+    std::lock_guard<std::mutex> lock( c.mutex );
+    std::map<std::string, CacheEntry>::iterator it = c.entries.find( key );
+    if ( it != c.entries.end() ) {
+      std::shared_ptr<const StkFrames> frames = it->second.frames.lock();
+      if ( frames ) {
+        if ( it->second.fileSize > maxFrames ) return std::shared_ptr<const StkFrames>();
+        return frames;
+      }
+    }
+  }
+
+  // Read the file without holding the lock, so other threads can use the cache meanwhile.
+  // Attempt to open the file ... an error might be thrown here.
+  FileRead file( fileName, raw );
+  unsigned long fileSize = file.fileSize();
+  if ( fileSize > maxFrames ) return std::shared_ptr<const StkFrames>();
+
+  std::shared_ptr<StkFrames> frames( new StkFrames( fileSize + ( loopFrame ? 1 : 0 ), file.channels() ) );
+  file.read( *frames, 0, doNormalize );
+
+  // Copy the first sample frame to the last (for interpolation around the loop).
+  if ( loopFrame ) {
+    for ( unsigned int i=0; i<frames->channels(); i++ )
+      (*frames)( frames->frames() - 1, i ) = (*frames)[i];
+  }
+
+  // Normalize all channels equally by the greatest magnitude in all of the data.
+  if ( doNormalize ) {
+    size_t i;
+    StkFloat max = 0.0;
+    for ( i=0; i<frames->size(); i++ ) {
+      if ( fabs( (*frames)[i] ) > max )
+        max = (StkFloat) fabs( (double) (*frames)[i] );
+    }
+
+    if ( max > 0.0 ) {
+      max = 1.0 / max;
+      for ( i=0; i<frames->size(); i++ )
+        (*frames)[i] *= max;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock( c.mutex );
+  c.loads++;
+
+  // Another thread may have loaded the same file meanwhile: share its copy rather than ours.
+  purgeCache( c );
+  CacheEntry& entry = c.entries[key];
+  std::shared_ptr<const StkFrames> loaded = entry.frames.lock();
+  if ( loaded ) return loaded;
+
+  entry.frames = frames;
+  entry.fileSize = fileSize;
+
+  return frames;
+}
+
+unsigned int SampleCache :: size( void )
+{
+  CacheData& c = sampleCache();
+  std::lock_guard<std::mutex> lock( c.mutex );
+  purgeCache( c );
+  return (unsigned int) c.entries.size();
+}
+
+unsigned long SampleCache :: getLoads( void )
+{
+  CacheData& c = sampleCache();
+  std::lock_guard<std::mutex> lock( c.mutex );
+  return c.loads;
+}
+
+} // stk namespace
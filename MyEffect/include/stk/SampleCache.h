@@ -0,0 +1,56 @@
+#ifndef STK_SAMPLECACHE_H
+#define STK_SAMPLECACHE_H
+
+#include "Stk.h"
+#include <memory>
+
+namespace stk {
+
+/***************************************************/
+/*! \class SampleCache
+    \brief STK shared audio file data class.
+
+    This class keeps a process-wide cache of audio file data loaded
+    entirely into memory, keyed by the file's absolute path (and the
+    way it was loaded), so that different names for the same file,
+    such as relative paths, share one entry.  The data is returned as
+    a reference-counted, immutable StkFrames object, so that all
+    FileWvIn and FileLoop objects playing the same file share a single
+    copy, and the file is only read from disk once.  For example, the
+    rawwaves of the 64 voices of a Voicer are each loaded once rather
+    than 64 times.
+
+    A file's data stays in the cache for as long as any object holds
+    a reference to it.  The cache is thread-safe, and files are read
+    without holding its lock, so a slow read doesn't hold up other
+    threads.  Threads loading the same uncached file at the same time
+    may each read it, but all get the same copy.  Loading reads from
+    disk, so it should not be used from an audio thread.
+*/
+/***************************************************/
+
+class SampleCache : public Stk
+{
+ public:
+  //! Return the data of an audio file, reading it from disk only if it is not already cached.
+  /*!
+    The file data is read and normalized as FileWvIn does.  If \e
+    loopFrame is true, a copy of the first frame is appended to the
+    data (for interpolating around the end of a loop, as in
+    FileLoop).  If the file has more than \e maxFrames frames, it is
+    not loaded and a null pointer is returned.  An StkError is thrown
+    if the file cannot be opened or read.
+  */
+  static std::shared_ptr<const StkFrames> load( std::string fileName, bool raw = false, bool doNormalize = true,
+                                                bool loopFrame = false, unsigned long maxFrames = (unsigned long) -1 );
+
+  //! Return the number of files currently held in the cache.
+  static unsigned int size( void );
+
+  //! Return the number of times a file has been read from disk (cache misses).
+  static unsigned long getLoads( void );
+};
+
+} // stk namespace
+
+#endif
@@ -0,0 +1,652 @@
+/***************************************************/
+/*! \class SampleConvert
+    \brief STK sample format conversion class.
+
+    This class converts blocks of audio samples between the data
+    formats of the STK file classes and StkFloat, using SSE2 or AVX2
+    where available.  It is used by FileRead and FileWrite.
+*/
+/***************************************************/
+
+#include "SampleConvert.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+  #define STK_CONVERT_SSE2
+  #include <emmintrin.h>
+  #if defined(__GNUC__) || defined(__clang__)
+    #define STK_CONVERT_AVX2
+    #define STK_TARGET_AVX2 __attribute__((target("avx2")))
+    #include <immintrin.h>
+  #elif defined(_MSC_VER)
+    #define STK_CONVERT_AVX2
+    #define STK_TARGET_AVX2
+    #include <immintrin.h>
+    #include <intrin.h>
+  #endif
+#endif
+
+namespace stk {
+
+// The vector kernels store StkFloat as float.
+static const bool floatSamples = sizeof(StkFloat) == sizeof(FLOAT32);
+
+static SampleConvert::InstructionSet supportedSet( void )
+{
+#if defined(STK_CONVERT_AVX2) && defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid( info, 1 );
+  bool osxsave = ( info[2] & (1 << 27) ) != 0;
+  bool avx = ( info[2] & (1 << 28) ) != 0;
+  __cpuidex( info, 7, 0 );
+  bool avx2 = ( info[1] & (1 << 5) ) != 0;
+  if ( osxsave && avx && avx2 && ( _xgetbv( 0 ) & 6 ) == 6 ) return SampleConvert::AVX2;
+  return SampleConvert::SSE2;
+#elif defined(STK_CONVERT_AVX2)
+  __builtin_cpu_init();
+  if ( __builtin_cpu_supports( "avx2" ) ) return SampleConvert::AVX2;
+  return SampleConvert::SSE2;
+#elif defined(STK_CONVERT_SSE2)
+  return SampleConvert::SSE2;
+#else
+  return SampleConvert::SCALAR;
+#endif
+}
+
+static SampleConvert::InstructionSet currentSet = supportedSet();
+
+SampleConvert::InstructionSet SampleConvert :: instructionSet( void )
+{
+  return currentSet;
+}
+
+void SampleConvert :: setInstructionSet( InstructionSet set )
+{
+  InstructionSet supported = supportedSet();
+  currentSet = ( set < supported ) ? set : supported;
+}
+
+unsigned int SampleConvert :: sampleBytes( StkFormat format )
+{
+  if ( format == STK_SINT8 ) return 1;
+  else if ( format == STK_SINT16 ) return 2;
+  else if ( format == STK_SINT24 ) return 3;
+  else if ( format == STK_SINT32 || format == STK_FLOAT32 ) return 4;
+  else if ( format == STK_FLOAT64 ) return 8;
+  return 0;
+}
+
+// Scalar loads and stores (through memcpy, so the data need not be aligned).
+
+static inline UINT16 load16( const unsigned char *p, bool swap )
+{
+  UINT16 v;
+  memcpy( &v, p, 2 );
+  if ( swap ) v = (UINT16) ( ( v >> 8 ) | ( v << 8 ) );
+  return v;
+}
+
+static inline UINT32 load32( const unsigned char *p, bool swap )
+{
+  UINT32 v;
+  memcpy( &v, p, 4 );
+  if ( swap ) v = ( v >> 24 ) | ( ( v >> 8 ) & 0x0000ff00 ) | ( ( v << 8 ) & 0x00ff0000 ) | ( v << 24 );
+  return v;
+}
+
+static inline FLOAT64 load64( const unsigned char *p, bool swap )
+{
+  unsigned char b[8];
+  memcpy( b, p, 8 );
+  if ( swap ) Stk::swap64( b );
+  FLOAT64 v;
+  memcpy( &v, b, 8 );
+  return v;
+}
+
+static inline void store16( unsigned char *p, UINT16 v, bool swap )
+{
+  if ( swap ) v = (UINT16) ( ( v >> 8 ) | ( v << 8 ) );
+  memcpy( p, &v, 2 );
+}
+
+static inline void store32( unsigned char *p, UINT32 v, bool swap )
+{
+  if ( swap ) v = ( v >> 24 ) | ( ( v >> 8 ) & 0x0000ff00 ) | ( ( v << 8 ) & 0x00ff0000 ) | ( v << 24 );
+  memcpy( p, &v, 4 );
+}
+
+static inline void store64( unsigned char *p, FLOAT64 v, bool swap )
+{
+  unsigned char b[8];
+  memcpy( b, &v, 8 );
+  if ( swap ) Stk::swap64( b );
+  memcpy( p, b, 8 );
+}
+
+// Scale, saturate and truncate a sample for writing as an integer.
+static inline SINT32 toInt( StkFloat s, double scale, double offset, double low, double high )
+{
+  double d = s * scale + offset;
+  if ( d < low ) d = low;
+  else if ( d > high ) d = high;
+  return (SINT32) d;
+}
+
+// Is packed 24-bit data little-endian?
+static inline bool littleEndian24( bool swap )
+{
+#ifdef __LITTLE_ENDIAN__
+  return !swap;
+#else
+  return swap;
+#endif
+}
+
+#if defined(STK_CONVERT_SSE2)
+
+//============================================================================
+// SSE2 kernels.  Each converts from sample i until fewer than one vector is
+// left, and returns the index it stopped at.
+//============================================================================
+
+static inline __m128i sse2Swap16( __m128i v )
+{
+  return _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+}
+
+static inline __m128i sse2Swap32( __m128i v )
+{
+  v = sse2Swap16( v );
+  return _mm_or_si128( _mm_slli_epi32( v, 16 ), _mm_srli_epi32( v, 16 ) );
+}
+
+static inline __m128i sse2Swap64( __m128i v )
+{
+  return _mm_shuffle_epi32( sse2Swap32( v ), 0xB1 );
+}
+
+static unsigned long sse2FromInt8( float *out, const unsigned char *in, unsigned long i, unsigned long n,
+                                   bool isUnsigned, float gain )
+{
+  __m128 g = _mm_set1_ps( gain );
+  __m128i flip = _mm_set1_epi8( isUnsigned ? (char) 0x80 : 0 );
+  for ( ; i+16<=n; i+=16 ) {
+    __m128i v = _mm_xor_si128( _mm_loadu_si128( (const __m128i *) ( in+i ) ), flip );
+    __m128i lo = _mm_unpacklo_epi8( v, v );
+    __m128i hi = _mm_unpackhi_epi8( v, v );
+    __m128i a = _mm_srai_epi32( _mm_unpacklo_epi16( lo, lo ), 24 );
+    __m128i b = _mm_srai_epi32( _mm_unpackhi_epi16( lo, lo ), 24 );
+    __m128i c = _mm_srai_epi32( _mm_unpacklo_epi16( hi, hi ), 24 );
+    __m128i d = _mm_srai_epi32( _mm_unpackhi_epi16( hi, hi ), 24 );
+    _mm_storeu_ps( out+i, _mm_mul_ps( _mm_cvtepi32_ps( a ), g ) );
+    _mm_storeu_ps( out+i+4, _mm_mul_ps( _mm_cvtepi32_ps( b ), g ) );
+    _mm_storeu_ps( out+i+8, _mm_mul_ps( _mm_cvtepi32_ps( c ), g ) );
+    _mm_storeu_ps( out+i+12, _mm_mul_ps( _mm_cvtepi32_ps( d ), g ) );
+  }
+  return i;
+}
+
+static unsigned long sse2FromInt16( float *out, const unsigned char *in, unsigned long i, unsigned long n,
+                                    bool swap, float gain )
+{
+  __m128 g = _mm_set1_ps( gain );
+  for ( ; i+8<=n; i+=8 ) {
+    __m128i v = _mm_loadu_si128( (const __m128i *) ( in+2*i ) );
+    if ( swap ) v = sse2Swap16( v );
+    __m128i lo = _mm_srai_epi32( _mm_unpacklo_epi16( v, v ), 16 );
+    __m128i hi = _mm_srai_epi32( _mm_unpackhi_epi16( v, v ), 16 );
+    _mm_storeu_ps( out+i, _mm_mul_ps( _mm_cvtepi32_ps( lo ), g ) );
+    _mm_storeu_ps( out+i+4, _mm_mul_ps( _mm_cvtepi32_ps( hi ), g ) );
+  }
+  return i;
+}
+
+static unsigned long sse2FromInt32( float *out, const unsigned char *in, unsigned long i, unsigned long n,
+                                    bool swap, float gain )
+{
+  __m128 g = _mm_set1_ps( gain );
+  for ( ; i+4<=n; i+=4 ) {
+    __m128i v = _mm_loadu_si128( (const __m128i *) ( in+4*i ) );
+    if ( swap ) v = sse2Swap32( v );
+    _mm_storeu_ps( out+i, _mm_mul_ps( _mm_cvtepi32_ps( v ), g ) );
+  }
+  return i;
+}
+
+static unsigned long sse2FromFloat32( float *out, const unsigned char *in, unsigned long i, unsigned long n )
+{
+  // Only needed for swapped data: native data is copied.
+  for ( ; i+4<=n; i+=4 ) {
+    __m128i v = sse2Swap32( _mm_loadu_si128( (const __m128i *) ( in+4*i ) ) );
+    _mm_storeu_ps( out+i, _mm_castsi128_ps( v ) );
+  }
+  return i;
+}
+
+static unsigned long sse2FromFloat64( float *out, const unsigned char *in, unsigned long i, unsigned long n,
+                                      bool swap )
+{
+  for ( ; i+4<=n; i+=4 ) {
+    __m128i a = _mm_loadu_si128( (const __m128i *) ( in+8*i ) );
+    __m128i b = _mm_loadu_si128( (const __m128i *) ( in+8*i+16 ) );
+    if ( swap ) {
+      a = sse2Swap64( a );
+      b = sse2Swap64( b );
+    }
+    __m128 lo = _mm_cvtpd_ps( _mm_castsi128_pd( a ) );
+    __m128 hi = _mm_cvtpd_ps( _mm_castsi128_pd( b ) );
+    _mm_storeu_ps( out+i, _mm_movelh_ps( lo, hi ) );
+  }
+  return i;
+}
+
+// Scale, saturate and truncate four samples to integers (in double precision, as toInt()).
+static inline __m128i sse2ToInt( const float *in, __m128d scale, __m128d offset, __m128d low, __m128d high )
+{
+  __m128 s = _mm_loadu_ps( in );
+  __m128d a = _mm_add_pd( _mm_mul_pd( _mm_cvtps_pd( s ), scale ), offset );
+  __m128d b = _mm_add_pd( _mm_mul_pd( _mm_cvtps_pd( _mm_movehl_ps( s, s ) ), scale ), offset );
+  a = _mm_min_pd( _mm_max_pd( a, low ), high );
+  b = _mm_min_pd( _mm_max_pd( b, low ), high );
+  return _mm_unpacklo_epi64( _mm_cvttpd_epi32( a ), _mm_cvttpd_epi32( b ) );
+}
+
+static unsigned long sse2ToInt8( unsigned char *out, const float *in, unsigned long i, unsigned long n,
+                                 bool isUnsigned )
+{
+  __m128d scale = _mm_set1_pd( 127.0 );
+  __m128d offset = _mm_set1_pd( isUnsigned ? 128.0 : 0.0 );
+  __m128d low = _mm_set1_pd( isUnsigned ? 0.0 : -128.0 );
+  __m128d high = _mm_set1_pd( isUnsigned ? 255.0 : 127.0 );
+  for ( ; i+16<=n; i+=16 ) {
+    __m128i lo = _mm_packs_epi32( sse2ToInt( in+i, scale, offset, low, high ), sse2ToInt( in+i+4, scale, offset, low, high ) );
+    __m128i hi = _mm_packs_epi32( sse2ToInt( in+i+8, scale, offset, low, high ), sse2ToInt( in+i+12, scale, offset, low, high ) );
+    __m128i v = isUnsigned ? _mm_packus_epi16( lo, hi ) : _mm_packs_epi16( lo, hi );
+    _mm_storeu_si128( (__m128i *) ( out+i ), v );
+  }
+  return i;
+}
+
+static unsigned long sse2ToInt16( unsigned char *out, const float *in, unsigned long i, unsigned long n,
+                                  bool swap )
+{
+  __m128d scale = _mm_set1_pd( 32767.0 );
+  __m128d offset = _mm_setzero_pd();
+  __m128d low = _mm_set1_pd( -32768.0 );
+  __m128d high = _mm_set1_pd( 32767.0 );
+  for ( ; i+8<=n; i+=8 ) {
+    __m128i v = _mm_packs_epi32( sse2ToInt( in+i, scale, offset, low, high ), sse2ToInt( in+i+4, scale, offset, low, high ) );
+    if ( swap ) v = sse2Swap16( v );
+    _mm_storeu_si128( (__m128i *) ( out+2*i ), v );
+  }
+  return i;
+}
+
+static unsigned long sse2ToInt32( unsigned char *out, const float *in, unsigned long i, unsigned long n,
+                                  bool swap )
+{
+  __m128d scale = _mm_set1_pd( 2147483647.0 );
+  __m128d offset = _mm_setzero_pd();
+  __m128d low = _mm_set1_pd( -2147483648.0 );
+  __m128d high = _mm_set1_pd( 2147483647.0 );
+  for ( ; i+4<=n; i+=4 ) {
+    __m128i v = sse2ToInt( in+i, scale, offset, low, high );
+    if ( swap ) v = sse2Swap32( v );
+    _mm_storeu_si128( (__m128i *) ( out+4*i ), v );
+  }
+  return i;
+}
+
+static unsigned long sse2ToFloat32( unsigned char *out, const float *in, unsigned long i, unsigned long n )
+{
+  // Only needed for swapped data: native data is copied.
+  for ( ; i+4<=n; i+=4 ) {
+    __m128i v = sse2Swap32( _mm_castps_si128( _mm_loadu_ps( in+i ) ) );
+    _mm_storeu_si128( (__m128i *) ( out+4*i ), v );
+  }
+  return i;
+}
+
+static unsigned long sse2ToFloat64( unsigned char *out, const float *in, unsigned long i, unsigned long n,
+                                    bool swap )
+{
+  for ( ; i+4<=n; i+=4 ) {
+    __m128 s = _mm_loadu_ps( in+i );
+    __m128i a = _mm_castpd_si128( _mm_cvtps_pd( s ) );
+    __m128i b = _mm_castpd_si128( _mm_cvtps_pd( _mm_movehl_ps( s, s ) ) );
+    if ( swap ) {
+      a = sse2Swap64( a );
+      b = sse2Swap64( b );
+    }
+    _mm_storeu_si128( (__m128i *) ( out+8*i ), a );
+    _mm_storeu_si128( (__m128i *) ( out+8*i+16 ), b );
+  }
+  return i;
+}
+
+#endif // STK_CONVERT_SSE2
+
+#if defined(STK_CONVERT_AVX2)
+
+//============================================================================
+// AVX2 kernels (only called if the processor supports AVX2).
+//============================================================================
+
+// Byte shuffles, repeated in both 128-bit lanes.
+#define STK_SHUFFLE( a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p ) \
+  _mm256_setr_epi8( a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p, a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p )
+
+STK_TARGET_AVX2 static inline __m256i avx2Swap32Mask( void )
+{
+  return STK_SHUFFLE( 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 );
+}
+
+STK_TARGET_AVX2 static unsigned long avx2FromInt16( float *out, const unsigned char *in, unsigned long i, unsigned long n,
+                                                    bool swap, float gain )
+{
+  __m256 g = _mm256_set1_ps( gain );
+  __m128i swapMask = _mm_setr_epi8( 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 );
+  for ( ; i+16<=n; i+=16 ) {
+    __m128i a = _mm_loadu_si128( (const __m128i *) ( in+2*i ) );
+    __m128i b = _mm_loadu_si128( (const __m128i *) ( in+2*i+16 ) );
+    if ( swap ) {
+      a = _mm_shuffle_epi8( a, swapMask );
+      b = _mm_shuffle_epi8( b, swapMask );
+    }
+    _mm256_storeu_ps( out+i, _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32( a ) ), g ) );
+    _mm256_storeu_ps( out+i+8, _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32( b ) ), g ) );
+  }
+  return i;
+}
+
+STK_TARGET_AVX2 static unsigned long avx2FromInt24( float *out, const unsigned char *in, unsigned long i, unsigned long n,
+                                                    bool littleEndian, float gain )
+{
+  // Each lane loads 16 bytes for 4 samples (12 bytes), so stop 4 bytes short of the end.
+  __m256 g = _mm256_set1_ps( gain );
+  __m256i mask = littleEndian
+    ? STK_SHUFFLE( -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11 )
+    : STK_SHUFFLE( -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9 );
+  for ( ; i+10<=n; i+=8 ) {
+    __m128i a = _mm_loadu_si128( (const __m128i *) ( in+3*i ) );
+    __m128i b = _mm_loadu_si128( (const __m128i *) ( in+3*i+12 ) );
+    __m256i v = _mm256_inserti128_si256( _mm256_castsi128_si256( a ), b, 1 );
+    v = _mm256_shuffle_epi8( v, mask );
+    _mm256_storeu_ps( out+i, _mm256_mul_ps( _mm256_cvtepi32_ps( v ), g ) );
+  }
+  return i;
+}
+
+STK_TARGET_AVX2 static unsigned long avx2FromInt32( float *out, const unsigned char *in, unsigned long i, unsigned long n,
+                                                    bool swap, float gain )
+{
+  __m256 g = _mm256_set1_ps( gain );
+  __m256i mask = avx2Swap32Mask();
+  for ( ; i+8<=n; i+=8 ) {
+    __m256i v = _mm256_loadu_si256( (const __m256i *) ( in+4*i ) );
+    if ( swap ) v = _mm256_shuffle_epi8( v, mask );
+    _mm256_storeu_ps( out+i, _mm256_mul_ps( _mm256_cvtepi32_ps( v ), g ) );
+  }
+  return i;
+}
+
+STK_TARGET_AVX2 static unsigned long avx2FromFloat32( float *out, const unsigned char *in, unsigned long i, unsigned long n )
+{
+  __m256i mask = avx2Swap32Mask();
+  for ( ; i+8<=n; i+=8 ) {
+    __m256i v = _mm256_shuffle_epi8( _mm256_loadu_si256( (const __m256i *) ( in+4*i ) ), mask );
+    _mm256_storeu_ps( out+i, _mm256_castsi256_ps( v ) );
+  }
+  return i;
+}
+
+// Scale, saturate and truncate eight samples to integers (in double precision, as toInt()).
+STK_TARGET_AVX2 static inline __m256i avx2ToInt( const float *in, __m256d scale, __m256d low, __m256d high )
+{
+  __m256d a = _mm256_mul_pd( _mm256_cvtps_pd( _mm_loadu_ps( in ) ), scale );
+  __m256d b = _mm256_mul_pd( _mm256_cvtps_pd( _mm_loadu_ps( in+4 ) ), scale );
+  a = _mm256_min_pd( _mm256_max_pd( a, low ), high );
+  b = _mm256_min_pd( _mm256_max_pd( b, low ), high );
+  return _mm256_inserti128_si256( _mm256_castsi128_si256( _mm256_cvttpd_epi32( a ) ), _mm256_cvttpd_epi32( b ), 1 );
+}
+
+STK_TARGET_AVX2 static unsigned long avx2ToInt16( unsigned char *out, const float *in, unsigned long i, unsigned long n,
+                                                  bool swap )
+{
+  __m256d scale = _mm256_set1_pd( 32767.0 );
+  __m256d low = _mm256_set1_pd( -32768.0 );
+  __m256d high = _mm256_set1_pd( 32767.0 );
+  __m256i mask = STK_SHUFFLE( 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 );
+  for ( ; i+16<=n; i+=16 ) {
+    // packs works within lanes, so put the samples back in order afterwards.
+    __m256i v = _mm256_packs_epi32( avx2ToInt( in+i, scale, low, high ), avx2ToInt( in+i+8, scale, low, high ) );
+    v = _mm256_permute4x64_epi64( v, 0xD8 );
+    if ( swap ) v = _mm256_shuffle_epi8( v, mask );
+    _mm256_storeu_si256( (__m256i *) ( out+2*i ), v );
+  }
+  return i;
+}
+
+STK_TARGET_AVX2 static unsigned long avx2ToInt24( unsigned char *out, const float *in, unsigned long i, unsigned long n,
+                                                  bool littleEndian )
+{
+  // Each lane stores 16 bytes for 4 samples (12 bytes); the extra 4 bytes are
+  // overwritten by the next store, so stop 4 bytes short of the end.
+  __m256d scale = _mm256_set1_pd( 8388607.0 );
+  __m256d low = _mm256_set1_pd( -8388608.0 );
+  __m256d high = _mm256_set1_pd( 8388607.0 );
+  __m256i mask = littleEndian
+    ? STK_SHUFFLE( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 )
+    : STK_SHUFFLE( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
+  for ( ; i+10<=n; i+=8 ) {
+    __m256i v = _mm256_shuffle_epi8( avx2ToInt( in+i, scale, low, high ), mask );
+    _mm_storeu_si128( (__m128i *) ( out+3*i ), _mm256_castsi256_si128( v ) );
+    _mm_storeu_si128( (__m128i *) ( out+3*i+12 ), _mm256_extracti128_si256( v, 1 ) );
+  }
+  return i;
+}
+
+STK_TARGET_AVX2 static unsigned long avx2ToInt32( unsigned char *out, const float *in, unsigned long i, unsigned long n,
+                                                  bool swap )
+{
+  __m256d scale = _mm256_set1_pd( 2147483647.0 );
+  __m256d low = _mm256_set1_pd( -2147483648.0 );
+  __m256d high = _mm256_set1_pd( 2147483647.0 );
+  __m256i mask = avx2Swap32Mask();
+  for ( ; i+8<=n; i+=8 ) {
+    __m256i v = avx2ToInt( in+i, scale, low, high );
+    if ( swap ) v = _mm256_shuffle_epi8( v, mask );
+    _mm256_storeu_si256( (__m256i *) ( out+4*i ), v );
+  }
+  return i;
+}
+
+#undef STK_SHUFFLE
+
+#endif // STK_CONVERT_AVX2
+
+//============================================================================
+// Conversion to StkFloat.
+//============================================================================
+
+void SampleConvert :: toFloat( StkFloat *out, const void *input, unsigned long nSamples, StkFormat format,
+                               bool byteswap, bool doNormalize, bool unsignedBytes )
+{
+  const unsigned char *in = (const unsigned char *) input;
+  InstructionSet set = floatSamples ? currentSet : SCALAR;
+  float *vout = (float *) out;
+  unsigned long i = 0;
+  (void) set; (void) vout;
+
+  if ( format == STK_SINT8 ) {
+    StkFloat gain = doNormalize ? 1.0 / 128.0 : 1.0;
+#if defined(STK_CONVERT_SSE2)
+    if ( set >= SSE2 ) i = sse2FromInt8( vout, in, i, nSamples, unsignedBytes, gain );
+#endif
+    if ( unsignedBytes ) { // 8-bit WAV data is unsigned!
+      for ( ; i<nSamples; i++ )
+        out[i] = ( in[i] - 128 ) * gain;
+    }
+    else {
+      for ( ; i<nSamples; i++ )
+        out[i] = (signed char) in[i] * gain;
+    }
+  }
+  else if ( format == STK_SINT16 ) {
+    StkFloat gain = doNormalize ? 1.0 / 32768.0 : 1.0;
+#if defined(STK_CONVERT_AVX2)
+    if ( set >= AVX2 ) i = avx2FromInt16( vout, in, i, nSamples, byteswap, gain );
+#endif
+#if defined(STK_CONVERT_SSE2)
+    if ( set >= SSE2 ) i = sse2FromInt16( vout, in, i, nSamples, byteswap, gain );
+#endif
+    for ( ; i<nSamples; i++ )
+      out[i] = (SINT16) load16( in+2*i, byteswap ) * gain;
+  }
+  else if ( format == STK_SINT24 ) {
+    // Each sample is placed in the top three bytes of a 32-bit integer, so "gain" includes a 1 / 256 factor.
+    StkFloat gain = doNormalize ? 1.0 / 2147483648.0 : 1.0 / 256.0;
+    bool little = littleEndian24( byteswap );
+#if defined(STK_CONVERT_AVX2)
+    if ( set >= AVX2 ) i = avx2FromInt24( vout, in, i, nSamples, little, gain );
+#endif
+    for ( ; i<nSamples; i++ ) {
+      const unsigned char *p = in + 3*i;
+      UINT32 v;
+      if ( little )
+        v = ( (UINT32) p[2] << 24 ) | ( (UINT32) p[1] << 16 ) | ( (UINT32) p[0] << 8 );
+      else
+        v = ( (UINT32) p[0] << 24 ) | ( (UINT32) p[1] << 16 ) | ( (UINT32) p[2] << 8 );
+      out[i] = (StkFloat) (SINT32) v * gain;
+    }
+  }
+  else if ( format == STK_SINT32 ) {
+    StkFloat gain = doNormalize ? 1.0 / 2147483648.0 : 1.0;
+#if defined(STK_CONVERT_AVX2)
+    if ( set >= AVX2 ) i = avx2FromInt32( vout, in, i, nSamples, byteswap, gain );
+#endif
+#if defined(STK_CONVERT_SSE2)
+    if ( set >= SSE2 ) i = sse2FromInt32( vout, in, i, nSamples, byteswap, gain );
+#endif
+    for ( ; i<nSamples; i++ )
+      out[i] = (StkFloat) (SINT32) load32( in+4*i, byteswap ) * gain;
+  }
+  else if ( format == STK_FLOAT32 ) {
+    if ( !byteswap && floatSamples ) {
+      memcpy( out, in, nSamples * 4 );
+      return;
+    }
+#if defined(STK_CONVERT_AVX2)
+    if ( set >= AVX2 ) i = avx2FromFloat32( vout, in, i, nSamples );
+#endif
+#if defined(STK_CONVERT_SSE2)
+    if ( set >= SSE2 ) i = sse2FromFloat32( vout, in, i, nSamples );
+#endif
+    for ( ; i<nSamples; i++ ) {
+      UINT32 v = load32( in+4*i, byteswap );
+      FLOAT32 f;
+      memcpy( &f, &v, 4 );
+      out[i] = f;
+    }
+  }
+  else if ( format == STK_FLOAT64 ) {
+#if defined(STK_CONVERT_SSE2)
+    if ( set >= SSE2 ) i = sse2FromFloat64( vout, in, i, nSamples, byteswap );
+#endif
+    for ( ; i<nSamples; i++ )
+      out[i] = (StkFloat) load64( in+8*i, byteswap );
+  }
+}
+
+//============================================================================
+// Conversion from StkFloat.
+//============================================================================
+
+void SampleConvert :: fromFloat( void *output, const StkFloat *in, unsigned long nSamples, StkFormat format,
+                                 bool byteswap, bool unsignedBytes )
+{
+  unsigned char *out = (unsigned char *) output;
+  InstructionSet set = floatSamples ? currentSet : SCALAR;
+  const float *vin = (const float *) in;
+  unsigned long i = 0;
+  (void) set; (void) vin;
+
+  if ( format == STK_SINT8 ) {
+#if defined(STK_CONVERT_SSE2)
+    if ( set >= SSE2 ) i = sse2ToInt8( out, vin, i, nSamples, unsignedBytes );
+#endif
+    if ( unsignedBytes ) { // 8-bit WAV data is unsigned!
+      for ( ; i<nSamples; i++ )
+        out[i] = (unsigned char) toInt( in[i], 127.0, 128.0, 0.0, 255.0 );
+    }
+    else {
+      for ( ; i<nSamples; i++ )
+        out[i] = (unsigned char) (signed char) toInt( in[i], 127.0, 0.0, -128.0, 127.0 );
+    }
+  }
+  else if ( format == STK_SINT16 ) {
+#if defined(STK_CONVERT_AVX2)
+    if ( set >= AVX2 ) i = avx2ToInt16( out, vin, i, nSamples, byteswap );
+#endif
+#if defined(STK_CONVERT_SSE2)
+    if ( set >= SSE2 ) i = sse2ToInt16( out, vin, i, nSamples, byteswap );
+#endif
+    for ( ; i<nSamples; i++ )
+      store16( out+2*i, (UINT16) toInt( in[i], 32767.0, 0.0, -32768.0, 32767.0 ), byteswap );
+  }
+  else if ( format == STK_SINT24 ) {
+    bool little = littleEndian24( byteswap );
+#if defined(STK_CONVERT_AVX2)
+    if ( set >= AVX2 ) i = avx2ToInt24( out, vin, i, nSamples, little );
+#endif
+    for ( ; i<nSamples; i++ ) {
+      UINT32 v = (UINT32) toInt( in[i], 8388607.0, 0.0, -8388608.0, 8388607.0 );
+      unsigned char *p = out + 3*i;
+      if ( little ) {
+        p[0] = (unsigned char) v;
+        p[1] = (unsigned char) ( v >> 8 );
+        p[2] = (unsigned char) ( v >> 16 );
+      }
+      else {
+        p[0] = (unsigned char) ( v >> 16 );
+        p[1] = (unsigned char) ( v >> 8 );
+        p[2] = (unsigned char) v;
+      }
+    }
+  }
+  else if ( format == STK_SINT32 ) {
+#if defined(STK_CONVERT_AVX2)
+    if ( set >= AVX2 ) i = avx2ToInt32( out, vin, i, nSamples, byteswap );
+#endif
+#if defined(STK_CONVERT_SSE2)
+    if ( set >= SSE2 ) i = sse2ToInt32( out, vin, i, nSamples, byteswap );
+#endif
+    for ( ; i<nSamples; i++ )
+      store32( out+4*i, (UINT32) toInt( in[i], 2147483647.0, 0.0, -2147483648.0, 2147483647.0 ), byteswap );
+  }
+  else if ( format == STK_FLOAT32 ) {
+    if ( !byteswap && floatSamples ) {
+      memcpy( out, in, nSamples * 4 );
+      return;
+    }
+#if defined(STK_CONVERT_SSE2)
+    if ( set >= SSE2 ) i = sse2ToFloat32( out, vin, i, nSamples );
+#endif
+    for ( ; i<nSamples; i++ ) {
+      FLOAT32 f = (FLOAT32) in[i];
+      UINT32 v;
+      memcpy( &v, &f, 4 );
+      store32( out+4*i, v, byteswap );
+    }
+  }
+  else if ( format == STK_FLOAT64 ) {
+#if defined(STK_CONVERT_SSE2)
+    if ( set >= SSE2 ) i = sse2ToFloat64( out, vin, i, nSamples, byteswap );
+#endif
+    for ( ; i<nSamples; i++ )
+      store64( out+8*i, (FLOAT64) in[i], byteswap );
+  }
+}
+
+} // stk namespace
@@ -0,0 +1,81 @@
+#ifndef STK_SAMPLECONVERT_H
+#define STK_SAMPLECONVERT_H
+
+#include "Stk.h"
+
+namespace stk {
+
+/***************************************************/
+/*! \class SampleConvert
+    \brief STK sample format conversion class.
+
+    This class converts blocks of audio samples between the data
+    formats of the STK file classes (signed 8-, 16-, 24- and 32-bit
+    integers, packed 24-bit included, and 32- and 64-bit floats, in
+    either byte order) and StkFloat.  It is used by FileRead and
+    FileWrite.
+
+    The conversions are vectorized with SSE2 on x86 processors and
+    with AVX2 where the processor supports it (checked at run time),
+    with a scalar fallback for other processors and for the ends of
+    blocks.  All instruction sets give identical results.
+
+    Integer data is normalized as FileRead and FileWrite always have:
+    by 1/2^(bits-1) when read and by 2^(bits-1)-1 when written, with
+    the scaling done in double precision and the result truncated.
+    Written samples saturate at the full integer range of the format,
+    -2^(bits-1) to 2^(bits-1)-1 (0 to 255 for unsigned bytes), rather
+    than at plus/minus 1.0, so -1.0 is written as -(2^(bits-1)-1) and
+    only samples slightly below it reach -2^(bits-1).
+*/
+/***************************************************/
+
+class SampleConvert : public Stk
+{
+ public:
+
+  //! Instruction sets used for the conversions.
+  enum InstructionSet {
+    SCALAR,
+    SSE2,
+    AVX2
+  };
+
+  //! Convert \e nSamples samples of type \e format to StkFloat.
+  /*!
+    If \e byteswap is true, the input is in the opposite byte order
+    to the machine's.  If \e doNormalize is true, integer data is
+    scaled to plus/minus 1.0 (floating-point data is never scaled).
+    8-bit data is read as unsigned (offset by 128) if \e unsignedBytes
+    is true, as in WAV files.  The input need not be aligned.
+  */
+  static void toFloat( StkFloat *out, const void *in, unsigned long nSamples, StkFormat format,
+                       bool byteswap, bool doNormalize, bool unsignedBytes = false );
+
+  //! Convert \e nSamples StkFloat samples to type \e format.
+  /*!
+    Exactly nSamples * sampleBytes( format ) bytes are written to
+    \e out, which need not be aligned.  The arguments are as for
+    toFloat().
+  */
+  static void fromFloat( void *out, const StkFloat *in, unsigned long nSamples, StkFormat format,
+                         bool byteswap, bool unsignedBytes = false );
+
+  //! Return the size in bytes of a sample of type \e format (0 if unknown).
+  static unsigned int sampleBytes( StkFormat format );
+
+  //! Return the instruction set in use.
+  static InstructionSet instructionSet( void );
+
+  //! Limit the instruction set used (for testing and benchmarking).
+  /*!
+    The best supported instruction set not above \e set is used.
+    This should not be called while conversions are running in other
+    threads.
+  */
+  static void setInstructionSet( InstructionSet set );
+};
+
+} // stk namespace
+
+#endif
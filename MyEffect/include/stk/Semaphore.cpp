@@ -0,0 +1,79 @@
+/***************************************************/
+/*! \class Semaphore
+    \brief STK lightweight semaphore class.
+
+    This class wakes a background thread (such as a file I/O or
+    convolution worker) from the audio thread.  The count is kept in
+    an atomic integer, so post() never locks or blocks: it only calls
+    into the operating system semaphore when a thread is actually
+    asleep in wait(), and then only to release it.
+*/
+/***************************************************/
+
+#include "Semaphore.h"
+
+#if defined(_WIN32)
+  #include <windows.h>
+#elif defined(__APPLE__)
+  #include <dispatch/dispatch.h>
+#else
+  #include <semaphore.h>
+  #include <errno.h>
+#endif
+
+namespace stk {
+
+Semaphore :: Semaphore( void )
+  : count_(0)
+{
+#if defined(_WIN32)
+  handle_ = CreateSemaphore( NULL, 0, LONG_MAX, NULL );
+#elif defined(__APPLE__)
+  handle_ = dispatch_semaphore_create( 0 );
+#else
+  sem_t *semaphore = new sem_t;
+  sem_init( semaphore, 0, 0 );
+  handle_ = semaphore;
+#endif
+}
+
+Semaphore :: ~Semaphore( void )
+{
+#if defined(_WIN32)
+  CloseHandle( (HANDLE) handle_ );
+#elif defined(__APPLE__)
+  dispatch_release( (dispatch_semaphore_t) handle_ );
+#else
+  sem_destroy( (sem_t *) handle_ );
+  delete (sem_t *) handle_;
+#endif
+}
+
+void Semaphore :: post( void )
+{
+  // Only a thread asleep in wait() (count below zero) needs the operating system semaphore.
+  if ( count_.fetch_add( 1, std::memory_order_release ) >= 0 ) return;
+
+#if defined(_WIN32)
+  ReleaseSemaphore( (HANDLE) handle_, 1, NULL );
+#elif defined(__APPLE__)
+  dispatch_semaphore_signal( (dispatch_semaphore_t) handle_ );
+#else
+  sem_post( (sem_t *) handle_ );
+#endif
+}
+
+void Semaphore :: wait( void )
+{
+  if ( count_.fetch_sub( 1, std::memory_order_acquire ) > 0 ) return;
+
+#if defined(_WIN32)
+  WaitForSingleObject( (HANDLE) handle_, INFINITE );
+#elif defined(__APPLE__)
+  dispatch_semaphore_wait( (dispatch_semaphore_t) handle_, DISPATCH_TIME_FOREVER );
+#else
+  while ( sem_wait( (sem_t *) handle_ ) == -1 && errno == EINTR ) {}
+#endif
+}
+
+} // stk namespace
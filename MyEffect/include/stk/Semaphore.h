@@ -0,0 +1,50 @@
+#ifndef STK_SEMAPHORE_H
+#define STK_SEMAPHORE_H
+
+#include "Stk.h"
+#include <atomic>
+
+namespace stk {
+
+/***************************************************/
+/*! \class Semaphore
+    \brief STK lightweight semaphore class.
+
+    This class wakes a background thread (such as a file I/O or
+    convolution worker) from the audio thread.  The count is kept in
+    an atomic integer, so post() never locks or blocks: it only calls
+    into the operating system semaphore when a thread is actually
+    asleep in wait(), and then only to release it.  wait() blocks,
+    without a timeout, until post() has been called as many times as
+    wait().
+*/
+/***************************************************/
+
+class Semaphore : public Stk
+{
+ public:
+  //! Default constructor, with a count of zero.
+  Semaphore( void );
+
+  //! Class destructor.
+  ~Semaphore( void );
+
+  //! Any thread: increment the count, waking a thread blocked in wait() (never locks or blocks).
+  void post( void );
+
+  //! Block until the count is greater than zero, then decrement it.
+  void wait( void );
+
+ protected:
+
+  std::atomic<int> count_; // negative while a thread waits
+  void *handle_;           // operating system semaphore
+
+ private:
+  Semaphore( const Semaphore& );
+  Semaphore& operator=( const Semaphore& );
+};
+
+} // stk namespace
+
+#endif
@@ -17,6 +17,10 @@
 
     noteOn  60.01  111.132
 
+    SKINI files can be converted to a compact
+    binary form with convertFile(), which is
+    memory-mapped for playback.
+
     See also SKINI.txt.
 
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
@@ -26,21 +30,55 @@
 #include "Skini.h"
 #include "SKINI.tbl"
 #include <cstdlib>
+#include <cstring>
 #include <sstream>
 
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
 namespace stk {
 
+// The binary file header: "SKNB", the format version, the number of
+// records and the record size (all 32-bit little-endian values).
+// The records follow the header, then the message text.
+static const char skiniBinaryId[4] = { 'S', 'K', 'N', 'B' };
+static const UINT32 skiniBinaryVersion = 1;
+static const size_t skiniHeaderSize = 16;
+
+#ifndef __LITTLE_ENDIAN__
+static void swapRecord( Skini::Record& record )
+{
+  Stk::swap32( (unsigned char *) &record.time );
+  Stk::swap32( (unsigned char *) &record.floatValues[0] );
+  Stk::swap32( (unsigned char *) &record.floatValues[1] );
+  Stk::swap32( (unsigned char *) &record.type );
+  Stk::swap32( (unsigned char *) &record.channel );
+  Stk::swap32( (unsigned char *) &record.intValues[0] );
+  Stk::swap32( (unsigned char *) &record.intValues[1] );
+  Stk::swap32( (unsigned char *) &record.remainderOffset );
+  Stk::swap32( (unsigned char *) &record.remainderLength );
+}
+#endif
+
 Skini :: Skini()
+  : mapping_(0), mapSize_(0), records_(0), nRecords_(0), iRecord_(0)
 {
 }
 
 Skini :: ~Skini()
 {
+  unmapFile();
 }
 
 bool Skini :: setFile( std::string fileName )
 {
-  if ( file_.is_open() ) {
+  if ( file_.is_open() || mapping_ ) {
     oStream_ << "Skini::setFile: already reaading a file!";
     handleError( StkError::WARNING );
     return false;
@@ -53,11 +91,186 @@ bool Skini :: setFile( std::string fileName )
     return false;
   }
 
+  // Check for a binary file.
+  char id[4];
+  if ( file_.read( id, 4 ) && strncmp( id, skiniBinaryId, 4 ) == 0 ) {
+    file_.close();
+    if ( !mapFile( fileName ) ) {
+      oStream_ << "Skini::setFile: invalid binary SKINI file (" << fileName << ")";
+      handleError( StkError::WARNING );
+      return false;
+    }
+    return true;
+  }
+
+  file_.clear();
+  file_.seekg( 0, std::ios_base::beg );
+  return true;
+}
+
+bool Skini :: mapFile( std::string fileName )
+{
+  void *data = 0;
+  size_t size = 0;
+
+#if defined(_WIN32)
+  HANDLE file = CreateFileA( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+  if ( file == INVALID_HANDLE_VALUE ) return false;
+  LARGE_INTEGER fileSize;
+  if ( GetFileSizeEx( file, &fileSize ) && fileSize.QuadPart >= (LONGLONG) skiniHeaderSize ) {
+    size = (size_t) fileSize.QuadPart;
+    HANDLE handle = CreateFileMapping( file, NULL, PAGE_READONLY, 0, 0, NULL );
+    if ( handle != NULL ) {
+      data = MapViewOfFile( handle, FILE_MAP_READ, 0, 0, 0 );
+      CloseHandle( handle ); // the view keeps the mapping open
+    }
+  }
+  CloseHandle( file );
+  if ( data == NULL ) return false;
+#else
+  int fd = open( fileName.c_str(), O_RDONLY );
+  if ( fd == -1 ) return false;
+  struct stat filestat;
+  if ( fstat( fd, &filestat ) == 0 && filestat.st_size >= (off_t) skiniHeaderSize ) {
+    size = (size_t) filestat.st_size;
+    data = mmap( 0, size, PROT_READ, MAP_SHARED, fd, 0 );
+    if ( data == MAP_FAILED ) data = 0;
+  }
+  close( fd ); // the mapping keeps the file open
+  if ( data == 0 ) return false;
+#endif
+
+  mapping_ = (unsigned char *) data;
+  mapSize_ = size;
+
+  // Check the header.
+  UINT32 header[3];
+  memcpy( header, mapping_ + 4, sizeof(header) );
+#ifndef __LITTLE_ENDIAN__
+  for ( int i=0; i<3; i++ ) swap32( (unsigned char *) &header[i] );
+#endif
+  if ( header[0] != skiniBinaryVersion || header[2] != sizeof(Record) ||
+       header[1] > ( mapSize_ - skiniHeaderSize ) / sizeof(Record) ) {
+    unmapFile();
+    return false;
+  }
+
+  records_ = (const Record *) ( mapping_ + skiniHeaderSize );
+  nRecords_ = header[1];
+  iRecord_ = 0;
+  return true;
+}
+
+void Skini :: unmapFile( void )
+{
+  if ( mapping_ == 0 ) return;
+
+#if defined(_WIN32)
+  UnmapViewOfFile( mapping_ );
+#else
+  munmap( mapping_, mapSize_ );
+#endif
+
+  mapping_ = 0;
+  mapSize_ = 0;
+  records_ = 0;
+  nRecords_ = 0;
+  iRecord_ = 0;
+}
+
+bool Skini :: convertFile( std::string textFile, std::string binaryFile )
+{
+  Skini skini;
+  if ( !skini.setFile( textFile ) ) return false;
+  if ( skini.mapping_ ) {
+    skini.oStream_ << "Skini::convertFile: file (" << textFile << ") is already binary!";
+    skini.handleError( StkError::WARNING );
+    return false;
+  }
+
+  // Parse the whole file, collecting the message text separately.
+  std::vector<Record> records;
+  std::string text;
+  Message message;
+  Record record;
+  message.remainder.clear();
+  while ( skini.nextMessage( message ) ) {
+    record.time = (FLOAT32) message.time;
+    record.type = (SINT32) message.type;
+    record.channel = (SINT32) message.channel;
+    for ( int i=0; i<2; i++ ) {
+      record.floatValues[i] = (FLOAT32) message.floatValues[i];
+      record.intValues[i] = (SINT32) message.intValues[i];
+    }
+    record.remainderOffset = (UINT32) text.size();
+    record.remainderLength = (UINT32) message.remainder.size();
+    text += message.remainder;
+    message.remainder.clear();
+    records.push_back( record );
+  }
+
+  std::ofstream file( binaryFile.c_str(), std::ios::out | std::ios::binary );
+  if ( !file ) {
+    skini.oStream_ << "Skini::convertFile: unable to open file (" << binaryFile << ")";
+    skini.handleError( StkError::WARNING );
+    return false;
+  }
+
+  UINT32 header[3] = { skiniBinaryVersion, (UINT32) records.size(), (UINT32) sizeof(Record) };
+  UINT32 textOffset = (UINT32) ( skiniHeaderSize + records.size() * sizeof(Record) );
+  for ( size_t i=0; i<records.size(); i++ ) {
+    records[i].remainderOffset += textOffset;
+#ifndef __LITTLE_ENDIAN__
+    swapRecord( records[i] );
+#endif
+  }
+#ifndef __LITTLE_ENDIAN__
+  for ( int i=0; i<3; i++ ) swap32( (unsigned char *) &header[i] );
+#endif
+
+  file.write( skiniBinaryId, 4 );
+  file.write( (const char *) header, sizeof(header) );
+  if ( !records.empty() )
+    file.write( (const char *) &records[0], records.size() * sizeof(Record) );
+  file.write( text.data(), text.size() );
+  if ( !file ) {
+    skini.oStream_ << "Skini::convertFile: error writing file (" << binaryFile << ")";
+    skini.handleError( StkError::WARNING );
+    return false;
+  }
+
   return true;
 }
 
 long Skini :: nextMessage( Message& message )
 {
+  if ( mapping_ ) {
+    // Copy the next record of a binary file.
+    if ( iRecord_ >= nRecords_ ) {
+      oStream_ << "// End of Score.  Thanks for using SKINI!!";
+      handleError( StkError::STATUS );
+      unmapFile();
+      return message.type = 0;
+    }
+
+    Record record = records_[iRecord_++];
+#ifndef __LITTLE_ENDIAN__
+    swapRecord( record );
+#endif
+    message.type = record.type;
+    message.channel = record.channel;
+    message.time = (StkFloat) record.time;
+    for ( int i=0; i<2; i++ ) {
+      message.floatValues[i] = (StkFloat) record.floatValues[i];
+      message.intValues[i] = record.intValues[i];
+    }
+    if ( record.remainderLength > 0 && record.remainderOffset <= mapSize_ &&
+         record.remainderLength <= mapSize_ - record.remainderOffset )
+      message.remainder.assign( (const char *) mapping_ + record.remainderOffset, record.remainderLength );
+
+    return message.type;
+  }
+
   if ( !file_.is_open() ) return 0;
 
   std::string line;
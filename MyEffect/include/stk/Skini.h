@@ -29,6 +29,12 @@ namespace stk {
     noteOn  60.01  111.132
     \endcode
 
+    For fast score playback, a SKINI file can be converted to a
+    compact binary form with convertFile().  The binary file holds
+    the parsed messages as fixed-size records, which setFile()
+    recognizes and memory-maps, so that nextMessage() only copies
+    the next record into the message structure.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -51,19 +57,39 @@ class Skini : public Stk
       :type(0), channel(0), time(0.0), floatValues(2), intValues(2) {}
   };
 
+  //! A fixed-size message record of a binary SKINI file (stored little-endian).
+  struct Record {
+    FLOAT32 time;             /*!< The message time stamp in seconds (negative for absolute times). */
+    FLOAT32 floatValues[2];   /*!< The message values read as floats (single precision, as StkFloat). */
+    SINT32 type;              /*!< The message type. */
+    SINT32 channel;           /*!< The message channel. */
+    SINT32 intValues[2];      /*!< The message values read as ints. */
+    UINT32 remainderOffset;   /*!< The file position of the remaining message text. */
+    UINT32 remainderLength;   /*!< The length of the remaining message text (zero if the message has no text field). */
+  };
+
   //! Default constructor.
   Skini();
 
   //! Class destructor
   ~Skini();
 
-  //! Set a SKINI formatted file for reading.
+  //! Set a SKINI formatted file, text or binary, for reading.
   /*!
-    If the file is successfully opened, this function returns \e
-    true.  Otherwise, \e false is returned.
+    Binary files (written by convertFile()) are memory-mapped.  If
+    the file is successfully opened, this function returns \e true.
+    Otherwise, \e false is returned.
    */
   bool setFile( std::string fileName );
 
+  //! Convert the SKINI text file \e textFile to the binary file \e binaryFile.
+  /*!
+    The messages are parsed as nextMessage() would parse them, and
+    the lines which cannot be parsed are skipped.  Returns \e false if
+    a file cannot be opened or written.
+  */
+  static bool convertFile( std::string textFile, std::string binaryFile );
+
   //! Parse the next file message (if a file is loaded) and return the message type.
   /*!
     This function skips over lines in a file which cannot be
@@ -89,8 +115,17 @@ class Skini : public Stk
  protected:
 
   void tokenize( const std::string& str, std::vector<std::string>& tokens, const std::string& delimiters );
+  bool mapFile( std::string fileName );
+  void unmapFile( void );
 
   std::ifstream file_;
+
+  // A memory-mapped binary file.
+  unsigned char *mapping_;
+  size_t mapSize_;
+  const Record *records_;
+  unsigned long nRecords_;
+  unsigned long iRecord_;
 };
 
 //! A static table of equal-tempered MIDI to frequency (Hz) values.
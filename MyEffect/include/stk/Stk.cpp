@@ -66,7 +66,7 @@ const Stk::StkFormat Stk :: STK_FLOAT64 = 0x20;
 bool Stk :: showWarnings_ = true;
 bool Stk :: printErrors_ = true;
 std::vector<Stk *> Stk :: alertList_;
-std::ostringstream Stk :: oStream_;
+thread_local std::ostringstream Stk :: oStream_;
 
 Stk :: Stk( void )
   : ignoreSampleRateChange_(false)
@@ -194,8 +194,10 @@ void Stk :: sleep(unsigned long milliseconds)
 
 void Stk :: handleError( StkError::Type type )
 {
-  handleError( oStream_.str(), type );
-  oStream_.str( std::string() ); // reset the ostringstream buffer
+  // Reset the ostringstream buffer first, as handleError() throws for errors.
+  std::string message = oStream_.str();
+  oStream_.str( std::string() );
+  handleError( message, type );
 }
 
 void Stk :: handleError( const char *message, StkError::Type type )
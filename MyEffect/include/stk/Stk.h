@@ -5,6 +5,7 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <cmath>
 //#include <cstdlib>
 
 /*! \namespace stk
@@ -217,7 +218,9 @@ private:
 
 protected:
 
-  static std::ostringstream oStream_;
+  // One per thread, so objects on different threads (e.g. file readers and writers
+  // on a pool of workers) can compose and report errors at the same time.
+  static thread_local std::ostringstream oStream_;
   bool ignoreSampleRateChange_;
 
   //! Default constructor.
@@ -531,6 +534,15 @@ const StkFloat PI           = 3.14159265358979;
 const StkFloat TWO_PI       = 2 * PI;
 const StkFloat ONE_OVER_128 = 0.0078125;
 
+// Flush values too small to matter (magnitudes below 1e-25, about -500 dB) to zero, before
+// they decay into denormals, which are very slow to process on x86. Use on signals fed back
+// into recursive filters and delay lines. Any value at or above the threshold is returned
+// exactly; the comparison compiles to a compare and mask, without a branch.
+inline StkFloat undenormalize( StkFloat s )
+{
+  return std::fabs( s ) < (StkFloat) 1e-25 ? (StkFloat) 0.0 : s;
+}
+
 #if defined(__WINDOWS_DS__) || defined(__WINDOWS_ASIO__) || defined(__WINDOWS_MM__)
   #define __OS_WINDOWS__
   #define __STK_REALTIME__
@@ -544,6 +556,13 @@ const StkFloat ONE_OVER_128 = 0.0078125;
   #define __STK_REALTIME__
 #endif
 
+// Only clang predefines __LITTLE_ENDIAN__, which the file classes use to decide on byte swapping.
+#if !defined(__LITTLE_ENDIAN__)
+  #if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_M_IX86) || defined(_M_X64)
+    #define __LITTLE_ENDIAN__
+  #endif
+#endif
+
 } // stk namespace
 
 #endif
@@ -10,190 +10,592 @@
 //
 //  This file is a workspace for developing new DSP objects or functions to use in your plugin.
 //
-class MyFilter
+
+// SIMD support for MyChorusBank (SSE2 on x86, NEON on ARM, scalar everywhere else)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define MYEFFECT_SSE2
+ #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+ #define MYEFFECT_NEON
+ #include <arm_neon.h>
+#endif
+
+#include <atomic>
+#include <stdint.h>
+
+//LFO shapes for MyChorusBank's voices: triangle, sine and smoothed random. The phase is a 32-bit fixed
+//point accumulator (one cycle = 2^32) that wraps on its own, the increment is only recomputed when the
+//rate (or sample rate) changes, and every shape is evaluated without branching on the phase. The scalar
+//kernel calls these functions; the SIMD kernels do the same arithmetic lane by lane.
+class MyOscillator
 {
 public:
-    void initialise(float coeff)
+    enum Shape
     {
-        a = coeff;
-        b = 1 - a;
+        TRIANGLE,
+        SINE,
+        RANDOM
+    };
+    
+    //fixed point phase increment for fRate Hz
+    static unsigned int phaseIncrement(float fRate, float fSampleRate)
+    {
+        return (unsigned int)((double)fRate / fSampleRate * 4294967296.0);
     }
     
-    float process(float input)
+    //phase mapped to [-1, 1) with the start of the cycle at -1
+    static float bipolar(unsigned int uPhasePos)
     {
-        return previous = (a * input) + (b * previous);
+        return (float)(int)(uPhasePos ^ 0x80000000u) * kInvPhaseHalf;
     }
     
-private:
-    float a, b;
-    float previous = 0;
+    //triangle: -1 at the start of the cycle, +1 half way through
+    static float triangle(unsigned int uPhasePos)
+    {
+        return 1 - fabsf(bipolar(uPhasePos) * 2);
+    }
+    
+    //sin(pi/2 * x) for a triangle x in [-1, 1] gives a sine in phase with triangle()
+    //(7th order Taylor polynomial, error below 2e-4)
+    static float sine(float fTriangle)
+    {
+        float fSquare = fTriangle * fTriangle;
+        return fTriangle * (kSine1 + fSquare * (kSine3 + fSquare * (kSine5 + fSquare * kSine7)));
+    }
+    
+    //glide from fFrom to fTo over one cycle with a smoothstep curve
+    static float smoothRandom(float fFrom, float fTo, unsigned int uPhasePos)
+    {
+        float fPos = bipolar(uPhasePos) * 0.5f + 0.5f;
+        return fFrom + (fTo - fFrom) * (fPos * fPos * (3 - 2 * fPos));
+    }
+    
+    //xorshift32 step
+    static unsigned int nextRandom(unsigned int uSeed)
+    {
+        uSeed ^= uSeed << 13;
+        uSeed ^= uSeed >> 17;
+        uSeed ^= uSeed << 5;
+        return uSeed;
+    }
+    
+    //random seed mapped to [-1, 1)
+    static float randomValue(unsigned int uSeed)
+    {
+        return (float)(int)uSeed * kInvPhaseHalf;
+    }
+    
+    static constexpr float kInvPhaseHalf = 1.f / 2147483648.f;
+    static constexpr float kSine1 = 1.5707963f, kSine3 = -0.6459641f, kSine5 = 0.0796926f, kSine7 = -0.0046818f;
 };
 
-class MyOscillator
+//ring buffer storage for a delay line, rounded up to a power of two so positions wrap with a bitmask
+//(iChannels > 1 interleaves several delay lines sample by sample)
+struct MyDelayBuffer
+{
+    MyDelayBuffer(int iMinSize, int iChannels = 1)
+    {
+        iSize = 1;
+        while (iSize < iMinSize)
+            iSize <<= 1;
+        iMask = iSize - 1;
+        
+        pfData = new float[iSize * iChannels];
+        for (int i = 0; i < iSize * iChannels; i++)
+        {
+            pfData[i] = 0;
+        }
+    }
+    ~MyDelayBuffer()
+    {
+        delete [] pfData;
+    }
+    
+    //samples needed to delay by up to fMaxDelayTime seconds at fSampleRate
+    static int sizeFor(float fMaxDelayTime, float fSampleRate)
+    {
+        return (int)(fMaxDelayTime * fSampleRate) + 2;
+    }
+    
+    float *pfData;
+    int iSize, iMask;
+};
+
+//hands a new MyDelayBuffer from the host thread (e.g. setSampleRate) to the audio thread without
+//locking or allocating on the audio thread. A single slot holds either a buffer waiting for the
+//audio thread (tagged kFresh) or the buffer the audio thread last replaced, and each side hands
+//over with one atomic swap: publish() swaps a fresh buffer in and frees whatever it swaps out (an
+//unused fresh buffer or a retired one), update() swaps the current buffer in and takes the fresh
+//one. So a published buffer is always picked up by the next update(), however the calls interleave.
+class MyDelayBufferExchange
 {
 public:
-    MyOscillator()
+    MyDelayBufferExchange() : uSlot(0) {}
+    ~MyDelayBufferExchange()
     {
-        fPhasePos = 0;
+        delete untag(uSlot.exchange(0));
     }
     
-    float generate(float fRate, float fDepth)
+    //host thread: queue a buffer for the audio thread to pick up
+    void publish(MyDelayBuffer *pBuffer)
     {
-        float fMod = 0;
-        float fPhaseInc = (fTwoPI * fRate) / getSampleRate();
-        
-        //cycle thorugh triangle wave
-        fPhasePos += fPhaseInc;
-        if (fPhasePos > fTwoPI)
-        {
-            fPhasePos -= fTwoPI;
-        }
-        
-        //get triangle wave value based on fPhasePos
-        if (fPhasePos < M_PI)
-        {
-            fMod = -1 + 2/M_PI * fPhasePos;
-        }
-        else if (fPhasePos >= M_PI)
-        {
-            fMod = 3 - 2/M_PI * fPhasePos;
-        }
+        delete untag(uSlot.exchange((uintptr_t)pBuffer | kFresh, std::memory_order_acq_rel));
+    }
+    
+    //audio thread: returns the buffer to use from now on (pCurrent if nothing new is waiting)
+    MyDelayBuffer* update(MyDelayBuffer *pCurrent)
+    {
+        //only publish() stores a fresh buffer, so once one is seen the swap takes a fresh one
+        //(perhaps a newer one than was seen)
+        if ((uSlot.load(std::memory_order_acquire) & kFresh) == 0)
+            return pCurrent;
         
-        return fMod * fDepth + fDepth;
+        return untag(uSlot.exchange((uintptr_t)pCurrent, std::memory_order_acq_rel));
     }
     
 private:
-    float fPhasePos;
-    const float fTwoPI = 2 * M_PI;
+    static const uintptr_t kFresh = 1; //MyDelayBuffers are at least 2-byte aligned, so bit 0 is free
+    
+    static MyDelayBuffer* untag(uintptr_t uValue)
+    {
+        return (MyDelayBuffer*)(uValue & ~kFresh);
+    }
+    
+    std::atomic<uintptr_t> uSlot;
 };
 
-class MyDelay
+//structure-of-arrays chorus engine: every voice is one SIMD lane, so the LFOs, smoothed
+//delay times and read positions of all voices are worked out side by side. The delay
+//lines are interleaved (sample-major, one slot per lane) so each sample's taps share a cache line.
+class MyChorusBank
 {
 public:
-    MyDelay()
+    static const int kMaxVoices = 8;
+    static const int kBlockSize = 256;
+    
+    enum Kernel
+    {
+        SCALAR,
+        SSE2,
+        NEON
+    };
+    
+    //fMaxDepth is the largest fDepth that will be passed to renderBlock
+    MyChorusBank(float fMaxDepth)
     {
-        iBufferSize = 2 * 192000;
+        //the LFO swings the delay time between 0 and twice the (offset) depth of the deepest voice
+        fMaxDelayTime = 2 * (fMaxDepth + (kMaxVoices * 0.02));
         
-        pfCircularBuffer = new float[iBufferSize];
-        for (int i = 0; i < iBufferSize; i++)
+        pBuffer = new MyDelayBuffer(MyDelayBuffer::sizeFor(fMaxDelayTime, getSampleRate()), kMaxVoices);
+        pfCircularBuffer = pBuffer->pfData;
+        iBufferSize = pBuffer->iSize;
+        iBufferMask = pBuffer->iMask;
+        
+        iBufferWritePos = 0;
+        
+        for (int i = 0; i < kMaxVoices; i++)
         {
-            pfCircularBuffer[i] = 0;
+            puPhasePos[i] = 0;
+            pfDelTime[i] = 0;
+            pfRandPrev[i] = 0;
+            pfRandNext[i] = 0;
+            puRandSeed[i] = 0x9E3779B9u * (i + 1);
         }
+        fBlockRate = fBlockDepth = fBlockSampleRate = -1;
         
-        iBufferWritePos = 0;
+        iShape = MyOscillator::TRIANGLE;
+        fFilterA = 0.0005;
+        fFilterB = 1 - fFilterA;
         
-        delayTimeFilter.initialise(0.0005);
+        setKernel(bestKernel());
     }
-    ~MyDelay()
+    ~MyChorusBank()
     {
-        delete [] pfCircularBuffer;
+        delete pBuffer;
     }
     
-    //find delayed read position in buffer
-    int TapPos(float fDelTime)
+    //re-size the delay lines for a new sample rate (call from the host thread; the audio
+    //thread switches over at its next renderBlock, starting from silence)
+    void setSampleRate(float fSampleRate)
     {
-        float fBufferReadPos = iBufferWritePos - (delayTimeFilter.process(fDelTime) * getSampleRate());
-        
-        if (fBufferReadPos < 0)
-        {
-            fBufferReadPos += iBufferSize;
-        }
-        
-        return fBufferReadPos;
+        bufferExchange.publish(new MyDelayBuffer(MyDelayBuffer::sizeFor(fMaxDelayTime, fSampleRate), kMaxVoices));
     }
     
-    //smooth buffer values
-    float InterpolatedRead(float fBufferReadPos)
+    //fastest kernel for the instruction set the plugin is compiled for, chosen at compile time: SSE2 is
+    //part of every x86-64 target and NEON of every ARM64 one, so no runtime CPU check is needed. There
+    //is no AVX2 kernel: an 8-lane kernel would only help above four voices, and the Voices menu stops
+    //at four, so SSE2 already renders every voice in one pass
+    static Kernel bestKernel()
     {
-        int iPos1, iPos2;
-        float fPdiff, fVdiff, fResult;
-        
-        iPos1 = (int)fBufferReadPos;
-        iPos2 = iPos1 + 1;
-        if(iPos2 == iBufferSize)
-            iPos2 = 0;
-
-        fPdiff = fBufferReadPos - iPos1;
-        fVdiff = pfCircularBuffer[iPos2] - pfCircularBuffer[iPos1];
-        fResult = pfCircularBuffer[iPos1] + (fVdiff * fPdiff);
-
-        return fResult;
+#if defined(MYEFFECT_SSE2)
+        return SSE2;
+#elif defined(MYEFFECT_NEON)
+        return NEON;
+#else
+        return SCALAR;
+#endif
     }
     
-    //returns delayed signal without feedback
-    float processSimple(float fIn, float fDelTime, float fDelGain)
+    //select a kernel by hand (e.g. SCALAR for reference renders); unsupported kernels are ignored
+    void setKernel(Kernel kernel)
     {
-        pfCircularBuffer[iBufferWritePos] = fIn;
-        iBufferWritePos++;
-        if (iBufferWritePos > iBufferSize - 1)
+        switch (kernel)
         {
-            iBufferWritePos = 0;
+#if defined(MYEFFECT_SSE2)
+            case SSE2: iKernel = kernel; break;
+#endif
+#if defined(MYEFFECT_NEON)
+            case NEON: iKernel = kernel; break;
+#endif
+            default: iKernel = SCALAR; break;
         }
-        
-        return InterpolatedRead(TapPos(fDelTime)) * fDelGain;
     }
     
-    //returns delayed signal with feedback
-    float processFeedback(float fFBDelTime, float fFBGain)
+    Kernel getKernel() const { return iKernel; }
+    
+    //LFO shape of every voice (MyOscillator::TRIANGLE, SINE or RANDOM)
+    void setShape(int iShape)
+    {
+        this->iShape = iShape;
+    }
+    
+    //render the LFOs, smoothed delay times and buffer positions of the first iVoiceNum
+    //voices for up to kBlockSize samples, then read / feed back with tap() and feedback()
+    void renderBlock(float fRate, float fDepth, int iVoiceNum, int numSamples)
     {
-        int iBufferReadPos;
+        LaneState savedState[kMaxVoices];
+        
+        //switch to a buffer queued by setSampleRate, if there is one
+        MyDelayBuffer *pNewBuffer = bufferExchange.update(pBuffer);
+        if (pNewBuffer != pBuffer)
+        {
+            pBuffer = pNewBuffer;
+            pfCircularBuffer = pBuffer->pfData;
+            iBufferSize = pBuffer->iSize;
+            iBufferMask = pBuffer->iMask;
+            iBufferWritePos &= iBufferMask;
+        }
         
-        iBufferWritePos++;
-        if(iBufferWritePos == iBufferSize)
-            iBufferWritePos = 0;
+        //per-voice rate / depth offsets and phase increments only change once per block
+        if (fRate != fBlockRate || fDepth != fBlockDepth || getSampleRate() != fBlockSampleRate)
+        {
+            fBlockRate = fRate;
+            fBlockDepth = fDepth;
+            fBlockSampleRate = getSampleRate();
+            
+            for (int i = 0; i < kMaxVoices; i++)
+            {
+                float fVoiceRate = fRate + ((i + 1) * 0.02);
+                pfVoiceDepth[i] = fDepth + ((i + 1) * 0.02);
+                puPhaseInc[i] = MyOscillator::phaseIncrement(fVoiceRate, fBlockSampleRate);
+            }
+        }
         
-        iBufferReadPos = iBufferWritePos - (delayTimeFilter.process(fFBDelTime) * getSampleRate());
-        if(iBufferReadPos < 0)
-            iBufferReadPos += iBufferSize;
+        for (int i = iVoiceNum; i < kMaxVoices; i++)
+            saveLane(i, savedState[i]);
         
-        return pfCircularBuffer[iBufferReadPos] * fFBGain;
+        for (int n = 0; n < numSamples; n++)
+        {
+            iBufferWritePos = (iBufferWritePos + 1) & iBufferMask;
+            piWritePos[n] = iBufferWritePos * kMaxVoices;
+        }
+        
+        switch (iShape)
+        {
+            case MyOscillator::SINE: render<MyOscillator::SINE>(iVoiceNum, numSamples); break;
+            case MyOscillator::RANDOM: render<MyOscillator::RANDOM>(iVoiceNum, numSamples); break;
+            default: render<MyOscillator::TRIANGLE>(iVoiceNum, numSamples); break;
+        }
+        
+        //voices that are switched off keep their state, as if they were never processed
+        for (int i = iVoiceNum; i < kMaxVoices; i++)
+            restoreLane(i, savedState[i]);
     }
     
-    //creates feedback loop
-    void feedback(float output)
+    //delayed signal of voice i at sample n of the rendered block
+    float tap(int n, int i) const
     {
-        pfCircularBuffer[iBufferWritePos] = output;
+        return pfCircularBuffer[piReadPos[n * kMaxVoices + i]];
+    }
+    
+    //feed the output back into voice i's delay line at sample n of the rendered block
+    //(flushing tiny values, so a decaying tail can't turn into slow denormals)
+    void feedback(int n, int i, float output)
+    {
+        pfCircularBuffer[piWritePos[n] + i] = stk::undenormalize(output);
     }
     
 private:
-    float *pfCircularBuffer;
-    int iBufferSize, iBufferWritePos;
-    MyFilter delayTimeFilter;
-};
-
-class MyVoice
-{
-public:
-    MyVoice()
+    struct LaneState
     {
-        fVoiceGain = 0;
-        fDelTime = 0;
-        fDelSig = 0;
+        float fDelTime, fRandPrev, fRandNext;
+        unsigned int uPhasePos, uRandSeed;
+    };
+    
+    void saveLane(int i, LaneState& state) const
+    {
+        state.uPhasePos = puPhasePos[i];
+        state.fDelTime = pfDelTime[i];
+        state.fRandPrev = pfRandPrev[i];
+        state.fRandNext = pfRandNext[i];
+        state.uRandSeed = puRandSeed[i];
     }
-
-    void voiceInit(float fRate, float fDepth, int i)
+    
+    void restoreLane(int i, const LaneState& state)
+    {
+        puPhasePos[i] = state.uPhasePos;
+        pfDelTime[i] = state.fDelTime;
+        pfRandPrev[i] = state.fRandPrev;
+        pfRandNext[i] = state.fRandNext;
+        puRandSeed[i] = state.uRandSeed;
+    }
+    
+    template <int iShape>
+    void render(int iVoiceNum, int numSamples)
     {
-        //offset oscillator depending on voice number (i)
-        fRate += ((i + 1) * 0.02);
-        fDepth += ((i + 1) * 0.02);
+        switch (iKernel)
+        {
+#if defined(MYEFFECT_SSE2)
+            case SSE2: renderSSE2<iShape>(iVoiceNum, numSamples); break;
+#endif
+#if defined(MYEFFECT_NEON)
+            case NEON: renderNEON<iShape>(iVoiceNum, numSamples); break;
+#endif
+            default: renderScalar<iShape>(iVoiceNum, numSamples); break;
+        }
+    }
+    
+    //reference implementation, using the same single precision arithmetic (in the same order)
+    //as the SIMD kernels below, so every kernel renders identical read positions
+    template <int iShape>
+    void renderScalar(int iVoiceNum, int numSamples)
+    {
+        const float fSampleRate = getSampleRate();
         
-        fDelTime = voiceOsc.generate(fRate, fDepth);
+        for (int n = 0; n < numSamples; n++)
+        {
+            const int iWritePos = piWritePos[n] / kMaxVoices;
+            
+            for (int i = 0; i < iVoiceNum; i++)
+            {
+                float fMod;
+                
+                puPhasePos[i] += puPhaseInc[i];
+                
+                if (iShape == MyOscillator::RANDOM)
+                {
+                    if (puPhasePos[i] < puPhaseInc[i]) // wrapped
+                    {
+                        puRandSeed[i] = MyOscillator::nextRandom(puRandSeed[i]);
+                        pfRandPrev[i] = pfRandNext[i];
+                        pfRandNext[i] = MyOscillator::randomValue(puRandSeed[i]);
+                    }
+                    fMod = MyOscillator::smoothRandom(pfRandPrev[i], pfRandNext[i], puPhasePos[i]);
+                }
+                else if (iShape == MyOscillator::SINE)
+                    fMod = MyOscillator::sine(MyOscillator::triangle(puPhasePos[i]));
+                else
+                    fMod = MyOscillator::triangle(puPhasePos[i]);
+                
+                pfDelTime[i] = (fFilterA * (fMod * pfVoiceDepth[i] + pfVoiceDepth[i])) + (fFilterB * pfDelTime[i]);
+                
+                float fBufferReadPos = iWritePos - (pfDelTime[i] * fSampleRate);
+                int iBufferReadPos = (int)fBufferReadPos;
+                if (iBufferReadPos > fBufferReadPos)
+                    iBufferReadPos--;
+                iBufferReadPos &= iBufferMask;
+                
+                piReadPos[n * kMaxVoices + i] = iBufferReadPos * kMaxVoices + i;
+            }
+        }
     }
-
-    float process()
+    
+#if defined(MYEFFECT_SSE2)
+    template <int iShape>
+    void renderSSE2(int iVoiceNum, int numSamples)
     {
-        fDelSig = voiceDelay.processFeedback(fDelTime, 1);
-        return fDelSig;
+        const __m128i uSignBit = _mm_set1_epi32(0x80000000);
+        const __m128 fInvPhaseHalf = _mm_set1_ps(MyOscillator::kInvPhaseHalf);
+        const __m128 fHalf = _mm_set1_ps(0.5f), fOne = _mm_set1_ps(1.f), fTwo = _mm_set1_ps(2.f), fThree = _mm_set1_ps(3.f);
+        const __m128 fAbsMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        const __m128 fSine1 = _mm_set1_ps(MyOscillator::kSine1), fSine3 = _mm_set1_ps(MyOscillator::kSine3);
+        const __m128 fSine5 = _mm_set1_ps(MyOscillator::kSine5), fSine7 = _mm_set1_ps(MyOscillator::kSine7);
+        const __m128 fA = _mm_set1_ps(fFilterA), fB = _mm_set1_ps(fFilterB);
+        const __m128 fSampleRate = _mm_set1_ps(getSampleRate());
+        const __m128i iMask = _mm_set1_epi32(iBufferMask);
+        
+        for (int v = 0; v < iVoiceNum; v += 4)
+        {
+            __m128i uPhase = _mm_loadu_si128((const __m128i*)(puPhasePos + v));
+            __m128 fDelay = _mm_loadu_ps(pfDelTime + v);
+            __m128 fRandPrev = _mm_loadu_ps(pfRandPrev + v), fRandNext = _mm_loadu_ps(pfRandNext + v);
+            __m128i uSeed = _mm_loadu_si128((const __m128i*)(puRandSeed + v));
+            const __m128i uInc = _mm_loadu_si128((const __m128i*)(puPhaseInc + v));
+            const __m128 fDepth = _mm_loadu_ps(pfVoiceDepth + v);
+            const __m128i iLane = _mm_setr_epi32(v, v + 1, v + 2, v + 3);
+            
+            for (int n = 0; n < numSamples; n++)
+            {
+                __m128 fMod;
+                
+                uPhase = _mm_add_epi32(uPhase, uInc);
+                const __m128 fBipolar = _mm_mul_ps(_mm_cvtepi32_ps(_mm_xor_si128(uPhase, uSignBit)), fInvPhaseHalf);
+                
+                if (iShape == MyOscillator::RANDOM)
+                {
+                    //lanes whose phase wrapped (unsigned phase < increment) move on to a new random value
+                    const __m128i uWrap = _mm_cmplt_epi32(_mm_xor_si128(uPhase, uSignBit), _mm_xor_si128(uInc, uSignBit));
+                    const __m128 fWrap = _mm_castsi128_ps(uWrap);
+                    __m128i uNext = _mm_xor_si128(uSeed, _mm_slli_epi32(uSeed, 13));
+                    uNext = _mm_xor_si128(uNext, _mm_srli_epi32(uNext, 17));
+                    uNext = _mm_xor_si128(uNext, _mm_slli_epi32(uNext, 5));
+                    uSeed = _mm_or_si128(_mm_and_si128(uWrap, uNext), _mm_andnot_si128(uWrap, uSeed));
+                    
+                    fRandPrev = _mm_or_ps(_mm_and_ps(fWrap, fRandNext), _mm_andnot_ps(fWrap, fRandPrev));
+                    fRandNext = _mm_or_ps(_mm_and_ps(fWrap, _mm_mul_ps(_mm_cvtepi32_ps(uSeed), fInvPhaseHalf)), _mm_andnot_ps(fWrap, fRandNext));
+                    
+                    const __m128 fPos = _mm_add_ps(_mm_mul_ps(fBipolar, fHalf), fHalf);
+                    const __m128 fCurve = _mm_mul_ps(_mm_mul_ps(fPos, fPos), _mm_sub_ps(fThree, _mm_mul_ps(fTwo, fPos)));
+                    fMod = _mm_add_ps(fRandPrev, _mm_mul_ps(_mm_sub_ps(fRandNext, fRandPrev), fCurve));
+                }
+                else
+                {
+                    fMod = _mm_sub_ps(fOne, _mm_and_ps(_mm_mul_ps(fBipolar, fTwo), fAbsMask));
+                    
+                    if (iShape == MyOscillator::SINE)
+                    {
+                        const __m128 fSquare = _mm_mul_ps(fMod, fMod);
+                        __m128 fPoly = _mm_add_ps(fSine5, _mm_mul_ps(fSquare, fSine7));
+                        fPoly = _mm_add_ps(fSine3, _mm_mul_ps(fSquare, fPoly));
+                        fPoly = _mm_add_ps(fSine1, _mm_mul_ps(fSquare, fPoly));
+                        fMod = _mm_mul_ps(fMod, fPoly);
+                    }
+                }
+                
+                const __m128 fTarget = _mm_add_ps(_mm_mul_ps(fMod, fDepth), fDepth);
+                fDelay = _mm_add_ps(_mm_mul_ps(fA, fTarget), _mm_mul_ps(fB, fDelay));
+                
+                const __m128 fWritePos = _mm_set1_ps((float)(piWritePos[n] / kMaxVoices));
+                const __m128 fReadPos = _mm_sub_ps(fWritePos, _mm_mul_ps(fDelay, fSampleRate));
+                __m128i iPos = _mm_cvttps_epi32(fReadPos);
+                iPos = _mm_add_epi32(iPos, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(iPos), fReadPos))); // round down
+                iPos = _mm_and_si128(iPos, iMask);
+                iPos = _mm_add_epi32(_mm_slli_epi32(iPos, kLaneShift), iLane);
+                
+                _mm_storeu_si128((__m128i*)(piReadPos + n * kMaxVoices + v), iPos);
+            }
+            
+            _mm_storeu_si128((__m128i*)(puPhasePos + v), uPhase);
+            _mm_storeu_ps(pfDelTime + v, fDelay);
+            _mm_storeu_ps(pfRandPrev + v, fRandPrev);
+            _mm_storeu_ps(pfRandNext + v, fRandNext);
+            _mm_storeu_si128((__m128i*)(puRandSeed + v), uSeed);
+        }
     }
-
-    void voiceFB(float fOut)
+#endif
+    
+#if defined(MYEFFECT_NEON)
+    template <int iShape>
+    void renderNEON(int iVoiceNum, int numSamples)
     {
-        voiceDelay.feedback(fOut);
+        const uint32x4_t uSignBit = vdupq_n_u32(0x80000000u);
+        const float32x4_t fInvPhaseHalf = vdupq_n_f32(MyOscillator::kInvPhaseHalf);
+        const float32x4_t fHalf = vdupq_n_f32(0.5f), fOne = vdupq_n_f32(1.f), fTwo = vdupq_n_f32(2.f), fThree = vdupq_n_f32(3.f);
+        const float32x4_t fSine1 = vdupq_n_f32(MyOscillator::kSine1), fSine3 = vdupq_n_f32(MyOscillator::kSine3);
+        const float32x4_t fSine5 = vdupq_n_f32(MyOscillator::kSine5), fSine7 = vdupq_n_f32(MyOscillator::kSine7);
+        const float32x4_t fA = vdupq_n_f32(fFilterA), fB = vdupq_n_f32(fFilterB);
+        const float32x4_t fSampleRate = vdupq_n_f32(getSampleRate());
+        const int32x4_t iMask = vdupq_n_s32(iBufferMask);
+        
+        for (int v = 0; v < iVoiceNum; v += 4)
+        {
+            uint32x4_t uPhase = vld1q_u32(puPhasePos + v);
+            float32x4_t fDelay = vld1q_f32(pfDelTime + v);
+            float32x4_t fRandPrev = vld1q_f32(pfRandPrev + v), fRandNext = vld1q_f32(pfRandNext + v);
+            uint32x4_t uSeed = vld1q_u32(puRandSeed + v);
+            const uint32x4_t uInc = vld1q_u32(puPhaseInc + v);
+            const float32x4_t fDepth = vld1q_f32(pfVoiceDepth + v);
+            const int32_t piLanes[4] = { v, v + 1, v + 2, v + 3 };
+            const int32x4_t iLane = vld1q_s32(piLanes);
+            
+            for (int n = 0; n < numSamples; n++)
+            {
+                float32x4_t fMod;
+                
+                uPhase = vaddq_u32(uPhase, uInc);
+                const float32x4_t fBipolar = vmulq_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(veorq_u32(uPhase, uSignBit))), fInvPhaseHalf);
+                
+                if (iShape == MyOscillator::RANDOM)
+                {
+                    const uint32x4_t uWrap = vcltq_u32(uPhase, uInc);
+                    uint32x4_t uNext = veorq_u32(uSeed, vshlq_n_u32(uSeed, 13));
+                    uNext = veorq_u32(uNext, vshrq_n_u32(uNext, 17));
+                    uNext = veorq_u32(uNext, vshlq_n_u32(uNext, 5));
+                    uSeed = vbslq_u32(uWrap, uNext, uSeed);
+                    
+                    fRandPrev = vbslq_f32(uWrap, fRandNext, fRandPrev);
+                    fRandNext = vbslq_f32(uWrap, vmulq_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(uSeed)), fInvPhaseHalf), fRandNext);
+                    
+                    const float32x4_t fPos = vaddq_f32(vmulq_f32(fBipolar, fHalf), fHalf);
+                    const float32x4_t fCurve = vmulq_f32(vmulq_f32(fPos, fPos), vsubq_f32(fThree, vmulq_f32(fTwo, fPos)));
+                    fMod = vaddq_f32(fRandPrev, vmulq_f32(vsubq_f32(fRandNext, fRandPrev), fCurve));
+                }
+                else
+                {
+                    fMod = vsubq_f32(fOne, vabsq_f32(vmulq_f32(fBipolar, fTwo)));
+                    
+                    if (iShape == MyOscillator::SINE)
+                    {
+                        const float32x4_t fSquare = vmulq_f32(fMod, fMod);
+                        float32x4_t fPoly = vaddq_f32(fSine5, vmulq_f32(fSquare, fSine7));
+                        fPoly = vaddq_f32(fSine3, vmulq_f32(fSquare, fPoly));
+                        fPoly = vaddq_f32(fSine1, vmulq_f32(fSquare, fPoly));
+                        fMod = vmulq_f32(fMod, fPoly);
+                    }
+                }
+                
+                const float32x4_t fTarget = vaddq_f32(vmulq_f32(fMod, fDepth), fDepth);
+                fDelay = vaddq_f32(vmulq_f32(fA, fTarget), vmulq_f32(fB, fDelay));
+                
+                const float32x4_t fWritePos = vdupq_n_f32((float)(piWritePos[n] / kMaxVoices));
+                const float32x4_t fReadPos = vsubq_f32(fWritePos, vmulq_f32(fDelay, fSampleRate));
+                int32x4_t iPos = vcvtq_s32_f32(fReadPos);
+                iPos = vaddq_s32(iPos, vreinterpretq_s32_u32(vcgtq_f32(vcvtq_f32_s32(iPos), fReadPos))); // round down
+                iPos = vandq_s32(iPos, iMask);
+                iPos = vaddq_s32(vshlq_n_s32(iPos, kLaneShift), iLane);
+                
+                vst1q_s32(piReadPos + n * kMaxVoices + v, iPos);
+            }
+            
+            vst1q_u32(puPhasePos + v, uPhase);
+            vst1q_f32(pfDelTime + v, fDelay);
+            vst1q_f32(pfRandPrev + v, fRandPrev);
+            vst1q_f32(pfRandNext + v, fRandNext);
+            vst1q_u32(puRandSeed + v, uSeed);
+        }
     }
-
-private:
-    float fVoiceGain, fDelTime, fDelSig;
-    MyOscillator voiceOsc;
-    MyDelay voiceDelay;
+#endif
+    
+    static const int kLaneShift = 3; // log2(kMaxVoices)
+    Kernel iKernel;
+    int iShape;
+    
+    float fMaxDelayTime;
+    MyDelayBuffer *pBuffer;
+    MyDelayBufferExchange bufferExchange;
+    
+    float *pfCircularBuffer;
+    int iBufferSize, iBufferMask, iBufferWritePos;
+    
+    //per-voice state (one lane each)
+    unsigned int puPhasePos[kMaxVoices], puPhaseInc[kMaxVoices];
+    float pfDelTime[kMaxVoices], pfVoiceDepth[kMaxVoices];
+    float pfRandPrev[kMaxVoices], pfRandNext[kMaxVoices];
+    unsigned int puRandSeed[kMaxVoices];
+    float fBlockRate, fBlockDepth, fBlockSampleRate;
+    float fFilterA, fFilterB;
+    
+    //rendered block: interleaved buffer indices to read / write at each sample
+    int piReadPos[kBlockSize * kMaxVoices];
+    int piWritePos[kBlockSize];
 };
-
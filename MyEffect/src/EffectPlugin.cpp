@@ -34,7 +34,8 @@ extern "C" {
             {   "Stereo",  Parameter::TOGGLE, 0.0, 1.0, 1.0, Parameter::Bounds(175, 18, 50, 40)  },
             {   "Dry/Wet",  Parameter::ROTARY, 0.0, 1.0, 0.0, AUTO_SIZE  },
             {   "Output Gain",  Parameter::ROTARY, 0.0, 1.0, 0.5, AUTO_SIZE  },
-            {   "Voices",  Parameter::MENU, {"One", "Two", "Three", "Four"}, {170, 90, 60, 20}  }
+            {   "Voices",  Parameter::MENU, {"One", "Two", "Three", "Four"}, {170, 90, 60, 20}  },
+            {   "Shape",  Parameter::MENU, {"Triangle", "Sine", "Random"}, {170, 120, 60, 20}  }
         };
 
         const Presets PRESETS = {
@@ -49,9 +50,13 @@ extern "C" {
 
 // Constructor: called when the effect is first created / loaded
 MyEffect::MyEffect(const Parameters& parameters, const Presets& presets)
-: Effect(parameters, presets)
+: Effect(parameters, presets), chorus(0.03 + 0.02) // largest fDepth the Intensity curve in process() produces
 {
-    
+    // Glide between control values instead of jumping at block boundaries
+    smoothed.setSmoothing(0, SmoothedParameters::LINEAR, 0.05);   // Rate
+    smoothed.setSmoothing(1, SmoothedParameters::LINEAR, 0.05);   // Intensity
+    smoothed.setSmoothing(3, SmoothedParameters::LINEAR, 0.02);   // Dry/Wet
+    smoothed.setSmoothing(4, SmoothedParameters::LINEAR, 0.02);   // Output Gain
 }
 
 // Destructor: called when the effect is terminated / unloaded
@@ -82,72 +87,127 @@ void MyEffect::buttonPressed(int iButton)
 // (inputBuffer contains the input audio, and processed samples should be stored in outputBuffer)
 void MyEffect::process(const float** inputBuffers, float** outputBuffers, int numSamples)
 {
-    float fIn0, fIn1, fOut0 = 0, fOut1 = 0;
+    // Flush denormals to zero while processing (restored when process() returns)
+    ScopedNoDenormals noDenormals;
+    
+    // Trap allocation, file access and locking while processing (APDI_REALTIME_AUDIT builds only)
+    ScopedRealtimeAudit realtimeAudit;
+    
     const float *pfInBuffer0 = inputBuffers[0], *pfInBuffer1 = inputBuffers[1];
     float *pfOutBuffer0 = outputBuffers[0], *pfOutBuffer1 = outputBuffers[1];
     
-    // Slider values
-    float fRate = (parameters[0] * parameters[0] * parameters[0] * 0.09) + 0.01;
-    float fDepth = (parameters[1] * parameters[1] * parameters[1] * 0.03)  + 0.02;
-    float fStereoToggle = parameters[2];
-    float fDWGain = parameters[3] * 0.5;
-    float fOutGain = parameters[4];
-    int iVoiceNum = parameters[5] + 1;
+    float pfDWGain[MyChorusBank::kBlockSize], pfOutGain[MyChorusBank::kBlockSize];
+    
+    // Take this block's snapshot of the controls
+    updateParameters();
+    float fStereoToggle = smoothed[2];
+    int iVoiceNum = smoothed[5] + 1;
+    
+    if (parameterChanged(6))
+        chorus.setShape(smoothed[6]);
+    
+    // Work through the host buffer in blocks the voices can render in one pass
+    while(numSamples > 0)
+    {
+        int iBlockSize = numSamples < MyChorusBank::kBlockSize ? numSamples : MyChorusBank::kBlockSize;
+        
+        // Slider values (rate and depth move once per block, the gains ramp every sample)
+        float fRateParam = smoothed.advance(0, iBlockSize);
+        float fDepthParam = smoothed.advance(1, iBlockSize);
+        float fRate = (fRateParam * fRateParam * fRateParam * 0.09) + 0.01;
+        float fDepth = (fDepthParam * fDepthParam * fDepthParam * 0.03)  + 0.02;
+        
+        smoothed.render(3, pfDWGain, iBlockSize);
+        smoothed.render(4, pfOutGain, iBlockSize);
+        for (int n = 0; n < iBlockSize; n++)
+            pfDWGain[n] *= 0.5;
+        
+        chorus.renderBlock(fRate, fDepth, iVoiceNum, iBlockSize);
+        
+        //distributes delayed signals between L and R if "stereo" button is pressed
+        if (!fStereoToggle)
+            processStereo(pfInBuffer0, pfInBuffer1, pfOutBuffer0, pfOutBuffer1, iBlockSize, iVoiceNum, pfDWGain, pfOutGain);
+        else //default to mono
+            processMono(pfInBuffer0, pfInBuffer1, pfOutBuffer0, pfOutBuffer1, iBlockSize, iVoiceNum, pfDWGain, pfOutGain);
+        
+        pfInBuffer0 += iBlockSize;
+        pfInBuffer1 += iBlockSize;
+        pfOutBuffer0 += iBlockSize;
+        pfOutBuffer1 += iBlockSize;
+        numSamples -= iBlockSize;
+    }
+}
 
-    while(numSamples--)
+// Mixes a rendered block with even voices on the left and odd voices on the right,
+// each side with its own feedback loop
+void MyEffect::processStereo(const float* pfInBuffer0, const float* pfInBuffer1, float* pfOutBuffer0, float* pfOutBuffer1,
+                             int numSamples, int iVoiceNum, const float* pfDWGain, const float* pfOutGain)
+{
+    float fIn0, fIn1, fOut0, fOut1;
+    
+    for (int n = 0; n < numSamples; n++)
     {
         // Get sample from input
-        fIn0 = *pfInBuffer0++;
-        fIn1 = *pfInBuffer1++;
+        fIn0 = pfInBuffer0[n];
+        fIn1 = pfInBuffer1[n];
         
-        // Add your effect processing here
         float fDelSig0 = 0;
         float fDelSig1 = 0;
         
         for (int i = 0; i < iVoiceNum; i++)
         {
-            voices[i].voiceInit(fRate, fDepth, i);
-            
-            //distributes delayed signals between L and R if "stereo" button is pressed
-            if (!fStereoToggle)
-            {
-                if (i % 2 == 0)
-                    fDelSig0 += voices[i].process() * stereoVoiceGains[i];
-                else
-                    fDelSig1 += voices[i].process() * stereoVoiceGains[i];
-            }
-            else //default to mono
-                fDelSig0 += voices[i].process() * voiceGains[i];
+            if (i % 2 == 0)
+                fDelSig0 += chorus.tap(n, i) * stereoVoiceGains[i];
+            else
+                fDelSig1 += chorus.tap(n, i) * stereoVoiceGains[i];
         }
         
         //send stereo wet/dry mix to L and R outputs
-        if (!fStereoToggle)
-        {
-            fOut0 = fIn0 + (fDelSig0 * fDWGain);
-            fOut1 = fIn1 + (fDelSig1 * fDWGain);
-        }
-        else //send mono wet/dry mix to L and R outputs
+        fOut0 = fIn0 + (fDelSig0 * pfDWGain[n]);
+        fOut1 = fIn1 + (fDelSig1 * pfDWGain[n]);
+        
+        //separate feedback loops for L and R
+        for (int j = 0; j < iVoiceNum; j++)
         {
-            fOut0 = fIn0 + (fDelSig0 * fDWGain);
-            fOut1 = fIn1 + (fDelSig0 * fDWGain);
+            if (j % 2 == 0)
+                chorus.feedback(n, j, fOut0);
+            else
+                chorus.feedback(n, j, fOut1);
         }
+        
+        // Copy result to output
+        pfOutBuffer0[n] = fOut0 * pfOutGain[n];
+        pfOutBuffer1[n] = fOut1 * pfOutGain[n];
+    }
+}
 
+// Mixes a rendered block with all voices summed to both outputs and a single feedback loop
+void MyEffect::processMono(const float* pfInBuffer0, const float* pfInBuffer1, float* pfOutBuffer0, float* pfOutBuffer1,
+                           int numSamples, int iVoiceNum, const float* pfDWGain, const float* pfOutGain)
+{
+    float fIn0, fIn1, fOut0, fOut1;
+    
+    for (int n = 0; n < numSamples; n++)
+    {
+        // Get sample from input
+        fIn0 = pfInBuffer0[n];
+        fIn1 = pfInBuffer1[n];
+        
+        float fDelSig0 = 0;
+        
+        for (int i = 0; i < iVoiceNum; i++)
+            fDelSig0 += chorus.tap(n, i) * voiceGains[i];
+        
+        //send mono wet/dry mix to L and R outputs
+        fOut0 = fIn0 + (fDelSig0 * pfDWGain[n]);
+        fOut1 = fIn1 + (fDelSig0 * pfDWGain[n]);
+        
+        //single mono feedback loop
         for (int j = 0; j < iVoiceNum; j++)
-        {
-            //separate feedback loops for L and R
-            if (!fStereoToggle)
-            {
-                if (j % 2 == 0)
-                    voices[j].voiceFB(fOut0);
-                else
-                    voices[j].voiceFB(fOut1);
-            }
-            else //single mono feedback loop
-                voices[j].voiceFB((fOut0 + fOut1) * 0.5);
-        }
-     
+            chorus.feedback(n, j, (fOut0 + fOut1) * 0.5);
+        
         // Copy result to output
-        *pfOutBuffer0++ = fOut0 * fOutGain; 
-        *pfOutBuffer1++ = fOut1 * fOutGain;
+        pfOutBuffer0[n] = fOut0 * pfOutGain[n];
+        pfOutBuffer1[n] = fOut1 * pfOutGain[n];
     }
 }
@@ -19,7 +19,7 @@ public:
     MyEffect(const Parameters& parameters, const Presets& presets); // constructor (initialise variables, etc.)
     ~MyEffect();                                                    // destructor (clean up, free memory, etc.)
 
-    void setSampleRate(float sampleRate){ stk::Stk::setSampleRate(sampleRate); }
+    void setSampleRate(float sampleRate){ stk::Stk::setSampleRate(sampleRate); chorus.setSampleRate(sampleRate); }
     float getSampleRate() const { return stk::Stk::sampleRate(); };
     
     void process(const float** inputBuffers, float** outputBuffers, int numSamples);
@@ -29,8 +29,13 @@ public:
     void buttonPressed(int iButton);
 
 private:
+    void processStereo(const float* pfInBuffer0, const float* pfInBuffer1, float* pfOutBuffer0, float* pfOutBuffer1,
+                       int numSamples, int iVoiceNum, const float* pfDWGain, const float* pfOutGain);
+    void processMono(const float* pfInBuffer0, const float* pfInBuffer1, float* pfOutBuffer0, float* pfOutBuffer1,
+                     int numSamples, int iVoiceNum, const float* pfDWGain, const float* pfOutGain);
+    
     // Declare shared member variables here
-    MyVoice voices[4];
+    MyChorusBank chorus;
     float voiceGains[4] = {0.5, 0.25, 0.125, 0.0625};
     float stereoVoiceGains[4] = {0.3, 0.3, 0.15, 0.15};
 };
@@ -0,0 +1,148 @@
+//
+//  FileStreamTest.cpp
+//  Tests for streamed playback (stk::FileStream, through FileWvIn and FileLoop)
+//
+//  Writes a test file, then plays it through FileWvIn and FileLoop in streaming mode and checks that
+//  every tick() matches the same file played from memory: forwards, backwards, at a fractional rate
+//  and looped. Playback is paced at a few times real time, as the I/O thread would see it in use.
+//  Also checks that a jump to a part of the file that isn't loaded (a cold seek) counts an underrun
+//  and outputs silence, and that playback then picks up again.
+//
+//  Build and run (from the MyEffect folder):
+//    cmake -S test -B build/test && cmake --build build/test && ctest --test-dir build/test
+//
+
+#include "stk/FileLoop.h"
+#include "stk/FileWvIn.h"
+#include "stk/FileWvOut.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+static const char* testFile = "FileStreamTest.wav";
+static const unsigned long fileFrames = 200000;
+static const unsigned long chunkSize = 4096;
+static const int blockSize = 256;
+
+static bool passed = true;
+
+static bool check(bool condition, const char* name, const char* detail)
+{
+    printf("%s  %s%s%s\n", condition ? "ok     " : "FAILED ", name, condition ? "" : ": ", condition ? "" : detail);
+    passed &= condition;
+    return condition;
+}
+
+// A mono 16-bit test file of a few tones, different at every frame
+static void writeTestFile()
+{
+    stk::FileWvOut output(testFile, 1, stk::FileWrite::FILE_WAV, stk::Stk::STK_SINT16);
+    for(unsigned long n = 0; n < fileFrames; n++)
+        output.tick(0.4 * sin(n * 0.01) + 0.3 * sin(n * 0.173) + 0.2 * sin(n * 1.31));
+}
+
+static void pause(int microseconds)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(microseconds));
+}
+
+// Plays frames through the streamed and the in-memory reader side by side, a block at a time,
+// returning the largest difference (or -1 if the streamed reader underran)
+template<class Reader>
+static double compare(Reader& streamed, Reader& reference, unsigned long frames, int pauseMicroseconds)
+{
+    double error = 0.0;
+    const unsigned long underruns = streamed.getUnderruns();
+    for(unsigned long n = 0; n < frames; n++){
+        if(n % blockSize == 0)
+            pause(pauseMicroseconds);
+        error = std::max(error, (double)fabs(streamed.tick() - reference.tick()));
+    }
+    return streamed.getUnderruns() == underruns ? error : -1.0;
+}
+
+static void report(const char* name, double error, double tolerance)
+{
+    char detail[128];
+    if(error < 0.0)
+        snprintf(detail, sizeof(detail), "streaming underran");
+    else
+        snprintf(detail, sizeof(detail), "largest difference %g", error);
+    check(error >= 0.0 && error <= tolerance, name, detail);
+}
+
+// Opens a streamed and an in-memory reader of the test file
+template<class Reader>
+static void openPair(Reader& streamed, Reader& reference, unsigned int nChunks)
+{
+    streamed.setStreaming(true, nChunks);
+    streamed.openFile(testFile, false, false);
+    reference.openFile(testFile, false, false);
+}
+
+static void testWvIn(const char* name, double rate, unsigned int nChunks, unsigned long frames, int pauseMicroseconds, double tolerance)
+{
+    stk::FileWvIn streamed(1000, chunkSize), reference;
+    openPair(streamed, reference, nChunks);
+    streamed.setRate(rate);
+    reference.setRate(rate);
+    report(name, compare(streamed, reference, frames, pauseMicroseconds), tolerance);
+}
+
+static void testLoop(const char* name, double rate)
+{
+    stk::FileLoop streamed(1000, chunkSize), reference;
+    openPair(streamed, reference, 8);
+    streamed.setRate(rate);
+    reference.setRate(rate);
+    report(name, compare(streamed, reference, fileFrames * 5 / 2, 200), 0.0);
+}
+
+static void testColdSeek()
+{
+    stk::FileWvIn streamed(1000, chunkSize), reference;
+    openPair(streamed, reference, 8);
+    compare(streamed, reference, 1000, 200);
+
+    // jump well past the chunks loaded so far: the streamed reader can't have the data yet
+    streamed.addTime(120000);
+    reference.addTime(120000);
+    const unsigned long underruns = streamed.getUnderruns();
+    const double output = streamed.tick();
+    reference.tick();
+    check(output == 0.0, "cold seek outputs silence", "non-zero output while underrunning");
+
+    // the rest of the chunk doesn't count again, whether or not it has loaded by then
+    for(int n = 0; n < 16; n++){
+        streamed.tick();
+        reference.tick();
+    }
+    check(streamed.getUnderruns() == underruns + 1, "cold seek counts one underrun", "underrun count not incremented once");
+
+    // once the I/O thread has caught up, playback continues from the new position
+    pause(50000);
+    report("playback resumes after cold seek", compare(streamed, reference, 20000, 200), 0.0);
+}
+
+int main()
+{
+    stk::Stk::setSampleRate(44100);
+    stk::Stk::showWarnings(false);
+    writeTestFile();
+
+    testWvIn("FileWvIn/forward", 1.0, 8, fileFrames, 200, 0.0);
+    testWvIn("FileWvIn/reverse", -1.0, 8, fileFrames, 200, 0.0);
+    testWvIn("FileWvIn/rate:0.75", 0.75, 8, fileFrames * 4 / 3 - 2, 200, 1e-5);
+    // with two slots only chunk 0 is loaded ahead of playback, so chunk 1 arrives in time only if
+    // the first acquire() sets the I/O thread reading ahead
+    testWvIn("FileWvIn/first acquire reads ahead", 1.0, 2, chunkSize * 3, 1000, 0.0);
+    testLoop("FileLoop/forward", 1.0);
+    testLoop("FileLoop/reverse", -1.0);
+    testColdSeek();
+
+    remove(testFile);
+    printf("%s\n", passed ? "streamed playback matches" : "streamed playback failed");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,201 @@
+//
+//  FileWriteQueueTest.cpp
+//  Tests for background file writing (stk::FileWriteQueue, through FileWvOut in asynchronous mode)
+//
+//  Writes the same audio through FileWvOut with and without asynchronous mode and checks that the
+//  files are byte-identical, including the partly filled buffer written by closeFile(). Then writes
+//  to a FileWriteQueue whose file is a pipe nobody reads yet, so the I/O thread stalls as it would
+//  on a slow disk, and checks that push() drops and counts buffers once the queue is full, and that
+//  every buffer it accepted reaches the file, in order.
+//
+//  Build and run (from the MyEffect folder):
+//    cmake -S test -B build/test && cmake --build build/test && ctest --test-dir build/test
+//
+
+#include "stk/FileWriteQueue.h"
+#include "stk/FileWvOut.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static bool passed = true;
+
+static bool check(bool condition, const char* name, const char* detail)
+{
+    printf("%s  %s%s%s\n", condition ? "ok     " : "FAILED ", name, condition ? "" : ": ", condition ? "" : detail);
+    passed &= condition;
+    return condition;
+}
+
+static void pause(int microseconds)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(microseconds));
+}
+
+static std::vector<unsigned char> readFile(const char* fileName)
+{
+    std::vector<unsigned char> bytes;
+    if(FILE* file = fopen(fileName, "rb")){
+        unsigned char buffer[4096];
+        size_t count;
+        while((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+            bytes.insert(bytes.end(), buffer, buffer + count);
+        fclose(file);
+    }
+    return bytes;
+}
+
+// Writes frames stereo frames of a test signal in blocks of 300 (which don't line up with the
+// 1024-frame output buffer, so the last buffer is partly filled)
+static void writeFile(const char* fileName, bool asynchronous, stk::FileWrite::FILE_TYPE type, stk::Stk::StkFormat format,
+                      unsigned long frames, unsigned long& overruns)
+{
+    const unsigned int blockFrames = 300;
+    stk::FileWvOut output(1024);
+    output.setAsynchronous(asynchronous);
+    output.openFile(fileName, 2, type, format);
+
+    stk::StkFrames block(blockFrames, 2);
+    for(unsigned long n = 0; n < frames; n += blockFrames){
+        if(frames - n < blockFrames)
+            block.resize(frames - n, 2);
+        for(unsigned int i = 0; i < block.frames(); i++){
+            block(i, 0) = 0.9 * sin((n + i) * 0.013);
+            block(i, 1) = 1.2 * sin((n + i) * 0.0071); // beyond full scale, to be saturated
+        }
+        output.tick(block);
+        if(asynchronous)
+            pause(100); // a real-time pace, so nothing is dropped
+    }
+
+    overruns = output.getOverruns();
+    output.closeFile();
+}
+
+static void testSameOutput(const char* name, stk::FileWrite::FILE_TYPE type, stk::Stk::StkFormat format, const char* extension)
+{
+    const std::string syncName = std::string("FileWriteQueueTest-sync") + extension;
+    const std::string asyncName = std::string("FileWriteQueueTest-async") + extension;
+
+    unsigned long overruns = 0;
+    writeFile(syncName.c_str(), false, type, format, 100000, overruns);
+    writeFile(asyncName.c_str(), true, type, format, 100000, overruns);
+
+    const std::vector<unsigned char> sync = readFile(syncName.c_str());
+    const std::vector<unsigned char> async = readFile(asyncName.c_str());
+    char detail[128];
+    if(overruns > 0)
+        snprintf(detail, sizeof(detail), "%lu buffers dropped", overruns);
+    else
+        snprintf(detail, sizeof(detail), "files differ (%zu and %zu bytes)", sync.size(), async.size());
+    check(overruns == 0 && !sync.empty() && sync == async, name, detail);
+
+    remove(syncName.c_str());
+    remove(asyncName.c_str());
+}
+
+#if !defined(_WIN32)
+
+// The 16-bit big-endian sample an STK RAW file holds for s
+static unsigned int rawSample(stk::StkFloat s)
+{
+    return (unsigned short)(short)(s * 32767.0);
+}
+
+static void testOverruns()
+{
+    const char* fifoName = "FileWriteQueueTest.raw";
+    const unsigned int bufferFrames = 4096;
+    remove(fifoName);
+    if(!check(mkfifo(fifoName, 0600) == 0, "overrun: make pipe", "mkfifo failed"))
+        return;
+
+    // Open the reading end first (without waiting for a writer), so FileWrite can open the writing end,
+    // but don't read from it yet: once the pipe is full, the I/O thread waits as if the disk were stuck.
+    const int reader = open(fifoName, O_RDONLY | O_NONBLOCK);
+    stk::FileWrite file(fifoName, 1, stk::FileWrite::FILE_RAW, stk::Stk::STK_SINT16);
+    fcntl(reader, F_SETFL, fcntl(reader, F_GETFL) & ~O_NONBLOCK);
+#if defined(F_SETPIPE_SZ)
+    fcntl(reader, F_SETPIPE_SZ, 4096); // as small as it goes, so it fills after a buffer or two
+#endif
+
+    stk::FileWriteQueue queue;
+    queue.open(&file, bufferFrames, 1, 4);
+
+    // every buffer different, so the order they arrive in can be checked
+    stk::StkFrames buffer(bufferFrames, 1);
+    std::vector<unsigned int> accepted;
+    unsigned long refused = 0;
+    for(unsigned int k = 0; k < 72; k++){
+        for(unsigned int i = 0; i < bufferFrames; i++)
+            buffer[i] = (stk::StkFloat)((int)((k * 37 + i) % 2001) - 1000) / 1024;
+        const bool pushed = queue.push(buffer, bufferFrames);
+        if(pushed)
+            accepted.push_back(k);
+        else
+            refused++;
+
+        // Push the first 64 at a real-time pace, giving the I/O thread time to fill the pipe and stall.
+        // After that the ring stays full, so all the rest are dropped.
+        pause(k < 63 ? 1000 : k == 63 ? 50000 : 0);
+        if(k >= 64 && pushed)
+            check(false, "overrun: full queue drops", "a buffer was accepted while the I/O thread was stalled");
+    }
+
+    char detail[128];
+    snprintf(detail, sizeof(detail), "%lu refused, %lu overruns, %lu frames dropped", refused, queue.getOverruns(), queue.getDroppedFrames());
+    check(refused > 0 && queue.getOverruns() == refused && queue.getDroppedFrames() == refused * bufferFrames,
+          "overrun: drops are counted", detail);
+
+    // Read the pipe to the end, while close() writes everything still queued.
+    std::vector<unsigned char> received;
+    std::thread drain([&]{
+        unsigned char bytes[4096];
+        ssize_t count;
+        while((count = read(reader, bytes, sizeof(bytes))) > 0)
+            received.insert(received.end(), bytes, bytes + count);
+    });
+    queue.close();
+    file.close();
+    drain.join();
+    close(reader);
+    remove(fifoName);
+
+    bool inOrder = received.size() == accepted.size() * bufferFrames * 2;
+    for(size_t b = 0; b < accepted.size() && inOrder; b++){
+        for(unsigned int i = 0; i < bufferFrames && inOrder; i++){
+            const unsigned char* sample = &received[(b * bufferFrames + i) * 2];
+            const stk::StkFloat s = (stk::StkFloat)((int)((accepted[b] * 37 + i) % 2001) - 1000) / 1024;
+            inOrder = ((sample[0] << 8) | sample[1]) == rawSample(s);
+        }
+    }
+    snprintf(detail, sizeof(detail), "%zu bytes received for %zu buffers accepted", received.size(), accepted.size());
+    check(inOrder, "overrun: accepted buffers are all written, in order", detail);
+}
+
+#endif
+
+int main()
+{
+    stk::Stk::setSampleRate(44100);
+    stk::Stk::showWarnings(false);
+
+    testSameOutput("asynchronous output matches/WAV 16-bit", stk::FileWrite::FILE_WAV, stk::Stk::STK_SINT16, ".wav");
+    testSameOutput("asynchronous output matches/AIFF 24-bit", stk::FileWrite::FILE_AIF, stk::Stk::STK_SINT24, ".aif");
+    testSameOutput("asynchronous output matches/WAV float", stk::FileWrite::FILE_WAV, stk::Stk::STK_FLOAT32, ".wav");
+#if !defined(_WIN32)
+    testOverruns();
+#endif
+
+    printf("%s\n", passed ? "asynchronous writing matches" : "asynchronous writing failed");
+    return passed ? 0 : 1;
+}
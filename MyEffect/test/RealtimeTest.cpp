@@ -0,0 +1,253 @@
+//
+//  RealtimeTest.cpp
+//  Real-time safety test for MyEffect and the STK effects used alongside it
+//
+//  Processes audio through MyEffect (every voice count, mix mode and LFO shape, with parameter
+//  changes, odd block sizes and a sample rate change) and through each STK effect, with every block
+//  run under the real-time audit (apdi/RealtimeAudit.h). Any allocation, file open or lock inside a
+//  block is reported with the case it happened in, and the test exits non-zero.
+//
+//  Build and run (from the MyEffect folder):
+//    cmake -S test -B build/test && cmake --build build/test && ctest --test-dir build/test
+//  or by hand:
+//    g++ -std=c++14 -O2 -DAPDI_REALTIME_AUDIT -Iinclude test/RealtimeTest.cpp src/EffectPlugin.cpp include/include.cpp -lpthread -ldl -o RealtimeTest
+//
+
+#include "apdi/Plugin.h"
+#include "stk/Chorus.h"
+#include "stk/ConvRev.h"
+#include "stk/Echo.h"
+#include "stk/FreeVerb.h"
+#include "stk/Iir.h"
+#include "stk/JCRev.h"
+#include "stk/LentPitShift.h"
+#include "stk/NRev.h"
+#include "stk/Noise.h"
+#include "stk/PRCRev.h"
+#include "stk/PitShift.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if !defined(APDI_REALTIME_AUDIT)
+#error "RealtimeTest must be built with -DAPDI_REALTIME_AUDIT"
+#endif
+
+extern "C" CREATE_FUNCTION createEffect(float sampleRate);
+
+// Block sizes a host may pass to process(), in turn
+static const int blockSizes[] = { 256, 1, 64, 1000, 17, 512, 4096 };
+static const int maxBlockSize = 4096;
+
+// Violations in the current case: count, and the first few distinct operations
+static unsigned long caseViolations = 0;
+static const char* caseOperations[8];
+static int caseOperationCount = 0;
+
+static void recordViolation(const char* operation)
+{
+    caseViolations++;
+    for(int i = 0; i < caseOperationCount; i++)
+        if(!strcmp(caseOperations[i], operation))
+            return;
+    if(caseOperationCount < 8)
+        caseOperations[caseOperationCount++] = operation;
+}
+
+static void startCase()
+{
+    caseViolations = 0;
+    caseOperationCount = 0;
+}
+
+// Reports the case, returning true if it made no real-time violations
+static bool endCase(const char* name)
+{
+    if(caseViolations == 0){
+        printf("ok      %s\n", name);
+        return true;
+    }
+
+    printf("FAILED  %s: %lu violations (", name, caseViolations);
+    for(int i = 0; i < caseOperationCount; i++)
+        printf("%s%s", i ? ", " : "", caseOperations[i]);
+    printf(")\n");
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// MyEffect, created through the plugin entry point as a host would
+////////////////////////////////////////////////////////////////////////////
+
+static bool testMyEffect(int voices, bool stereo, int shape)
+{
+    char name[128];
+    snprintf(name, sizeof(name), "MyEffect/voices:%d/%s/shape:%d", voices, stereo ? "stereo" : "mono", shape);
+
+    stk::Stk::setSampleRate(44100);
+    std::unique_ptr<APDI::Effect> effect((APDI::Effect*)createEffect(44100));
+    effect->setSampleRate(44100);
+
+    const std::vector<APDI::Parameter>& parameters = effect->parameters.get();
+    for(int p = 0; p < (int)parameters.size(); p++)
+        effect->setParameter(p, parameters[p].initial);
+    effect->setParameter(2, stereo ? 0 : 1); // Stereo toggle (on = mono mix)
+    effect->setParameter(3, 0.8f);           // Dry/Wet
+    effect->setParameter(5, voices - 1);     // Voices menu
+    effect->setParameter(6, shape);          // Shape menu
+
+    std::vector<float> in0(maxBlockSize), in1(maxBlockSize), out0(maxBlockSize), out1(maxBlockSize);
+    const float* inputs[2] = { in0.data(), in1.data() };
+    float* outputs[2] = { out0.data(), out1.data() };
+    stk::Noise noise(1234);
+
+    startCase();
+    for(int pass = 0; pass < 4; pass++){
+        // the host moves to a new sample rate between blocks half way through
+        if(pass == 2)
+            effect->setSampleRate(96000);
+
+        for(int blockSize : blockSizes){
+            for(int n = 0; n < blockSize; n++){
+                in0[n] = (float)noise.tick() * 0.5f;
+                in1[n] = (float)noise.tick() * 0.5f;
+            }
+            effect->setParameter(0, (float)noise.tick() * 0.5f + 0.5f); // Rate
+            effect->setParameter(1, (float)noise.tick() * 0.5f + 0.5f); // Intensity
+
+            APDI::ScopedRealtimeAudit realtimeAudit;
+            effect->process(inputs, outputs, blockSize);
+        }
+    }
+    return endCase(name);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// STK effects, processing a mono input block into a mono or stereo output block
+////////////////////////////////////////////////////////////////////////////
+
+template<class EffectType>
+static bool testStk(const char* name, EffectType* effect, int outChannels)
+{
+    std::unique_ptr<EffectType> owner(effect);
+
+    // one set of frames per block size, sized before processing as a host would
+    std::vector<stk::StkFrames> inFrames, outFrames;
+    for(int blockSize : blockSizes){
+        inFrames.push_back(stk::StkFrames(blockSize, 1));
+        outFrames.push_back(stk::StkFrames(blockSize, outChannels));
+    }
+    stk::Noise noise(1234);
+
+    startCase();
+    for(int pass = 0; pass < 8; pass++)
+        for(size_t b = 0; b < inFrames.size(); b++){
+            for(unsigned int n = 0; n < inFrames[b].frames(); n++)
+                inFrames[b][n] = noise.tick() * 0.5;
+
+            APDI::ScopedRealtimeAudit realtimeAudit;
+            effect->tick(inFrames[b], outFrames[b]);
+        }
+    return endCase(name);
+}
+
+// An 8th-order filter (four resonant lowpass sections, multiplied out) swept every block
+static bool testIir()
+{
+    std::vector< std::vector<stk::StkFloat> > bCoefficients, aCoefficients;
+    for(int b = 0; b < 64; b++){
+        std::vector<double> bProduct(1, 1.0), aProduct(1, 1.0);
+        for(int s = 0; s < 4; s++){
+            const double w = 2 * M_PI * (500.0 * (s + 1) + 20.0 * b) / stk::Stk::sampleRate();
+            const double alpha = sin(w) / 1.6, a0 = 1 + alpha;
+            const double section[6] = { (1 - cos(w)) / 2 / a0, (1 - cos(w)) / a0, (1 - cos(w)) / 2 / a0, 1.0, -2 * cos(w) / a0, (1 - alpha) / a0 };
+            std::vector<double> bNext(bProduct.size() + 2, 0.0), aNext(aProduct.size() + 2, 0.0);
+            for(size_t j = 0; j < bProduct.size(); j++)
+                for(int k = 0; k < 3; k++){
+                    bNext[j + k] += bProduct[j] * section[k];
+                    aNext[j + k] += aProduct[j] * section[3 + k];
+                }
+            bProduct.swap(bNext);
+            aProduct.swap(aNext);
+        }
+        bCoefficients.push_back(std::vector<stk::StkFloat>(bProduct.begin(), bProduct.end()));
+        aCoefficients.push_back(std::vector<stk::StkFloat>(aProduct.begin(), aProduct.end()));
+    }
+
+    stk::Iir iir(bCoefficients[0], aCoefficients[0]);
+    stk::StkFrames frames(256, 1);
+    stk::Noise noise(1234);
+
+    startCase();
+    for(int b = 0; b < 64; b++){
+        for(unsigned int n = 0; n < frames.frames(); n++)
+            frames[n] = noise.tick() * 0.5;
+
+        APDI::ScopedRealtimeAudit realtimeAudit;
+        iir.setCoefficients(bCoefficients[b], aCoefficients[b]);
+        iir.tick(frames);
+    }
+    return endCase("stk::Iir/sweep");
+}
+
+// A two second stereo impulse response of decaying noise
+static stk::ConvRev* createConvRev(bool workerThread)
+{
+    const unsigned long length = (unsigned long)(2 * stk::Stk::sampleRate());
+    stk::StkFrames impulse(length, 2);
+    stk::Noise noise(4321);
+    for(unsigned long n = 0; n < length; n++){
+        const stk::StkFloat decay = exp(-6.9 * n / length);
+        impulse(n, 0) = noise.tick() * decay;
+        impulse(n, 1) = noise.tick() * decay;
+    }
+
+    stk::ConvRev* convRev = new stk::ConvRev();
+    convRev->setWorkerThread(workerThread);
+    convRev->setImpulse(impulse);
+    return convRev;
+}
+
+int main()
+{
+    APDI::RealtimeAudit::setHandler(recordViolation);
+
+    bool passed = true;
+
+    for(int voices = 1; voices <= 4; voices++)
+        for(int stereo = 0; stereo < 2; stereo++)
+            for(int shape = 0; shape < 3; shape++)
+                passed &= testMyEffect(voices, stereo != 0, shape);
+
+    stk::Stk::setSampleRate(48000);
+
+    stk::Chorus* chorus = new stk::Chorus(480);
+    chorus->setModDepth(0.2);
+    chorus->setModFrequency(0.5);
+    passed &= testStk("stk::Chorus", chorus, 2);
+
+    stk::PitShift* pitShift = new stk::PitShift();
+    pitShift->setShift(1.5);
+    passed &= testStk("stk::PitShift", pitShift, 1);
+
+    stk::LentPitShift* lentPitShift = new stk::LentPitShift(1.5);
+    passed &= testStk("stk::LentPitShift", lentPitShift, 1);
+
+    stk::Echo* echo = new stk::Echo(48000);
+    echo->setDelay(12000);
+    passed &= testStk("stk::Echo", echo, 1);
+
+    passed &= testStk("stk::FreeVerb", new stk::FreeVerb(), 2);
+    passed &= testStk("stk::NRev", new stk::NRev(1.5), 2);
+    passed &= testStk("stk::JCRev", new stk::JCRev(1.5), 2);
+    passed &= testStk("stk::PRCRev", new stk::PRCRev(1.5), 2);
+    passed &= testIir();
+    passed &= testStk("stk::ConvRev/worker", createConvRev(true), 2);
+    passed &= testStk("stk::ConvRev/no-worker", createConvRev(false), 2);
+
+    printf("%s\n", passed ? "all effects are real-time safe" : "real-time violations found");
+    return passed ? 0 : 1;
+}